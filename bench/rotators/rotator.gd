@@ -0,0 +1,4 @@
+extends MeshInstance3D
+
+func _process(delta):
+	rotate_x(delta)
@@ -0,0 +1,55 @@
+extends Node3D
+
+# Spawns a grid of cubes that rotate like res://rotator.gd, e.g.:
+#   godot_test --bench 1000 bench/rotators -- --count=10000 --variant=native
+# Variants: gdscript (one scripted node per cube), native (one NativeRotator per cube) and
+# batch (all cubes in one MultiMesh driven by a RotatorBatch).
+
+const Rotator = preload("res://rotator.gd")
+
+func _ready():
+	var count := 10000
+	var variant := "gdscript"
+	for arg in OS.get_cmdline_user_args():
+		if arg.begins_with("--count="):
+			count = arg.get_slice("=", 1).to_int()
+		elif arg.begins_with("--variant="):
+			variant = arg.get_slice("=", 1)
+
+	var native_class: String = {"native": "NativeRotator", "batch": "RotatorBatch"}.get(variant, "")
+	if native_class and not ClassDB.class_exists(native_class):
+		push_error("%s is not registered, run this project through godot_test" % native_class)
+		get_tree().quit(1)
+		return
+
+	var mesh := BoxMesh.new()
+	mesh.size = Vector3(0.5, 0.5, 0.5)
+	var side := ceili(sqrt(count))
+	$Camera.position = Vector3(side * 0.375, side * 0.375, side * 0.75)
+	print("rotators: %d cubes, %s" % [count, variant])
+
+	if variant == "batch":
+		var multimesh := MultiMesh.new()
+		multimesh.transform_format = MultiMesh.TRANSFORM_3D
+		multimesh.mesh = mesh
+		multimesh.instance_count = count
+		for i in count:
+			multimesh.set_instance_transform(i, Transform3D(Basis.IDENTITY, grid_position(i, side)))
+		var batch: MultiMeshInstance3D = ClassDB.instantiate(native_class)
+		batch.multimesh = multimesh
+		add_child(batch)
+		return
+
+	for i in count:
+		var node: MeshInstance3D
+		if variant == "native":
+			node = ClassDB.instantiate(native_class)
+		else:
+			node = MeshInstance3D.new()
+			node.set_script(Rotator)
+		node.mesh = mesh
+		node.position = grid_position(i, side)
+		add_child(node)
+
+func grid_position(index: int, side: int) -> Vector3:
+	return Vector3(index % side, floori(float(index) / side), 0) * 0.75
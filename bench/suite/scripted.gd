@@ -0,0 +1,10 @@
+extends Node3D
+
+# Per-node work of the scripts workload: a little arithmetic and a transform update per frame
+
+var phase := 0.0
+
+func _process(delta):
+	phase = fmod(phase + delta * 3.0, TAU)
+	position.y = sin(phase)
+	rotate_y(delta)
@@ -0,0 +1,104 @@
+extends Node3D
+
+# Generates one workload of the benchmark suite at scale, e.g.:
+#   godot_test --bench 1000 bench/suite -- --workload=physics --count=2000
+# Workloads: scripts (scripted nodes), physics (rigid bodies falling onto a floor), lights (omni
+# lights over meshes) and resources (one resource read from disk per frame, bypassing the cache).
+# The bench_suite build target runs all of them, see cmake/bench_suite.cmake.
+
+const Scripted = preload("res://scripted.gd")
+const resource_dir := "user://bench_suite"
+const image_size := 512
+
+var resource_paths: Array[String] = []
+var next_resource := 0
+
+func _ready():
+	var count := 1000
+	var workload := "scripts"
+	for arg in OS.get_cmdline_user_args():
+		if arg.begins_with("--count="):
+			count = arg.get_slice("=", 1).to_int()
+		elif arg.begins_with("--workload="):
+			workload = arg.get_slice("=", 1)
+
+	var side := ceili(sqrt(count))
+	$Camera.position = Vector3(side * 0.5, side * 0.5, side * 1.5)
+	print("suite: %s, %d" % [workload, count])
+
+	match workload:
+		"scripts":
+			for i in count:
+				var node := Node3D.new()
+				node.set_script(Scripted)
+				node.position = grid_position(i, side)
+				add_child(node)
+		"physics":
+			spawn_bodies(count)
+		"lights":
+			spawn_lights(count, side)
+		"resources":
+			save_resources(count)
+		_:
+			push_error("unknown workload %s" % workload)
+			get_tree().quit(1)
+	set_process(not resource_paths.is_empty())
+
+func _process(_delta):
+	# CACHE_MODE_IGNORE reads and parses the file again on every load
+	ResourceLoader.load(resource_paths[next_resource], "", ResourceLoader.CACHE_MODE_IGNORE)
+	next_resource = (next_resource + 1) % resource_paths.size()
+
+func spawn_bodies(count: int):
+	# A cube of layers of side * side boxes that touch, so bodies keep colliding as they settle
+	var side := ceili(pow(count, 1.0 / 3.0))
+	var spacing := 0.5
+	var extent := side * spacing
+
+	var floor_shape := BoxShape3D.new()
+	floor_shape.size = Vector3(extent * 4.0, 1.0, extent * 4.0)
+	var floor_collision := CollisionShape3D.new()
+	floor_collision.shape = floor_shape
+	var ground := StaticBody3D.new()
+	ground.position = Vector3(extent * 0.5, -0.5, extent * 0.5)
+	ground.add_child(floor_collision)
+	add_child(ground)
+
+	var shape := BoxShape3D.new()
+	shape.size = Vector3(spacing, spacing, spacing)
+	for i in count:
+		var collision := CollisionShape3D.new()
+		collision.shape = shape
+		var body := RigidBody3D.new()
+		var cell := Vector3(i % side, floori(float(i) / (side * side)), floori(float(i) / side) % side)
+		body.position = (cell + Vector3(0.5, 0.5, 0.5)) * spacing
+		body.add_child(collision)
+		add_child(body)
+
+func spawn_lights(count: int, side: int):
+	var mesh := BoxMesh.new()
+	mesh.size = Vector3(0.5, 0.5, 0.5)
+	for i in count:
+		var instance := MeshInstance3D.new()
+		instance.mesh = mesh
+		instance.position = grid_position(i, side)
+		var light := OmniLight3D.new()
+		light.omni_range = 2.0
+		light.position = Vector3(0.0, 0.5, 0.5)
+		instance.add_child(light)
+		add_child(instance)
+
+func save_resources(count: int):
+	DirAccess.make_dir_recursive_absolute(resource_dir)
+	for i in count:
+		var image := Image.create_empty(image_size, image_size, false, Image.FORMAT_RGBA8)
+		image.fill(Color(randf(), randf(), randf()))
+		var path := "%s/image_%d.res" % [resource_dir, i]
+		if ResourceSaver.save(image, path) != OK:
+			push_error("failed to save %s" % path)
+			get_tree().quit(1)
+			return
+		resource_paths.append(path)
+
+func grid_position(index: int, side: int) -> Vector3:
+	return Vector3(index % side, floori(float(index) / side), 0) * 0.75
@@ -0,0 +1,185 @@
+# =============================================================================
+# Benchmark suite
+# =============================================================================
+#
+# Runs every workload of bench/suite through --bench, writes their results to
+# ${OUTPUT_DIR}/bench_suite.json and fails when a workload's throughput dropped or its p99
+# iteration time grew by more than THRESHOLD percent against BASELINE. A missing baseline, or one
+# without a comparable entry for every workload, fails as well. With UPDATE_BASELINE the results
+# replace the baseline instead, with RECORD_ONLY they are only written. Run by the bench_suite,
+# bench_suite_baseline and bench_suite_record targets:
+#
+#   cmake -P cmake/bench_suite.cmake -DGODOT_TEST=<godot_test> -DSUITE_DIR=<bench/suite>
+#         -DOUTPUT_DIR=<dir> -DITERATIONS=<n> -DTHRESHOLD=<percent> -DBASELINE=<json>
+
+cmake_minimum_required(VERSION 3.28)
+
+# Workload and node, body, light or file count, see bench/suite/suite.gd
+set(BENCH_WORKLOADS
+    scripts=10000
+    physics=2000
+    lights=1000
+    resources=64
+)
+
+foreach(variable GODOT_TEST SUITE_DIR OUTPUT_DIR ITERATIONS THRESHOLD BASELINE)
+    if(NOT DEFINED ${variable})
+        message(FATAL_ERROR "bench_suite.cmake needs -D${variable}=...")
+    endif()
+endforeach()
+
+# Converts a JSON number to an integer count of thousandths, as math() only knows integers
+function(bench_to_milli value out_var)
+    string(TOLOWER "${value}" value)
+    set(exponent 0)
+    if(value MATCHES "^(.*)e([+-]?)0*([0-9]+)$")
+        set(value ${CMAKE_MATCH_1})
+        set(exponent "${CMAKE_MATCH_2}${CMAKE_MATCH_3}")
+    endif()
+    set(sign "")
+    if(value MATCHES "^-(.*)$")
+        set(sign "-")
+        set(value ${CMAKE_MATCH_1})
+    endif()
+    set(integer ${value})
+    set(fraction "")
+    if(value MATCHES "^([0-9]*)\\.([0-9]*)$")
+        set(integer ${CMAKE_MATCH_1})
+        set(fraction ${CMAKE_MATCH_2})
+    endif()
+
+    # Move the decimal point exponent + 3 places to the right and drop what is behind it
+    set(digits "${integer}${fraction}")
+    string(LENGTH "${integer}" point)
+    string(LENGTH "${digits}" length)
+    math(EXPR point "${point} + ${exponent} + 3")
+    if(point LESS_EQUAL 0)
+        set(${out_var} 0 PARENT_SCOPE)
+        return()
+    endif()
+    while(length LESS point)
+        string(APPEND digits 0)
+        math(EXPR length "${length} + 1")
+    endwhile()
+    string(SUBSTRING "${digits}" 0 ${point} digits)
+    string(REGEX REPLACE "^0+([0-9])" "\\1" digits "${digits}")
+    set(${out_var} "${sign}${digits}" PARENT_SCOPE)
+endfunction()
+
+# A percentage, possibly with decimals, compared in thousandths like the metrics
+if(NOT THRESHOLD MATCHES "^[0-9]+(\\.[0-9]+)?$")
+    message(FATAL_ERROR "bench_suite: THRESHOLD must be a percentage such as 10 or 2.5, "
+                        "got '${THRESHOLD}'")
+endif()
+bench_to_milli(${THRESHOLD} threshold_milli)
+
+file(MAKE_DIRECTORY ${OUTPUT_DIR})
+string(JSON results SET "{}" iterations ${ITERATIONS})
+string(JSON results SET "${results}" workloads "{}")
+
+foreach(entry IN LISTS BENCH_WORKLOADS)
+    string(REPLACE "=" ";" entry ${entry})
+    list(GET entry 0 workload)
+    list(GET entry 1 count)
+    set(stats_file ${OUTPUT_DIR}/${workload}.jsonl)
+    set(log_file ${OUTPUT_DIR}/${workload}.log)
+    file(REMOVE ${stats_file})
+
+    message(STATUS "bench_suite: ${workload}, ${count}")
+    execute_process(
+        COMMAND ${GODOT_TEST} --bench ${ITERATIONS} --stats-file ${stats_file} ${SUITE_DIR}
+                -- --workload=${workload} --count=${count}
+        RESULT_VARIABLE status
+        OUTPUT_FILE ${log_file}
+        ERROR_FILE ${log_file}
+    )
+    if(NOT status EQUAL 0 OR NOT EXISTS ${stats_file})
+        message(FATAL_ERROR "bench_suite: ${workload} failed (${status}), see ${log_file}")
+    endif()
+
+    # The final report is the last line
+    file(READ ${stats_file} report)
+    string(STRIP "${report}" report)
+    string(FIND "${report}" "\n" last_line REVERSE)
+    if(last_line GREATER -1)
+        math(EXPR last_line "${last_line} + 1")
+        string(SUBSTRING "${report}" ${last_line} -1 report)
+    endif()
+    string(JSON iterations_per_second GET "${report}" bench iterations_per_second)
+    string(JSON p99_us GET "${report}" bench iteration p99_us)
+    string(JSON peak_rss_bytes GET "${report}" bench peak_rss_bytes)
+    message(STATUS "bench_suite: ${workload}, ${iterations_per_second} iterations/s, "
+                   "p99 ${p99_us} us")
+
+    set(result "{}")
+    string(JSON result SET "${result}" count ${count})
+    string(JSON result SET "${result}" iterations_per_second ${iterations_per_second})
+    string(JSON result SET "${result}" p99_us ${p99_us})
+    string(JSON result SET "${result}" peak_rss_bytes ${peak_rss_bytes})
+    string(JSON results SET "${results}" workloads ${workload} "${result}")
+endforeach()
+
+file(WRITE ${OUTPUT_DIR}/bench_suite.json "${results}\n")
+message(STATUS "bench_suite: results in ${OUTPUT_DIR}/bench_suite.json")
+
+if(UPDATE_BASELINE)
+    file(WRITE ${BASELINE} "${results}\n")
+    message(STATUS "bench_suite: baseline ${BASELINE} updated")
+    return()
+endif()
+
+if(RECORD_ONLY)
+    message(STATUS "bench_suite: recorded only, not compared against ${BASELINE}")
+    return()
+endif()
+
+# A gate without a reference would pass every regression
+if(NOT EXISTS ${BASELINE})
+    message(FATAL_ERROR "bench_suite: no baseline at ${BASELINE}; build bench_suite_baseline "
+                        "to store one, or bench_suite_record to run without comparing")
+endif()
+
+file(READ ${BASELINE} baseline)
+set(regressions "")
+string(JSON workload_count LENGTH "${results}" workloads)
+math(EXPR last_workload "${workload_count} - 1")
+foreach(index RANGE ${last_workload})
+    string(JSON workload MEMBER "${results}" workloads ${index})
+    string(JSON base_count ERROR_VARIABLE missing GET "${baseline}" workloads ${workload} count)
+    string(JSON count GET "${results}" workloads ${workload} count)
+    if(missing OR NOT base_count EQUAL count)
+        list(APPEND regressions "${workload}: no baseline with count ${count}, rebuild it")
+        continue()
+    endif()
+
+    foreach(metric iterations_per_second p99_us)
+        string(JSON current GET "${results}" workloads ${workload} ${metric})
+        string(JSON reference GET "${baseline}" workloads ${workload} ${metric})
+        bench_to_milli(${current} current_milli)
+        bench_to_milli(${reference} reference_milli)
+
+        # Fewer iterations per second or a longer p99 beyond the threshold is a regression
+        set(regressed FALSE)
+        if(metric STREQUAL "iterations_per_second")
+            math(EXPR limit "${reference_milli} * (100000 - ${threshold_milli}) / 100000")
+            if(current_milli LESS limit)
+                set(regressed TRUE)
+            endif()
+        else()
+            math(EXPR limit "${reference_milli} * (100000 + ${threshold_milli}) / 100000")
+            if(current_milli GREATER limit)
+                set(regressed TRUE)
+            endif()
+        endif()
+        if(regressed)
+            list(APPEND regressions "${workload} ${metric}: ${current}, baseline ${reference}")
+        endif()
+    endforeach()
+endforeach()
+
+if(regressions)
+    list(JOIN regressions "\n  " regressions)
+    message(FATAL_ERROR "bench_suite: regressed by more than ${THRESHOLD}% or not comparable:\n"
+                        "  ${regressions}")
+endif()
+message(STATUS "bench_suite: within ${THRESHOLD}% of ${BASELINE}")
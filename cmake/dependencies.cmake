@@ -33,15 +33,81 @@ elseif(GODOT_ARCH STREQUAL "aarch64" OR GODOT_ARCH STREQUAL "arm64e" OR GODOT_AR
     set(GODOT_ARCH arm64)
 endif()
 
-if(CMAKE_BUILD_TYPE STREQUAL "Release")
+set(GODOT_SCONS_FLAGS "")
+if(GODOT_PROFILE STREQUAL "debug")
+    set(GODOT_TEMPLATE template_debug)
+elseif(GODOT_PROFILE STREQUAL "release")
+    set(GODOT_TEMPLATE template_release)
+    list(APPEND GODOT_SCONS_FLAGS optimize=speed)
+elseif(GODOT_PROFILE STREQUAL "perf")
     set(GODOT_TEMPLATE template_release)
+    list(APPEND GODOT_SCONS_FLAGS production=yes lto=full optimize=speed)
 else()
-    set(GODOT_TEMPLATE template_debug)
+    message(FATAL_ERROR "Unknown GODOT_PROFILE '${GODOT_PROFILE}'; use debug, release or perf")
+endif()
+
+# Optimize the host like the engine so the two halves of a measurement match
+if(GODOT_PROFILE STREQUAL "perf")
+    include(CheckIPOSupported)
+    check_ipo_supported(RESULT GODOT_HOST_IPO OUTPUT GODOT_HOST_IPO_ERROR)
+    if(GODOT_HOST_IPO)
+        set_property(TARGET ${PROJECT_NAME} PROPERTY INTERPROCEDURAL_OPTIMIZATION TRUE)
+    else()
+        message(WARNING "LTO is not supported for the host: ${GODOT_HOST_IPO_ERROR}")
+    endif()
+endif()
+
+if(GODOT_MARCH)
+    if(MSVC)
+        message(WARNING "GODOT_MARCH is ignored with MSVC")
+    else()
+        list(APPEND GODOT_SCONS_FLAGS "ccflags=-march=${GODOT_MARCH}" "linkflags=-march=${GODOT_MARCH}")
+        target_compile_options(${PROJECT_NAME} PRIVATE -march=${GODOT_MARCH})
+    endif()
 endif()
 
+list(JOIN GODOT_SCONS_FLAGS " " GODOT_SCONS_FLAGS_TEXT)
+message(STATUS "Godot Engine profile: ${GODOT_PROFILE} (${GODOT_TEMPLATE} ${GODOT_SCONS_FLAGS_TEXT})")
+
+set(GODOT_LIBRARY godot.${GODOT_PLATFORM}.${GODOT_TEMPLATE}.${GODOT_ARCH})
+
 target_include_directories(${PROJECT_NAME} PRIVATE ${godot_SOURCE_DIR} ${godot_SOURCE_DIR}/core/extension ${godot_SOURCE_DIR}/platform/${GODOT_PLATFORM})
+
+if(GODOT_LIBRARY_TYPE STREQUAL "static")
+    # With the perf profile both sides are LTO objects, so the libgodot_* calls made every
+    # frame can be inlined into the host at link time
+    if(NOT GODOT_PLATFORM STREQUAL "linuxbsd")
+        message(FATAL_ERROR "GODOT_LIBRARY_TYPE=static is only supported on Linux")
+    endif()
+    if(GODOT_PROFILE STREQUAL "perf" AND NOT CMAKE_CXX_COMPILER_ID STREQUAL "GNU")
+        message(WARNING "The engine is built with GCC LTO, link-time optimization across the host boundary needs GCC as well")
+    endif()
+
+    add_custom_target(godot_static_library
+        COMMAND scons
+            platform=${GODOT_PLATFORM}
+            arch=${GODOT_ARCH}
+            target=${GODOT_TEMPLATE}
+            library_type=static_library
+            disable_path_overrides=no
+            ${GODOT_SCONS_FLAGS}
+        WORKING_DIRECTORY ${godot_SOURCE_DIR}
+    )
+    add_dependencies(${PROJECT_NAME} godot_static_library)
+
+    # Libraries that are linked into the shared library otherwise; X11, Wayland, audio and
+    # the like are loaded at runtime by the engine either way
+    target_link_libraries(${PROJECT_NAME} PRIVATE
+        ${godot_SOURCE_DIR}/bin/${CMAKE_STATIC_LIBRARY_PREFIX}${GODOT_LIBRARY}${CMAKE_STATIC_LIBRARY_SUFFIX}
+        Threads::Threads
+        ${CMAKE_DL_LIBS}
+        m
+    )
+    return()
+endif()
+
 target_link_directories(${PROJECT_NAME} PRIVATE ${godot_SOURCE_DIR}/bin)
-target_link_libraries(${PROJECT_NAME} PRIVATE godot.${GODOT_PLATFORM}.${GODOT_TEMPLATE}.${GODOT_ARCH})
+target_link_libraries(${PROJECT_NAME} PRIVATE ${GODOT_LIBRARY})
 
 add_custom_target(godot_shared_library
     COMMAND scons 
@@ -50,14 +116,15 @@ add_custom_target(godot_shared_library
         target=${GODOT_TEMPLATE}
         library_type=shared_library 
         disable_path_overrides=no
+        ${GODOT_SCONS_FLAGS}
     WORKING_DIRECTORY ${godot_SOURCE_DIR}
 )
 
 if(APPLE)
     add_custom_command(TARGET godot_shared_library POST_BUILD 
         COMMAND ${CMAKE_INSTALL_NAME_TOOL}
-            -id @rpath/${CMAKE_SHARED_LIBRARY_PREFIX}godot.${GODOT_PLATFORM}.${GODOT_TEMPLATE}.${GODOT_ARCH}${CMAKE_SHARED_LIBRARY_SUFFIX}
-            ${godot_SOURCE_DIR}/bin/${CMAKE_SHARED_LIBRARY_PREFIX}godot.${GODOT_PLATFORM}.${GODOT_TEMPLATE}.${GODOT_ARCH}${CMAKE_SHARED_LIBRARY_SUFFIX}
+            -id @rpath/${CMAKE_SHARED_LIBRARY_PREFIX}${GODOT_LIBRARY}${CMAKE_SHARED_LIBRARY_SUFFIX}
+            ${godot_SOURCE_DIR}/bin/${CMAKE_SHARED_LIBRARY_PREFIX}${GODOT_LIBRARY}${CMAKE_SHARED_LIBRARY_SUFFIX}
     )
 endif()
 
@@ -65,6 +132,6 @@ add_dependencies(${PROJECT_NAME} godot_shared_library)
 
 add_custom_command(TARGET ${PROJECT_NAME} POST_BUILD
     COMMAND ${CMAKE_COMMAND} -E copy_if_different
-        ${godot_SOURCE_DIR}/bin/${CMAKE_SHARED_LIBRARY_PREFIX}godot.${GODOT_PLATFORM}.${GODOT_TEMPLATE}.${GODOT_ARCH}${CMAKE_SHARED_LIBRARY_SUFFIX}
+        ${godot_SOURCE_DIR}/bin/${CMAKE_SHARED_LIBRARY_PREFIX}${GODOT_LIBRARY}${CMAKE_SHARED_LIBRARY_SUFFIX}
         $<TARGET_FILE_DIR:${PROJECT_NAME}>
 )
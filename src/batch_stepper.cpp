@@ -0,0 +1,122 @@
+#include "batch_stepper.h"
+
+#include <algorithm>
+#include <cstring>
+#include <iostream>
+
+#include "shm_transport.h"
+
+BatchStepper::BatchStepper() = default;
+
+BatchStepper::~BatchStepper() = default;
+
+bool BatchStepper::open(const std::string &name, int count, std::chrono::milliseconds timeout)
+{
+    clients.clear();
+    for (int index = 0; index < count; ++index) {
+        auto client  = std::make_unique<ShmClient>();
+        auto segment = count == 1 ? name : name + "." + std::to_string(index);
+        if (!client->open(segment, timeout)) {
+            std::cerr << "no host answered on shared memory segment " << segment << std::endl;
+            clients.clear();
+            return false;
+        }
+        clients.push_back(std::move(client));
+    }
+
+    // Steps count from whatever the hosts published before we attached
+    expected_frames.assign(clients.size(), 0);
+    frame_counts.assign(clients.size(), 0);
+    observation_sizes.assign(clients.size(), 0);
+    for (size_t i = 0; i < clients.size(); ++i) {
+        ChannelState state;
+        if (clients[i]->wait_state(0, state, std::chrono::microseconds(0))) {
+            expected_frames[i] = state.frame;
+        }
+    }
+    return true;
+}
+
+bool BatchStepper::step(uint32_t action_type, const void *actions, size_t action_size,
+                        void *observations, size_t observation_stride,
+                        std::chrono::microseconds timeout)
+{
+    if (action_size > ChannelCommand::payload_capacity) {
+        return false;
+    }
+
+    // Start every instance before waiting for any, so their iterations overlap
+    bool ok = true;
+    for (size_t i = 0; i < clients.size(); ++i) {
+        frame_counts[i]      = 0;
+        observation_sizes[i] = 0;
+        if (action_size > 0) {
+            ChannelCommand command;
+            command.type = action_type;
+            command.size = static_cast<uint32_t>(action_size);
+            std::memcpy(command.payload, static_cast<const uint8_t *>(actions) + i * action_size,
+                        action_size);
+            ok = clients[i]->send(command) && ok;
+        }
+        if (!clients[i]->step()) {
+            ok = false;
+            continue;
+        }
+        ++expected_frames[i];
+        frame_counts[i] = expected_frames[i]; // Waited for below
+    }
+
+    // Wait for the iteration of this step, not just any newer one
+    auto  until  = std::chrono::steady_clock::now() + timeout;
+    auto *output = static_cast<uint8_t *>(observations);
+    for (size_t i = 0; i < clients.size(); ++i) {
+        if (frame_counts[i] == 0) {
+            continue; // Not stepped, its last observation is no answer
+        }
+        auto remaining = std::chrono::duration_cast<std::chrono::microseconds>(
+            until - std::chrono::steady_clock::now());
+        if (!clients[i]->wait_data(expected_frames[i] - 1, output + i * observation_stride,
+                                   observation_stride, frame_counts[i], observation_sizes[i],
+                                   std::max(remaining, std::chrono::microseconds(0)))) {
+            frame_counts[i]      = 0;
+            observation_sizes[i] = 0;
+            ok                   = false;
+        }
+    }
+    return ok;
+}
+
+void *godot_test_batch_open(const char *name, int count, int64_t timeout_us)
+{
+    auto batch = std::make_unique<BatchStepper>();
+    auto wait  = std::chrono::duration_cast<std::chrono::milliseconds>(
+        std::chrono::microseconds(timeout_us));
+    if (name == nullptr || count <= 0 || !batch->open(name, count, wait)) {
+        return nullptr;
+    }
+    return batch.release();
+}
+
+int godot_test_batch_step(void *batch, uint32_t action_type, const void *actions,
+                          size_t action_size, void *observations, size_t observation_stride,
+                          int64_t timeout_us, uint64_t *frames, uint32_t *sizes)
+{
+    if (batch == nullptr) {
+        return -1;
+    }
+    auto *stepper = static_cast<BatchStepper *>(batch);
+    bool  ok      = stepper->step(action_type, actions, action_size, observations,
+                                  observation_stride, std::chrono::microseconds(timeout_us));
+    if (frames != nullptr) {
+        std::copy(stepper->frames().begin(), stepper->frames().end(), frames);
+    }
+    if (sizes != nullptr) {
+        std::copy(stepper->sizes().begin(), stepper->sizes().end(), sizes);
+    }
+    return ok ? 0 : -1;
+}
+
+void godot_test_batch_close(void *batch)
+{
+    delete static_cast<BatchStepper *>(batch);
+}
@@ -0,0 +1,95 @@
+/*
+ * Lockstep stepping of a batch of host processes, for environment simulation workloads.
+ */
+
+#pragma once
+
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <vector>
+
+class ShmClient;
+
+/*
+ * Steps hosts started with --shm <name> --shm-lockstep --instances <count> together: each step
+ * sends every instance its action, lets each run exactly one iteration, and gathers every
+ * observation into one caller-provided buffer. The instances run their iterations in parallel,
+ * one process each, since an engine instance cannot share its process (see replica_launcher.h).
+ *
+ * An action is a command of the given type whose payload goes to the host's command handler; an
+ * observation is the data of the state published after the iteration. Observations are copied
+ * once, from the shared segment straight into the buffer, so the buffer can be the memory of a
+ * numpy array or tensor.
+ */
+class BatchStepper
+{
+  public:
+    BatchStepper();
+    ~BatchStepper();
+
+    BatchStepper(const BatchStepper &)            = delete;
+    BatchStepper &operator=(const BatchStepper &) = delete;
+
+    /*
+     * Attaches to the segment <name> when count is 1, otherwise to <name>.0 to <name>.<count - 1>
+     * as --instances names them. Waits up to timeout for each host to create its segment.
+     */
+    bool open(const std::string &name, int count, std::chrono::milliseconds timeout);
+
+    size_t size() const
+    {
+        return clients.size();
+    }
+
+    /*
+     * Runs one lockstep step. Instance i gets action_size bytes at actions + i * action_size (no
+     * action is sent when action_size is 0), and its observation is written to observations + i *
+     * observation_stride, up to observation_stride bytes. Returns false if an instance did not
+     * answer within timeout or has exited; the observations of the others are still written.
+     *
+     * Each instance is expected to reach one more iteration per granted step, so an observation
+     * that arrives after its step timed out is never taken for the answer to a later step.
+     */
+    bool step(uint32_t action_type, const void *actions, size_t action_size, void *observations,
+              size_t observation_stride, std::chrono::microseconds timeout);
+
+    /*
+     * Iteration of each instance's observation from the last step, 0 if it did not answer.
+     */
+    const std::vector<uint64_t> &frames() const
+    {
+        return frame_counts;
+    }
+
+    /*
+     * Size of each instance's observation from the last step, 0 if it did not answer. Sizes
+     * above the observation stride mean the observation was cut short.
+     */
+    const std::vector<uint32_t> &sizes() const
+    {
+        return observation_sizes;
+    }
+
+  private:
+    std::vector<std::unique_ptr<ShmClient>> clients;
+    std::vector<uint64_t>                   expected_frames; // Iteration each step must reach
+    std::vector<uint64_t>                   frame_counts;
+    std::vector<uint32_t>                   observation_sizes;
+};
+
+/*
+ * C interface of BatchStepper in the godot_test_batch library, for ctypes and similar bindings.
+ * open returns null on failure, step returns 0 on success and -1 on failure. Timeouts are in
+ * microseconds. step fills frames and sizes, one entry per instance, with frames() and sizes()
+ * unless they are null.
+ */
+extern "C" {
+void *godot_test_batch_open(const char *name, int count, int64_t timeout_us);
+int   godot_test_batch_step(void *batch, uint32_t action_type, const void *actions,
+                            size_t action_size, void *observations, size_t observation_stride,
+                            int64_t timeout_us, uint64_t *frames, uint32_t *sizes);
+void  godot_test_batch_close(void *batch);
+}
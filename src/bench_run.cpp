@@ -0,0 +1,71 @@
+#include "bench_run.h"
+
+#include <iomanip>
+
+#include "frame_stats.h"
+#include "json_writer.h"
+
+void BenchRun::start(const FrameStats &stats, double p_startup_s)
+{
+    startup_s          = p_startup_s;
+    first_iteration    = stats.iteration_count();
+    iteration_baseline = stats.iteration_histogram().snapshot();
+    usage_at_start     = ProcessUsage::query();
+    started_at         = Clock::now();
+}
+
+void BenchRun::finish(const FrameStats &stats)
+{
+    finished_at       = Clock::now();
+    iterations        = stats.iteration_count() - first_iteration;
+    iteration_latency = stats.iteration_histogram().snapshot().since(iteration_baseline);
+    usage_at_finish   = ProcessUsage::query();
+}
+
+bool BenchRun::is_done(const FrameStats &stats) const
+{
+    return stats.iteration_count() - first_iteration >= target_iterations;
+}
+
+void BenchRun::print(std::ostream &out) const
+{
+    double cpu_s = usage_at_finish.cpu_total_s() - usage_at_start.cpu_total_s();
+
+    auto flags     = out.flags();
+    auto precision = out.precision();
+    out << std::fixed << std::setprecision(3);
+    out << "benchmark: " << iterations << "/" << target_iterations << " iterations at fixed "
+        << fixed_fps << " fps (" BUILD_PROFILE " build)\n"
+        << "  startup:    " << startup_s << " s\n"
+        << "  wall time:  " << wall_time_s() << " s\n"
+        << "  cpu time:   " << cpu_s << " s ("
+        << usage_at_finish.cpu_user_s - usage_at_start.cpu_user_s << " user, "
+        << usage_at_finish.cpu_system_s - usage_at_start.cpu_system_s << " system)\n"
+        << "  throughput: " << iterations_per_second() << " iterations/s\n"
+        << "  iteration:  p50 " << iteration_latency.percentile(50.0) / 1000.0 << " us, p99 "
+        << iteration_latency.percentile(99.0) / 1000.0 << " us, max "
+        << iteration_latency.max / 1000.0 << " us\n"
+        << "  peak rss:   " << usage_at_finish.peak_rss_bytes / (1024.0 * 1024.0) << " MiB"
+        << std::endl;
+    out.flags(flags);
+    out.precision(precision);
+}
+
+void BenchRun::write_json(JsonWriter &json) const
+{
+    json.field("build_profile", BUILD_PROFILE);
+    json.field("target_iterations", target_iterations);
+    json.field("iterations", iterations);
+    json.field("fixed_fps", fixed_fps);
+    json.field("startup_s", startup_s);
+    json.field("wall_time_s", wall_time_s());
+    json.field("cpu_time_s", usage_at_finish.cpu_total_s() - usage_at_start.cpu_total_s());
+    json.field("cpu_user_s", usage_at_finish.cpu_user_s - usage_at_start.cpu_user_s);
+    json.field("cpu_system_s", usage_at_finish.cpu_system_s - usage_at_start.cpu_system_s);
+    json.field("iterations_per_second", iterations_per_second());
+    json.field("peak_rss_bytes", usage_at_finish.peak_rss_bytes);
+
+    json.begin_object("iteration");
+    iteration_latency.write_json(json);
+    json.end_object();
+}
@@ -0,0 +1,75 @@
+/*
+ * Headless benchmark mode: a fixed number of iterations with a fixed simulated timestep.
+ */
+
+#pragma once
+
+#include <chrono>
+#include <cstdint>
+#include <ostream>
+
+#include "latency_histogram.h"
+#include "process_stats.h"
+
+class FrameStats;
+class JsonWriter;
+
+/*
+ * Measures one benchmark run from the first iteration to the last. Iterations and latencies
+ * are taken relative to the frame stats at start(), so one run can follow another in the same
+ * process.
+ */
+class BenchRun
+{
+  public:
+    using Clock = std::chrono::steady_clock;
+
+    BenchRun(uint64_t p_target_iterations, int p_fixed_fps)
+        : target_iterations(p_target_iterations)
+        , fixed_fps(p_fixed_fps)
+    {
+    }
+
+    /*
+     * Marks the beginning of the measured loop, after a startup that took startup_s.
+     */
+    void start(const FrameStats &stats, double p_startup_s);
+
+    /*
+     * Marks the end of the measured loop.
+     */
+    void finish(const FrameStats &stats);
+
+    bool is_done(const FrameStats &stats) const;
+
+    double wall_time_s() const
+    {
+        return std::chrono::duration<double>(finished_at - started_at).count();
+    }
+
+    double iterations_per_second() const
+    {
+        double wall = wall_time_s();
+        return wall > 0.0 ? static_cast<double>(iterations) / wall : 0.0;
+    }
+
+    /*
+     * Prints a human readable summary including the iteration time percentiles.
+     */
+    void print(std::ostream &out) const;
+
+    void write_json(JsonWriter &json) const;
+
+  private:
+    uint64_t          target_iterations;
+    int               fixed_fps;
+    uint64_t          first_iteration = 0;
+    uint64_t          iterations      = 0;
+    double            startup_s       = 0.0;
+    Clock::time_point started_at;
+    Clock::time_point finished_at;
+    ProcessUsage      usage_at_start;
+    ProcessUsage      usage_at_finish;
+    HistogramSnapshot iteration_baseline;
+    HistogramSnapshot iteration_latency;
+};
@@ -0,0 +1,128 @@
+#include "control_channel.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cstring>
+
+#include "json_writer.h"
+
+ControlChannel::ControlChannel(size_t capacity)
+{
+    size_t size = 1;
+    while (size < std::max<size_t>(capacity, 2)) {
+        size <<= 1;
+    }
+    mask = size - 1;
+
+    // A slot is free for the producer at position p while its sequence is p
+    cells = std::make_unique<Cell[]>(size);
+    for (size_t i = 0; i < size; ++i) {
+        cells[i].sequence.store(i, std::memory_order_relaxed);
+    }
+    states = std::make_unique<ChannelState[]>(3);
+}
+
+ControlChannel::~ControlChannel() = default;
+
+bool ControlChannel::send(const ChannelCommand &command)
+{
+    if (command.size > ChannelCommand::payload_capacity) {
+        dropped.fetch_add(1, std::memory_order_relaxed);
+        return false;
+    }
+
+    auto  position = enqueue_position.load(std::memory_order_relaxed);
+    Cell *cell     = nullptr;
+    while (true) {
+        cell          = &cells[position & mask];
+        auto sequence = cell->sequence.load(std::memory_order_acquire);
+        auto lag      = static_cast<int64_t>(sequence - position);
+        if (lag == 0) {
+            if (enqueue_position.compare_exchange_weak(position, position + 1,
+                                                       std::memory_order_relaxed)) {
+                break;
+            }
+        } else if (lag < 0) {
+            // The consumer has not freed this slot yet, the ring is full
+            dropped.fetch_add(1, std::memory_order_relaxed);
+            return false;
+        } else {
+            position = enqueue_position.load(std::memory_order_relaxed);
+        }
+    }
+
+    cell->command = command;
+    cell->sequence.store(position + 1, std::memory_order_release);
+    sent.fetch_add(1, std::memory_order_relaxed);
+    return true;
+}
+
+bool ControlChannel::send(uint32_t type, const void *payload, size_t size)
+{
+    if (size > ChannelCommand::payload_capacity) {
+        dropped.fetch_add(1, std::memory_order_relaxed);
+        return false;
+    }
+
+    ChannelCommand command;
+    command.type = type;
+    command.size = static_cast<uint32_t>(size);
+    if (size > 0) {
+        std::memcpy(command.payload, payload, size);
+    }
+    return send(command);
+}
+
+size_t ControlChannel::drain(const CommandHandler &handler)
+{
+    size_t handled = 0;
+    while (handled <= mask) {
+        auto &cell = cells[dequeue_position & mask];
+        if (cell.sequence.load(std::memory_order_acquire) != dequeue_position + 1) {
+            break;
+        }
+
+        // Free the slot before handling, so producers are not held up by the handler
+        ChannelCommand command = cell.command;
+        cell.sequence.store(dequeue_position + mask + 1, std::memory_order_release);
+        ++dequeue_position;
+        ++handled;
+        handler(command);
+    }
+
+    drained    += handled;
+    max_drained = std::max<uint64_t>(max_drained, handled);
+    return handled;
+}
+
+void ControlChannel::publish_state()
+{
+    states[back].time_ns = static_cast<uint64_t>(
+        std::chrono::duration_cast<std::chrono::nanoseconds>(
+            std::chrono::steady_clock::now().time_since_epoch())
+            .count());
+    auto marked = static_cast<uint8_t>(back | fresh);
+    back        = middle.exchange(marked, std::memory_order_acq_rel) & (fresh - 1);
+    ++published;
+}
+
+const ChannelState *ControlChannel::latest_state()
+{
+    if (middle.load(std::memory_order_relaxed) & fresh) {
+        front       = middle.exchange(front, std::memory_order_acq_rel) & (fresh - 1);
+        front_valid = true;
+        taken.fetch_add(1, std::memory_order_relaxed);
+    }
+    return front_valid ? &states[front] : nullptr;
+}
+
+void ControlChannel::write_json(JsonWriter &json) const
+{
+    json.field("capacity", mask + 1);
+    json.field("sent", sent.load(std::memory_order_relaxed));
+    json.field("dropped", dropped.load(std::memory_order_relaxed));
+    json.field("drained", drained);
+    json.field("max_drained", max_drained);
+    json.field("states_published", published);
+    json.field("states_taken", taken.load(std::memory_order_relaxed));
+}
@@ -0,0 +1,127 @@
+/*
+ * Lock-free command and state exchange between control threads and the engine thread.
+ */
+
+#pragma once
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <memory>
+
+class JsonWriter;
+
+/*
+ * One input for the engine thread. Fixed size, so queueing it never allocates; larger data has to
+ * be split or passed by handle.
+ */
+struct ChannelCommand {
+    static constexpr size_t payload_capacity = 56;
+
+    uint32_t type = 0; // Meaning is up to the sender and the command handler
+    uint32_t size = 0; // Bytes of payload in use
+    uint8_t  payload[payload_capacity];
+};
+
+/*
+ * Simulation state published by the engine thread once per iteration.
+ */
+struct ChannelState {
+    static constexpr size_t data_capacity = 4072;
+
+    uint64_t frame   = 0; // Iteration the state was taken after
+    uint64_t time_ns = 0; // steady_clock time of publication
+    uint32_t size    = 0; // Bytes of data in use
+    uint8_t  data[data_capacity];
+};
+
+/*
+ * Carries commands from any number of threads to the engine thread, and state snapshots back.
+ *
+ * Commands go through a bounded multi-producer, single-consumer ring (a sequence number per slot,
+ * producers claim slots with one compare-and-swap); send() fails instead of waiting when the ring
+ * is full. The host drains it right before each iteration, so commands always take effect at the
+ * same point of the frame. State uses a triple buffer: the engine thread fills the back buffer
+ * after each iteration and swaps it with the middle one, and the reader swaps the middle one with
+ * its front buffer when it holds something newer. Neither side ever waits for the other, and
+ * the reader always sees a complete snapshot.
+ */
+class ControlChannel
+{
+  public:
+    using CommandHandler = std::function<void(const ChannelCommand &command)>;
+    using StateWriter    = std::function<void(ChannelState &r_state)>;
+
+    /*
+     * The capacity is rounded up to a power of two.
+     */
+    explicit ControlChannel(size_t capacity = 1024);
+    ~ControlChannel();
+
+    ControlChannel(const ControlChannel &)            = delete;
+    ControlChannel &operator=(const ControlChannel &) = delete;
+
+    /*
+     * Queues a command. Safe from any thread. Returns false if the ring is full or the payload
+     * too large.
+     */
+    bool send(const ChannelCommand &command);
+    bool send(uint32_t type, const void *payload, size_t size);
+
+    /*
+     * Calls handler for the queued commands in order, at most one ring's worth so producers cannot
+     * keep the engine thread here. Engine thread only. Returns the number handled.
+     */
+    size_t drain(const CommandHandler &handler);
+
+    /*
+     * The buffer to fill with the next state, then publish_state(). Engine thread only.
+     */
+    ChannelState &back_state()
+    {
+        return states[back];
+    }
+
+    void publish_state();
+
+    /*
+     * The most recent published state, null before the first. Valid until the next call. Only one
+     * thread may read state.
+     */
+    const ChannelState *latest_state();
+
+    void write_json(JsonWriter &json) const;
+
+  private:
+    struct alignas(64) Cell {
+        std::atomic<uint64_t> sequence{0};
+        ChannelCommand        command;
+    };
+
+    static constexpr uint8_t fresh = 4; // Set in 'middle' while the reader has not taken it
+
+    std::unique_ptr<Cell[]> cells;
+    size_t                  mask;
+
+    alignas(64) std::atomic<uint64_t> enqueue_position{0};
+    alignas(64) uint64_t dequeue_position = 0;
+
+    std::unique_ptr<ChannelState[]> states;
+    uint8_t                         back = 0; // Engine thread
+    std::atomic<uint8_t>            middle{1};
+    uint8_t                         front       = 2; // Reader thread
+    bool                            front_valid = false;
+
+    // Written by send()
+    std::atomic<uint64_t> sent{0};
+    std::atomic<uint64_t> dropped{0};
+
+    // Written by the engine thread
+    uint64_t drained     = 0;
+    uint64_t max_drained = 0; // Most commands handled before one iteration
+    uint64_t published   = 0;
+
+    // Written by the reader
+    std::atomic<uint64_t> taken{0};
+};
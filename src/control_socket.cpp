@@ -0,0 +1,267 @@
+#include "control_socket.h"
+
+#include <cerrno>
+#include <cstdlib>
+#include <cstring>
+#include <iostream>
+#include <sstream>
+#include <vector>
+
+#if !defined(_WIN32)
+#include <fcntl.h>
+#include <sys/socket.h>
+#include <sys/stat.h>
+#include <sys/un.h>
+#include <unistd.h>
+#endif
+
+#include "control_channel.h"
+#include "event_loop.h"
+#include "json_writer.h"
+#include "shm_transport.h"
+
+namespace
+{
+// A client sending longer lines is not speaking the protocol
+constexpr size_t max_line = 256;
+
+#if !defined(_WIN32)
+void set_nonblocking(int fd)
+{
+    fcntl(fd, F_SETFL, fcntl(fd, F_GETFL) | O_NONBLOCK);
+    fcntl(fd, F_SETFD, FD_CLOEXEC);
+}
+
+// Replies are a few bytes to a client that just wrote to us; one that does not read loses them
+void reply(int fd, const std::string &text)
+{
+    auto line = text + "\n";
+    [[maybe_unused]] auto written = send(fd, line.data(), line.size(), MSG_NOSIGNAL);
+}
+#endif
+} // namespace
+
+ControlSocket::ControlSocket(std::string p_path, EventLoop &p_loop, ControlChannel &p_channel)
+    : path(std::move(p_path))
+    , loop(p_loop)
+    , channel(p_channel)
+{
+}
+
+ControlSocket::~ControlSocket()
+{
+    close();
+}
+
+bool ControlSocket::open()
+{
+#if defined(_WIN32)
+    std::cerr << "--control-socket is not supported on this platform" << std::endl;
+    return false;
+#else
+    sockaddr_un address{};
+    address.sun_family = AF_UNIX;
+    if (path.size() >= sizeof(address.sun_path)) {
+        std::cerr << "control socket path too long: " << path << std::endl;
+        return false;
+    }
+    std::memcpy(address.sun_path, path.c_str(), path.size() + 1);
+
+    // A host that crashed left its socket behind; never remove anything but a socket
+    struct stat info;
+    if (lstat(path.c_str(), &info) == 0) {
+        if (!S_ISSOCK(info.st_mode)) {
+            std::cerr << "refusing to replace " << path << ": not a socket" << std::endl;
+            return false;
+        }
+        unlink(path.c_str());
+    }
+
+    listener = socket(AF_UNIX, SOCK_STREAM, 0);
+    if (listener < 0) {
+        std::cerr << "failed to create the control socket: " << std::strerror(errno)
+                  << std::endl;
+        return false;
+    }
+    set_nonblocking(listener);
+
+    // Only this user may connect
+    auto mask = umask(077);
+    bool bound = bind(listener, reinterpret_cast<sockaddr *>(&address), sizeof(address)) == 0;
+    umask(mask);
+    if (!bound || listen(listener, 16) != 0) {
+        std::cerr << "failed to listen on " << path << ": " << std::strerror(errno) << std::endl;
+        ::close(listener);
+        listener = -1;
+        return false;
+    }
+
+    if (!loop.add_fd(listener, EventLoop::Readable, [this](int, uint32_t) { accept_clients(); })) {
+        std::cerr << "failed to watch the control socket" << std::endl;
+        close();
+        return false;
+    }
+    return true;
+#endif
+}
+
+void ControlSocket::close()
+{
+#if !defined(_WIN32)
+    std::vector<int> connected;
+    for (auto &client : clients) {
+        connected.push_back(client.first);
+    }
+    for (int fd : connected) {
+        close_client(fd);
+    }
+    if (listener >= 0) {
+        loop.remove_fd(listener);
+        ::close(listener);
+        listener = -1;
+        unlink(path.c_str());
+    }
+#endif
+}
+
+bool ControlSocket::take_quit()
+{
+    bool requested = quit;
+    quit           = false;
+    return requested;
+}
+
+void ControlSocket::accept_clients()
+{
+#if !defined(_WIN32)
+    int fd;
+    while ((fd = accept(listener, nullptr, nullptr)) >= 0) {
+        set_nonblocking(fd);
+        if (!loop.add_fd(fd, EventLoop::Readable,
+                         [this](int client, uint32_t) { read_client(client); })) {
+            ::close(fd);
+            continue;
+        }
+        clients[fd];
+        ++connections;
+    }
+#endif
+}
+
+void ControlSocket::read_client(int fd)
+{
+#if !defined(_WIN32)
+    auto client = clients.find(fd);
+    if (client == clients.end()) {
+        return;
+    }
+
+    char    buffer[512];
+    ssize_t received;
+    while ((received = recv(fd, buffer, sizeof(buffer), 0)) > 0) {
+        client->second.append(buffer, static_cast<size_t>(received));
+    }
+    bool hangup = received == 0 || (errno != EAGAIN && errno != EWOULDBLOCK);
+
+    auto  &pending = client->second;
+    size_t begin   = 0;
+    size_t end;
+    while ((end = pending.find('\n', begin)) != std::string::npos) {
+        auto line = pending.substr(begin, end - begin);
+        if (!line.empty() && line.back() == '\r') {
+            line.pop_back();
+        }
+        begin = end + 1;
+        if (line.empty()) {
+            continue;
+        }
+
+        std::string error;
+        if (execute(line, error)) {
+            ++commands;
+            reply(fd, "ok");
+        } else {
+            ++errors;
+            reply(fd, "error " + error);
+        }
+    }
+    pending.erase(0, begin);
+
+    if (hangup || pending.size() > max_line) {
+        close_client(fd);
+    }
+#else
+    (void)fd;
+#endif
+}
+
+void ControlSocket::close_client(int fd)
+{
+#if !defined(_WIN32)
+    loop.remove_fd(fd);
+    ::close(fd);
+    clients.erase(fd);
+#else
+    (void)fd;
+#endif
+}
+
+bool ControlSocket::execute(const std::string &line, std::string &r_error)
+{
+    std::istringstream words(line);
+    std::string        command;
+    std::string        action;
+    std::string        value;
+    words >> command >> action >> value;
+
+    if (command == "quit") {
+        quit = true;
+        loop.wake();
+        return true;
+    }
+    if (command != "press" && command != "release") {
+        r_error = "unknown command " + command;
+        return false;
+    }
+
+    float strength = 1.0f;
+    char *end      = nullptr;
+    if (!value.empty()) {
+        strength = std::strtof(value.c_str(), &end);
+    }
+    if (action.empty() || (!value.empty() && (command == "release" || *end != '\0'))) {
+        r_error = "usage: press <action> [strength] or release <action>";
+        return false;
+    }
+
+    // Same encoding as the input commands of a --shm supervisor
+    ChannelCommand input;
+    size_t         offset = 0;
+    input.type            = command == "press" ? ShmPress : ShmRelease;
+    if (input.type == ShmPress) {
+        std::memcpy(input.payload, &strength, sizeof(strength));
+        offset = sizeof(strength);
+    }
+    if (action.size() > ChannelCommand::payload_capacity - offset) {
+        r_error = "action name too long";
+        return false;
+    }
+    std::memcpy(input.payload + offset, action.data(), action.size());
+    input.size = static_cast<uint32_t>(offset + action.size());
+
+    if (!channel.send(input)) {
+        r_error = "command queue full";
+        return false;
+    }
+    loop.wake();
+    return true;
+}
+
+void ControlSocket::write_json(JsonWriter &json) const
+{
+    json.field("path", path);
+    json.field("clients", clients.size());
+    json.field("connections", connections);
+    json.field("commands", commands);
+    json.field("errors", errors);
+}
@@ -0,0 +1,73 @@
+/*
+ * Unix socket for sending input and quit commands to a running host.
+ */
+
+#pragma once
+
+#include <cstdint>
+#include <string>
+#include <unordered_map>
+
+class ControlChannel;
+class EventLoop;
+class JsonWriter;
+
+/*
+ * Listens on a Unix stream socket and serves its clients from the host's event loop, on the
+ * engine thread, between iterations. Clients send one command per line and get "ok" or
+ * "error <reason>" back for each:
+ *
+ *   press <action> [strength]   Input.action_press() before the next iteration
+ *   release <action>            Input.action_release() before the next iteration
+ *   quit                        Ends the project as if the engine had quit
+ *
+ * Input goes through the control channel, so it is recorded with --record like every other
+ * command, and wakes the loop so the next iteration runs at once instead of at its deadline.
+ *
+ * Not available on Windows.
+ */
+class ControlSocket
+{
+  public:
+    ControlSocket(std::string p_path, EventLoop &p_loop, ControlChannel &p_channel);
+    ~ControlSocket();
+
+    ControlSocket(const ControlSocket &)            = delete;
+    ControlSocket &operator=(const ControlSocket &) = delete;
+
+    /*
+     * Creates the socket, replacing a stale one at the same path, and registers it with the
+     * event loop. Prints the problem and returns false on failure.
+     */
+    bool open();
+
+    /*
+     * Disconnects every client and removes the socket.
+     */
+    void close();
+
+    /*
+     * Returns true once, after a client sent quit.
+     */
+    bool take_quit();
+
+    void write_json(JsonWriter &json) const;
+
+  private:
+    void accept_clients();
+    void read_client(int fd);
+    void close_client(int fd);
+    bool execute(const std::string &line, std::string &r_error);
+
+    std::string     path;
+    EventLoop      &loop;
+    ControlChannel &channel;
+    int             listener = -1;
+
+    std::unordered_map<int, std::string> clients; // Partial line received from each client
+    bool                                 quit = false;
+
+    uint64_t connections = 0;
+    uint64_t commands    = 0;
+    uint64_t errors      = 0;
+};
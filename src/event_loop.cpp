@@ -0,0 +1,290 @@
+#include "event_loop.h"
+
+#include <algorithm>
+#include <thread>
+
+#if defined(__linux__)
+#include <sys/epoll.h>
+#include <sys/eventfd.h>
+#include <sys/timerfd.h>
+#endif
+#if !defined(_WIN32)
+#include <cerrno>
+#include <fcntl.h>
+#include <poll.h>
+#include <unistd.h>
+#endif
+
+#include "json_writer.h"
+
+namespace
+{
+#if defined(__linux__)
+uint32_t to_epoll(uint32_t events)
+{
+    return ((events & EventLoop::Readable) ? EPOLLIN : 0u)
+           | ((events & EventLoop::Writable) ? EPOLLOUT : 0u);
+}
+
+uint32_t from_epoll(uint32_t events)
+{
+    return ((events & EPOLLIN) ? EventLoop::Readable : 0u)
+           | ((events & EPOLLOUT) ? EventLoop::Writable : 0u)
+           | ((events & (EPOLLHUP | EPOLLERR)) ? EventLoop::Hangup : 0u);
+}
+#endif
+} // namespace
+
+EventLoop::EventLoop()
+{
+#if defined(__linux__)
+    poller     = epoll_create1(EPOLL_CLOEXEC);
+    wake_read  = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+    wake_write = wake_read;
+    deadline   = timerfd_create(CLOCK_MONOTONIC, TFD_NONBLOCK | TFD_CLOEXEC);
+    for (int internal : {wake_read, deadline}) {
+        epoll_event event{};
+        event.events  = EPOLLIN;
+        event.data.fd = internal;
+        epoll_ctl(poller, EPOLL_CTL_ADD, internal, &event);
+    }
+#elif !defined(_WIN32)
+    int pipe_fds[2];
+    if (pipe(pipe_fds) == 0) {
+        for (int end : pipe_fds) {
+            fcntl(end, F_SETFL, fcntl(end, F_GETFL) | O_NONBLOCK);
+            fcntl(end, F_SETFD, FD_CLOEXEC);
+        }
+        wake_read  = pipe_fds[0];
+        wake_write = pipe_fds[1];
+    }
+#endif
+}
+
+EventLoop::~EventLoop()
+{
+#if !defined(_WIN32)
+    for (int internal : {poller, wake_read, deadline}) {
+        if (internal >= 0) {
+            close(internal);
+        }
+    }
+    if (wake_write >= 0 && wake_write != wake_read) {
+        close(wake_write);
+    }
+#endif
+}
+
+bool EventLoop::add_fd(int fd, uint32_t events, FdHandler handler)
+{
+#if defined(_WIN32)
+    (void)fd;
+    (void)events;
+    (void)handler;
+    return false;
+#else
+#if defined(__linux__)
+    epoll_event event{};
+    event.events  = to_epoll(events);
+    event.data.fd = fd;
+    int operation = sources.count(fd) != 0 ? EPOLL_CTL_MOD : EPOLL_CTL_ADD;
+    if (poller < 0 || epoll_ctl(poller, operation, fd, &event) != 0) {
+        return false;
+    }
+#endif
+    sources[fd] = {events, std::move(handler)};
+    return true;
+#endif
+}
+
+void EventLoop::remove_fd(int fd)
+{
+    if (sources.erase(fd) == 0) {
+        return;
+    }
+#if defined(__linux__)
+    epoll_ctl(poller, EPOLL_CTL_DEL, fd, nullptr);
+#endif
+}
+
+uint64_t EventLoop::add_timer(Clock::duration delay, Clock::duration period, TimerHandler handler)
+{
+    auto id = next_timer++;
+    timers.push_back({id, Clock::now() + delay, period, std::move(handler)});
+    return id;
+}
+
+void EventLoop::cancel_timer(uint64_t id)
+{
+    timers.erase(std::remove_if(timers.begin(), timers.end(),
+                                [id](const Timer &timer) { return timer.id == id; }),
+                 timers.end());
+}
+
+void EventLoop::wake()
+{
+    if (wake_pending.exchange(true, std::memory_order_acq_rel)) {
+        return;
+    }
+#if !defined(_WIN32)
+    if (wake_write >= 0) {
+        uint64_t one = 1;
+        // A full pipe already holds a wakeup, nothing is lost
+        [[maybe_unused]] auto written = write(wake_write, &one, wake_write == wake_read ? 8 : 1);
+    }
+#endif
+}
+
+bool EventLoop::wait_until(Clock::time_point until)
+{
+    while (true) {
+        auto now = Clock::now();
+        if (run_timers(now) || wake_pending.load(std::memory_order_acquire)) {
+            break;
+        }
+        if (now >= until) {
+            return false;
+        }
+
+        auto next = until;
+        for (auto &timer : timers) {
+            next = std::min(next, timer.due);
+        }
+        if (wait(next, true)) {
+            break;
+        }
+    }
+
+    // Consume the wakeup so the next wait blocks again
+    wake_pending.store(false, std::memory_order_release);
+#if !defined(_WIN32)
+    dispatch(wake_read, Readable);
+#endif
+    ++wakeups;
+    return true;
+}
+
+void EventLoop::dispatch_ready()
+{
+    run_timers(Clock::now());
+    wait(Clock::now(), false);
+}
+
+bool EventLoop::run_timers(Clock::time_point now)
+{
+    // Handlers may add or cancel timers, so collect the due ones first
+    std::vector<uint64_t> due;
+    for (auto &timer : timers) {
+        if (timer.due <= now) {
+            due.push_back(timer.id);
+        }
+    }
+    for (auto id : due) {
+        auto timer = std::find_if(timers.begin(), timers.end(),
+                                  [id](const Timer &candidate) { return candidate.id == id; });
+        if (timer == timers.end()) {
+            continue;
+        }
+        auto handler = timer->handler;
+        if (timer->period > Clock::duration::zero()) {
+            timer->due = std::max(timer->due + timer->period, now);
+        } else {
+            timers.erase(timer);
+        }
+        ++timer_fires;
+        handler();
+    }
+    return wake_pending.load(std::memory_order_acquire);
+}
+
+bool EventLoop::wait(Clock::time_point until, bool block)
+{
+#if defined(_WIN32)
+    if (block) {
+        std::this_thread::sleep_until(until);
+    }
+    return wake_pending.load(std::memory_order_acquire);
+#else
+    bool woken = false;
+#if defined(__linux__)
+    // An absolute timerfd keeps nanosecond precision that epoll's millisecond timeout lacks
+    int timeout = 0;
+    if (block) {
+        auto since_epoch =
+            std::chrono::duration_cast<std::chrono::nanoseconds>(until.time_since_epoch());
+        itimerspec spec{};
+        spec.it_value.tv_sec  = static_cast<time_t>(since_epoch.count() / 1000000000);
+        spec.it_value.tv_nsec = static_cast<long>(since_epoch.count() % 1000000000);
+        timerfd_settime(deadline, TFD_TIMER_ABSTIME, &spec, nullptr);
+        timeout = -1;
+    }
+
+    epoll_event events[64];
+    int         count = epoll_wait(poller, events, 64, timeout);
+    for (int i = 0; i < count; ++i) {
+        int fd = events[i].data.fd;
+        if (fd == deadline) {
+            uint64_t expirations;
+            [[maybe_unused]] auto read_bytes = read(deadline, &expirations, sizeof(expirations));
+            continue;
+        }
+        woken = dispatch(fd, from_epoll(events[i].events)) || woken;
+    }
+#else
+    std::vector<pollfd> fds;
+    fds.push_back({wake_read, POLLIN, 0});
+    for (auto &source : sources) {
+        short events = ((source.second.first & Readable) ? POLLIN : 0)
+                       | ((source.second.first & Writable) ? POLLOUT : 0);
+        fds.push_back({source.first, events, 0});
+    }
+
+    // poll() takes milliseconds, round up so the deadline is never missed by sleeping too little
+    int timeout = 0;
+    if (block) {
+        auto remaining = std::chrono::ceil<std::chrono::milliseconds>(until - Clock::now());
+        timeout        = static_cast<int>(std::max<int64_t>(0, remaining.count()));
+    }
+    int count = poll(fds.data(), static_cast<nfds_t>(fds.size()), timeout);
+    for (size_t i = 0; count > 0 && i < fds.size(); ++i) {
+        uint32_t events = ((fds[i].revents & POLLIN) ? Readable : 0u)
+                          | ((fds[i].revents & POLLOUT) ? Writable : 0u)
+                          | ((fds[i].revents & (POLLHUP | POLLERR)) ? Hangup : 0u);
+        if (events != 0) {
+            woken = dispatch(fds[i].fd, events) || woken;
+        }
+    }
+#endif
+    return woken || wake_pending.load(std::memory_order_acquire);
+#endif
+}
+
+bool EventLoop::dispatch(int fd, uint32_t events)
+{
+#if !defined(_WIN32)
+    if (fd == wake_read) {
+        uint64_t drained[8];
+        while (read(wake_read, drained, sizeof(drained)) > 0) {}
+        return true;
+    }
+#endif
+
+    // Copy the handler, it may remove its own source
+    auto source = sources.find(fd);
+    if (source == sources.end()) {
+        return false;
+    }
+    auto handler = source->second.second;
+    ++dispatched;
+    handler(fd, events);
+    return wake_pending.load(std::memory_order_acquire);
+}
+
+void EventLoop::write_json(JsonWriter &json) const
+{
+    json.field("fds", sources.size());
+    json.field("timers", timers.size());
+    json.field("dispatched", dispatched);
+    json.field("timer_fires", timer_fires);
+    json.field("wakeups", wakeups);
+}
@@ -0,0 +1,121 @@
+/*
+ * File descriptor and timer multiplexing on the engine's main thread, between iterations.
+ */
+
+#pragma once
+
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <functional>
+#include <unordered_map>
+#include <vector>
+
+class JsonWriter;
+
+/*
+ * Lets code embedding the host handle its own sockets, pipes and timers on the thread that drives
+ * the engine, instead of on a thread of its own. The frame scheduler waits for the next frame
+ * deadline in wait_until(), so handlers run while the host would otherwise sleep, and wake()
+ * (callable from any thread or a handler) ends the wait early so the next iteration runs at
+ * once, e.g. when input for the engine arrived.
+ *
+ * Linux uses epoll with a timerfd for the deadline and an eventfd for wake(); other POSIX systems
+ * use poll() and a pipe. On Windows nothing can be registered and wait_until() only sleeps.
+ *
+ * fd() is pollable itself (on Linux), so an outer event loop can nest this one.
+ */
+class EventLoop
+{
+  public:
+    using Clock = std::chrono::steady_clock;
+
+    enum Events : uint32_t {
+        Readable = 1 << 0,
+        Writable = 1 << 1,
+        Hangup   = 1 << 2, // Reported only, hangups and errors are always watched
+    };
+
+    using FdHandler    = std::function<void(int fd, uint32_t events)>;
+    using TimerHandler = std::function<void()>;
+
+    EventLoop();
+    ~EventLoop();
+
+    EventLoop(const EventLoop &)            = delete;
+    EventLoop &operator=(const EventLoop &) = delete;
+
+    /*
+     * Calls handler whenever fd has any of events. Returns false if fd cannot be watched.
+     */
+    bool add_fd(int fd, uint32_t events, FdHandler handler);
+    void remove_fd(int fd);
+
+    /*
+     * Calls handler once after delay, then every period unless it is zero. Returns an id for
+     * cancel_timer().
+     */
+    uint64_t add_timer(Clock::duration delay, Clock::duration period, TimerHandler handler);
+    void     cancel_timer(uint64_t id);
+
+    /*
+     * Ends the current or next wait_until() early. Safe from any thread and from signal handlers.
+     * The frame scheduler only waits in the loop while something is registered.
+     */
+    void wake();
+
+    /*
+     * Runs handlers until deadline. Returns true if wake() ended the wait early.
+     */
+    bool wait_until(Clock::time_point deadline);
+
+    /*
+     * Runs the handlers of whatever is ready without waiting.
+     */
+    void dispatch_ready();
+
+    /*
+     * True when anything is registered, so the host has to give the loop time between frames.
+     */
+    bool has_sources() const
+    {
+        return !sources.empty() || !timers.empty();
+    }
+
+    /*
+     * The multiplexer's own descriptor, -1 where it has none.
+     */
+    int fd() const
+    {
+        return poller;
+    }
+
+    void write_json(JsonWriter &json) const;
+
+  private:
+    struct Timer {
+        uint64_t          id;
+        Clock::time_point due;
+        Clock::duration   period;
+        TimerHandler      handler;
+    };
+
+    bool run_timers(Clock::time_point now);
+    bool wait(Clock::time_point until, bool block);
+    bool dispatch(int fd, uint32_t events);
+
+    std::unordered_map<int, std::pair<uint32_t, FdHandler>> sources;
+    std::vector<Timer>                                      timers;
+    uint64_t                                                next_timer = 1;
+
+    int poller     = -1; // epoll instance on Linux
+    int wake_read  = -1; // eventfd on Linux, read end of a pipe elsewhere
+    int wake_write = -1;
+    int deadline   = -1; // timerfd on Linux
+
+    std::atomic<bool> wake_pending{false};
+
+    uint64_t dispatched  = 0;
+    uint64_t timer_fires = 0;
+    uint64_t wakeups     = 0;
+};
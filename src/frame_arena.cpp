@@ -0,0 +1,178 @@
+#include "frame_arena.h"
+
+#include <algorithm>
+#include <mutex>
+
+#include "json_writer.h"
+
+namespace
+{
+constexpr size_t initial_block_size = 256 * 1024;
+
+// Every live arena, for end_frame(); guarded by registry_mutex like the totals below
+std::mutex                registry_mutex;
+std::vector<FrameArena *> registry;
+
+struct Totals {
+    uint64_t frames                 = 0;
+    uint64_t allocations            = 0;
+    uint64_t bytes                  = 0;
+    uint64_t last_frame_allocations = 0;
+    uint64_t last_frame_bytes       = 0;
+    uint64_t peak_frame_allocations = 0;
+    uint64_t peak_frame_bytes       = 0;
+    uint64_t heap_blocks            = 0; // Blocks allocated from the heap, ideally a few at startup
+    uint64_t reserved_bytes         = 0;
+};
+
+Totals totals;
+
+uintptr_t align_up(uintptr_t address, size_t alignment)
+{
+    return (address + alignment - 1) & ~static_cast<uintptr_t>(alignment - 1);
+}
+} // namespace
+
+FrameArena::FrameArena()
+{
+    std::lock_guard<std::mutex> lock(registry_mutex);
+    registry.push_back(this);
+}
+
+FrameArena::~FrameArena()
+{
+    std::lock_guard<std::mutex> lock(registry_mutex);
+    registry.erase(std::remove(registry.begin(), registry.end(), this), registry.end());
+    for (auto &block : blocks) {
+        totals.reserved_bytes -= block.size;
+    }
+}
+
+FrameArena &FrameArena::local()
+{
+    thread_local FrameArena arena;
+    return arena;
+}
+
+void *FrameArena::allocate(size_t size, size_t alignment)
+{
+    ++frame_allocations;
+    frame_bytes += size;
+
+    auto address = align_up(cursor, alignment);
+    if (blocks.empty() || address + size > limit) {
+        return grow(size, alignment);
+    }
+    cursor = address + size;
+    return reinterpret_cast<void *>(address);
+}
+
+void *FrameArena::grow(size_t size, size_t alignment)
+{
+    size_t block_size = blocks.empty() ? initial_block_size : blocks.back().size * 2;
+    block_size        = std::max(block_size, size + alignment);
+
+    Block block;
+    block.data = std::make_unique<uint8_t[]>(block_size);
+    block.size = block_size;
+    {
+        std::lock_guard<std::mutex> lock(registry_mutex);
+        ++totals.heap_blocks;
+        totals.reserved_bytes += block_size;
+    }
+
+    auto base = reinterpret_cast<uintptr_t>(block.data.get());
+    blocks.push_back(std::move(block));
+    limit        = base + block_size;
+    auto address = align_up(base, alignment);
+    cursor       = address + size;
+    return reinterpret_cast<void *>(address);
+}
+
+void FrameArena::reset()
+{
+    // Combine the blocks an iteration overflowed into, so the next one fits into a single block
+    if (blocks.size() > 1) {
+        size_t total = 0;
+        for (auto &block : blocks) {
+            total += block.size;
+        }
+        totals.reserved_bytes -= total;
+        blocks.clear();
+
+        Block block;
+        block.data = std::make_unique<uint8_t[]>(total);
+        block.size = total;
+        blocks.push_back(std::move(block));
+        ++totals.heap_blocks;
+        totals.reserved_bytes += total;
+    }
+
+    if (!blocks.empty()) {
+        cursor = reinterpret_cast<uintptr_t>(blocks.back().data.get());
+        limit  = cursor + blocks.back().size;
+    }
+    frame_allocations = 0;
+    frame_bytes       = 0;
+}
+
+void FrameArena::end_frame()
+{
+    std::lock_guard<std::mutex> lock(registry_mutex);
+
+    uint64_t allocations = 0;
+    uint64_t bytes       = 0;
+    for (auto arena : registry) {
+        allocations += arena->frame_allocations;
+        bytes += arena->frame_bytes;
+        if (arena->frame_allocations > 0) {
+            arena->reset();
+        }
+    }
+
+    ++totals.frames;
+    totals.allocations += allocations;
+    totals.bytes += bytes;
+    totals.last_frame_allocations = allocations;
+    totals.last_frame_bytes       = bytes;
+    totals.peak_frame_allocations = std::max(totals.peak_frame_allocations, allocations);
+    totals.peak_frame_bytes       = std::max(totals.peak_frame_bytes, bytes);
+}
+
+void FrameArena::trim()
+{
+    std::lock_guard<std::mutex> lock(registry_mutex);
+    for (auto arena : registry) {
+        for (auto &block : arena->blocks) {
+            totals.reserved_bytes -= block.size;
+        }
+        arena->blocks.clear();
+        arena->cursor = 0;
+        arena->limit  = 0;
+    }
+}
+
+uint64_t FrameArena::reserved_bytes()
+{
+    std::lock_guard<std::mutex> lock(registry_mutex);
+    return totals.reserved_bytes;
+}
+
+void FrameArena::write_json(JsonWriter &json)
+{
+    std::lock_guard<std::mutex> lock(registry_mutex);
+    json.field("arenas", registry.size());
+    json.field("frames", totals.frames);
+    json.field("allocations", totals.allocations);
+    json.field("bytes", totals.bytes);
+    json.field("allocations_per_frame",
+               totals.frames > 0 ? static_cast<double>(totals.allocations) / totals.frames : 0.0);
+    json.field("bytes_per_frame",
+               totals.frames > 0 ? static_cast<double>(totals.bytes) / totals.frames : 0.0);
+    json.field("last_frame_allocations", totals.last_frame_allocations);
+    json.field("last_frame_bytes", totals.last_frame_bytes);
+    json.field("peak_frame_allocations", totals.peak_frame_allocations);
+    json.field("peak_frame_bytes", totals.peak_frame_bytes);
+    json.field("heap_blocks", totals.heap_blocks);
+    json.field("reserved_bytes", totals.reserved_bytes);
+}
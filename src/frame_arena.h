@@ -0,0 +1,82 @@
+/*
+ * Per-thread bump allocators for scratch memory that only lives for one engine iteration.
+ */
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <vector>
+
+class JsonWriter;
+
+/*
+ * Hands out memory by bumping an offset into a block owned by the calling thread. Nothing is
+ * freed individually: the host resets every arena after each libgodot_iteration_godot_instance()
+ * call, so memory allocated during an iteration must not be used after it returns. Whenever an
+ * iteration outgrew its block, the next reset replaces the blocks with one of their combined
+ * size, so a steady workload stops touching the heap after a few frames.
+ *
+ * Any thread may allocate, including job system workers; each gets its own arena.
+ */
+class FrameArena
+{
+  public:
+    FrameArena();
+    ~FrameArena();
+
+    FrameArena(const FrameArena &)            = delete;
+    FrameArena &operator=(const FrameArena &) = delete;
+
+    /*
+     * Returns the calling thread's arena.
+     */
+    static FrameArena &local();
+
+    void *allocate(size_t size, size_t alignment = alignof(std::max_align_t));
+
+    template <typename T>
+    T *allocate_array(size_t count)
+    {
+        return static_cast<T *>(allocate(count * sizeof(T), alignof(T)));
+    }
+
+    /*
+     * Resets all arenas and accounts the iteration that just ended. Called by the host after
+     * each iteration, while no job is running.
+     */
+    static void end_frame();
+
+    /*
+     * Frees the blocks of every arena, giving back what the largest iteration so far needed.
+     * Same rules as end_frame(): only between iterations, after it.
+     */
+    static void trim();
+
+    /*
+     * Returns the bytes held in blocks over all arenas.
+     */
+    static uint64_t reserved_bytes();
+
+    /*
+     * Writes counters aggregated over all arenas.
+     */
+    static void write_json(JsonWriter &json);
+
+  private:
+    struct Block {
+        std::unique_ptr<uint8_t[]> data;
+        size_t                     size = 0;
+    };
+
+    void  reset();
+    void *grow(size_t size, size_t alignment);
+
+    std::vector<Block> blocks;
+    uintptr_t          cursor = 0; // Next free address in the last block
+    uintptr_t          limit  = 0; // End of the last block
+
+    uint64_t frame_allocations = 0;
+    uint64_t frame_bytes       = 0;
+};
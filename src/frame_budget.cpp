@@ -0,0 +1,96 @@
+#include "frame_budget.h"
+
+#include <algorithm>
+
+#include "godot_api.h"
+#include "json_writer.h"
+
+namespace
+{
+// Iterations below this share of the budget count towards raising the limit again
+constexpr double relaxed_share = 0.75;
+
+// Consecutive relaxed iterations before the limit is raised by one step
+constexpr uint64_t relax_after = 60;
+} // namespace
+
+FrameBudget::FrameBudget(double budget_ms)
+    : budget_ns(static_cast<uint64_t>(budget_ms * 1e6))
+{
+}
+
+void FrameBudget::start()
+{
+    auto engine = godot_singleton("Engine");
+    if (!engine.is_nil()) {
+        max_steps = std::max<int64_t>(1, engine.call("get_max_physics_steps_per_frame").to_int());
+    }
+    steps              = max_steps;
+    min_steps_applied  = std::min(min_steps_applied, steps);
+    behind             = false;
+    streak             = 0;
+    relaxed_iterations = 0;
+}
+
+void FrameBudget::finish()
+{
+    if (steps != max_steps) {
+        set_physics_steps(max_steps);
+    }
+}
+
+void FrameBudget::end_iteration(uint64_t iteration_ns)
+{
+    ++iterations;
+    behind = iteration_ns > budget_ns;
+
+    if (behind) {
+        ++overruns;
+        max_streak         = std::max(max_streak, ++streak);
+        max_overrun_ns     = std::max(max_overrun_ns, iteration_ns - budget_ns);
+        relaxed_iterations = 0;
+        if (steps > 1) {
+            set_physics_steps(steps / 2);
+            ++step_reductions;
+        }
+        return;
+    }
+
+    streak = 0;
+    if (static_cast<double>(iteration_ns) >= relaxed_share * static_cast<double>(budget_ns)) {
+        relaxed_iterations = 0;
+        return;
+    }
+    if (++relaxed_iterations >= relax_after && steps < max_steps) {
+        set_physics_steps(steps + 1);
+        ++step_increases;
+        relaxed_iterations = 0;
+    }
+}
+
+void FrameBudget::set_physics_steps(int64_t p_steps)
+{
+    auto engine = godot_singleton("Engine");
+    if (engine.is_nil()) {
+        return;
+    }
+    engine.call("set_max_physics_steps_per_frame", {GodotVariant::from_int(p_steps)});
+    steps             = p_steps;
+    min_steps_applied = std::min(min_steps_applied, steps);
+}
+
+void FrameBudget::write_json(JsonWriter &json) const
+{
+    json.field("budget_ms", static_cast<double>(budget_ns) / 1e6);
+    json.field("iterations", iterations);
+    json.field("overruns", overruns);
+    json.field("overrun_ratio", iterations > 0 ? static_cast<double>(overruns) / iterations : 0.0);
+    json.field("max_overrun_ms", static_cast<double>(max_overrun_ns) / 1e6);
+    json.field("max_consecutive_overruns", max_streak);
+    json.field("max_physics_steps", max_steps);
+    json.field("physics_steps", steps);
+    json.field("min_physics_steps", min_steps_applied == INT64_MAX ? max_steps : min_steps_applied);
+    json.field("step_reductions", step_reductions);
+    json.field("step_increases", step_increases);
+    json.field("skipped_extras", skipped_extras);
+}
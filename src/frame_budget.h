@@ -0,0 +1,74 @@
+/*
+ * Per-iteration time budget that trades physics catch-up for bounded frame latency.
+ */
+
+#pragma once
+
+#include <cstdint>
+
+class JsonWriter;
+
+/*
+ * Tracks each engine iteration against a fixed budget. When an iteration overruns, the number
+ * of physics steps the engine may run per iteration to catch up (the Engine singleton's
+ * max_physics_steps_per_frame) is halved, so a load spike briefly slows simulated time instead
+ * of making every following iteration longer. After a run of iterations well within budget,
+ * the limit is raised again one step at a time, up to the project's own setting.
+ *
+ * While behind, the host also skips its own optional per-iteration work (periodic reports and
+ * frame capture).
+ */
+class FrameBudget
+{
+  public:
+    explicit FrameBudget(double budget_ms);
+
+    /*
+     * Reads the project's physics step limit as the ceiling. Call after each project load.
+     */
+    void start();
+
+    /*
+     * Restores the project's physics step limit. Call before the project is unloaded.
+     */
+    void finish();
+
+    /*
+     * Accounts one iteration and adapts the physics step limit.
+     */
+    void end_iteration(uint64_t iteration_ns);
+
+    /*
+     * True when the last iteration overran, so optional host work should be skipped.
+     */
+    bool is_behind() const
+    {
+        return behind;
+    }
+
+    void skip_extras()
+    {
+        ++skipped_extras;
+    }
+
+    void write_json(JsonWriter &json) const;
+
+  private:
+    void set_physics_steps(int64_t steps);
+
+    uint64_t budget_ns;
+    int64_t  max_steps = 8; // Project setting, the engine default until start()
+    int64_t  steps     = 8; // Limit currently applied
+    bool     behind    = false;
+
+    uint64_t iterations         = 0;
+    uint64_t overruns           = 0;
+    uint64_t streak             = 0; // Consecutive overruns
+    uint64_t max_streak         = 0;
+    uint64_t max_overrun_ns     = 0;
+    uint64_t relaxed_iterations = 0; // Consecutive iterations well within budget
+    uint64_t step_reductions    = 0;
+    uint64_t step_increases     = 0;
+    uint64_t skipped_extras     = 0;
+    int64_t  min_steps_applied  = INT64_MAX; // Lowest limit in effect since the first start()
+};
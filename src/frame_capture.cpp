@@ -0,0 +1,292 @@
+#include "frame_capture.h"
+
+#include <chrono>
+#include <iostream>
+
+#include "json_writer.h"
+
+namespace
+{
+// RenderingDevice::DataFormat values of the color formats viewports render to
+constexpr int64_t rd_format_r8g8b8a8_unorm = 36;
+constexpr int64_t rd_format_r8g8b8a8_srgb  = 42;
+constexpr int64_t rd_format_b8g8r8a8_unorm = 43;
+constexpr int64_t rd_format_b8g8r8a8_srgb  = 49;
+
+// Image::Format values
+constexpr int64_t image_format_rgb8  = 4;
+constexpr int64_t image_format_rgba8 = 5;
+
+PixelFormat from_rd_format(int64_t format)
+{
+    switch (format) {
+        case rd_format_r8g8b8a8_unorm:
+        case rd_format_r8g8b8a8_srgb:
+            return PixelFormat::RGBA8;
+        case rd_format_b8g8r8a8_unorm:
+        case rd_format_b8g8r8a8_srgb:
+            return PixelFormat::BGRA8;
+        default:
+            return PixelFormat::Unknown;
+    }
+}
+
+PixelFormat from_image_format(int64_t format)
+{
+    switch (format) {
+        case image_format_rgb8:
+            return PixelFormat::RGB8;
+        case image_format_rgba8:
+            return PixelFormat::RGBA8;
+        default:
+            return PixelFormat::Unknown;
+    }
+}
+
+} // namespace
+
+int bytes_per_pixel(PixelFormat format)
+{
+    return format == PixelFormat::RGB8 ? 3 : 4;
+}
+
+const char *pixel_format_name(PixelFormat format)
+{
+    switch (format) {
+        case PixelFormat::RGBA8:
+            return "rgba8";
+        case PixelFormat::BGRA8:
+            return "bgra8";
+        case PixelFormat::RGB8:
+            return "rgb8";
+        default:
+            return "unknown";
+    }
+}
+
+FrameCapture::FrameCapture()
+    : owner(std::make_shared<FrameCapture *>(this))
+{
+}
+
+FrameCapture::~FrameCapture()
+{
+    *owner = nullptr;
+}
+
+bool FrameCapture::capture(uint64_t frame)
+{
+    if (!active) {
+        return false;
+    }
+    if (!resolved && !resolve_viewport()) {
+        disable("the renderer has no viewport texture (rendering must not be headless)");
+        return false;
+    }
+
+    // Skip the frame rather than stall when the GPU has not caught up with the ring
+    int   slot_index = next_slot;
+    auto &slot       = slots[static_cast<size_t>(slot_index)];
+    if (slot.in_flight) {
+        ++skipped;
+        return true;
+    }
+    slot.view.frame = frame;
+    slot.view.slot  = slot_index;
+    slot.requested  = std::chrono::steady_clock::now();
+    next_slot       = (next_slot + 1) % slot_count;
+
+    if (!rendering_device.is_nil()) {
+        if (!request_readback(slot_index)) {
+            disable("the viewport readback could not be started");
+            return false;
+        }
+        return true;
+    }
+
+    if (!read_image(slot) || slot.buffer.size() == 0) {
+        disable("viewport readback returned no data");
+        return false;
+    }
+    if (format == PixelFormat::Unknown) {
+        disable("unsupported viewport format");
+        return false;
+    }
+    deliver(slot);
+    return true;
+}
+
+void FrameCapture::reset()
+{
+    // Readbacks still in flight complete into a capture that is gone
+    *owner = nullptr;
+    owner  = std::make_shared<FrameCapture *>(this);
+
+    for (auto &slot : slots) {
+        slot.buffer    = GodotPackedByteArray();
+        slot.view      = CapturedFrame();
+        slot.in_flight = false;
+    }
+    next_slot        = 0;
+    resolved         = false;
+    rendering_server = GodotVariant();
+    rendering_device = GodotVariant();
+    viewport_texture = GodotVariant();
+    width            = 0;
+    height           = 0;
+}
+
+void FrameCapture::on_readback(void *userdata, const GDExtensionConstVariantPtr *args,
+                               GDExtensionInt arg_count)
+{
+    auto *request = static_cast<Request *>(userdata);
+    auto *capture = *request->owner;
+    if (capture != nullptr) {
+        auto data = arg_count > 0 ? GodotVariant::from_ptr(args[0]) : GodotVariant();
+        capture->complete_readback(request->slot, data);
+    }
+}
+
+void FrameCapture::free_request(void *userdata)
+{
+    delete static_cast<Request *>(userdata);
+}
+
+void FrameCapture::disable(const char *reason)
+{
+    std::cerr << "frame capture disabled: " << reason << std::endl;
+    active = false;
+}
+
+bool FrameCapture::resolve_viewport()
+{
+    rendering_server = godot_singleton("RenderingServer");
+    auto tree        = godot_singleton("Engine").call("get_main_loop");
+    auto root        = tree.call("get_root");
+    if (rendering_server.is_nil() || root.is_nil()) {
+        return false;
+    }
+
+    auto viewport    = root.call("get_viewport_rid");
+    viewport_texture = rendering_server.call("viewport_get_texture", {viewport});
+    if (!viewport_texture.call("is_valid").to_bool()) {
+        return false;
+    }
+
+    // Null on the Compatibility renderer
+    rendering_device = rendering_server.call("get_rendering_device");
+    resolved         = true;
+    return true;
+}
+
+bool FrameCapture::request_readback(int slot_index)
+{
+    auto texture = rendering_server.call("texture_get_rd_texture", {viewport_texture});
+    if (!texture.call("is_valid").to_bool()) {
+        return false;
+    }
+
+    auto *request     = new Request{owner, slot_index};
+    auto  on_complete = GodotVariant::new_callable(on_readback, request, free_request);
+    auto  error       = rendering_device.call("texture_get_data_async",
+                                              {texture, GodotVariant::from_int(0), on_complete});
+    if (error.to_int() != 0) {
+        return false;
+    }
+    slots[static_cast<size_t>(slot_index)].in_flight = true;
+    return true;
+}
+
+void FrameCapture::complete_readback(int slot_index, const GodotVariant &data)
+{
+    auto &slot     = slots[static_cast<size_t>(slot_index)];
+    slot.in_flight = false;
+    if (!active) {
+        return;
+    }
+
+    slot.buffer = GodotPackedByteArray(data);
+    if (slot.buffer.size() == 0) {
+        disable("viewport readback returned no data");
+        return;
+    }
+
+    // The format only needs to be looked up again when the viewport was resized
+    auto expected = static_cast<size_t>(width) * static_cast<size_t>(height)
+                    * static_cast<size_t>(bytes_per_pixel(format));
+    if (slot.buffer.size() != expected) {
+        auto texture        = rendering_server.call("texture_get_rd_texture", {viewport_texture});
+        auto texture_format = rendering_device.call("texture_get_format", {texture});
+        width    = static_cast<int>(texture_format.call("get_width").to_int());
+        height   = static_cast<int>(texture_format.call("get_height").to_int());
+        format   = from_rd_format(texture_format.call("get_format").to_int());
+        expected = static_cast<size_t>(width) * static_cast<size_t>(height)
+                   * static_cast<size_t>(bytes_per_pixel(format));
+
+        // HDR and other formats the encoders cannot take would be skipped on every frame
+        if (format == PixelFormat::Unknown) {
+            slot.buffer = GodotPackedByteArray();
+            disable("unsupported viewport format");
+            return;
+        }
+
+        // Read back before a resize that happened while it was in flight
+        if (slot.buffer.size() != expected) {
+            slot.buffer = GodotPackedByteArray();
+            ++skipped;
+            return;
+        }
+    }
+    deliver(slot);
+}
+
+bool FrameCapture::read_image(Slot &slot)
+{
+    auto image = rendering_server.call("texture_2d_get", {viewport_texture});
+    if (image.is_nil()) {
+        return false;
+    }
+
+    width       = static_cast<int>(image.call("get_width").to_int());
+    height      = static_cast<int>(image.call("get_height").to_int());
+    format      = from_image_format(image.call("get_format").to_int());
+    slot.buffer = GodotPackedByteArray(image.call("get_data"));
+    return true;
+}
+
+void FrameCapture::deliver(Slot &slot)
+{
+    slot.view.pixels = slot.buffer.data();
+    slot.view.size   = slot.buffer.size();
+    slot.view.width  = width;
+    slot.view.height = height;
+    slot.view.stride = width * bytes_per_pixel(format);
+    slot.view.format = format;
+
+    // From the request to the pixels being available, which spans frames when asynchronous
+    auto elapsed = std::chrono::steady_clock::now() - slot.requested;
+    readback_time.record(static_cast<uint64_t>(
+        std::chrono::duration_cast<std::chrono::nanoseconds>(elapsed).count()));
+    ++captured;
+    bytes += slot.view.size;
+
+    if (callback) {
+        callback(slot.view);
+    }
+}
+
+void FrameCapture::write_json(JsonWriter &json) const
+{
+    json.field("active", active);
+    json.field("asynchronous", !rendering_device.is_nil());
+    json.field("frames", captured);
+    json.field("skipped", skipped);
+    json.field("bytes", bytes);
+    json.field("width", width);
+    json.field("height", height);
+    json.field("format", pixel_format_name(format));
+
+    json.begin_object("readback");
+    readback_time.snapshot().write_json(json);
+    json.end_object();
+}
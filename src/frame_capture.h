@@ -0,0 +1,139 @@
+/*
+ * Readback of the rendered root viewport after each engine iteration.
+ */
+
+#pragma once
+
+#include <array>
+#include <chrono>
+#include <cstdint>
+#include <functional>
+#include <memory>
+
+#include "godot_api.h"
+#include "latency_histogram.h"
+
+class JsonWriter;
+
+enum class PixelFormat {
+    Unknown,
+    RGBA8,
+    BGRA8,
+    RGB8,
+};
+
+int         bytes_per_pixel(PixelFormat format);
+const char *pixel_format_name(PixelFormat format);
+
+/*
+ * Read-only view of one captured frame. The pixels stay valid until the slot is reused, which
+ * is at least slot_count - 1 captures later.
+ */
+struct CapturedFrame {
+    const uint8_t *pixels = nullptr;
+    size_t         size   = 0;
+    int            width  = 0;
+    int            height = 0;
+    int            stride = 0; // Bytes per row, rows are tightly packed
+    PixelFormat    format = PixelFormat::Unknown;
+    uint64_t       frame  = 0; // Host iteration the frame was captured after
+    int            slot   = 0;
+};
+
+/*
+ * Captures the root viewport into a fixed ring of slots and hands each frame to a callback.
+ *
+ * On RenderingDevice renderers (Forward+, Mobile) the color target is read back with
+ * RenderingDevice.texture_get_data_async(): every slot can have one readback in flight, and
+ * each frame is delivered from its completion callback once the GPU has copied it, a frame or
+ * two after it was rendered, so the iteration loop never waits for the GPU. When all slots are
+ * still in flight the frame is skipped instead. The Compatibility renderer has no asynchronous
+ * readback and goes through a synchronous RenderingServer.texture_2d_get().
+ *
+ * Either way the engine allocates a new PackedByteArray per readback; slots keep a reference
+ * to it instead of copying the pixels. Callbacks run on the thread the RenderingDevice
+ * processes its frames on, the main thread unless rendering runs on a separate thread.
+ * Rendering must be enabled: with --headless the dummy renderer has no pixels.
+ */
+class FrameCapture
+{
+  public:
+    static constexpr int slot_count = 3;
+
+    using Callback = std::function<void(const CapturedFrame &)>;
+
+    FrameCapture();
+    ~FrameCapture();
+
+    FrameCapture(const FrameCapture &)            = delete;
+    FrameCapture &operator=(const FrameCapture &) = delete;
+
+    void set_callback(Callback p_callback)
+    {
+        callback = std::move(p_callback);
+    }
+
+    /*
+     * Reads back the frame rendered by the iteration that just returned, or starts reading it
+     * back on RenderingDevice renderers. Returns false and stops capturing if the renderer
+     * provides no pixels.
+     */
+    bool capture(uint64_t frame);
+
+    /*
+     * Drops all slots and the cached viewport, e.g. before another project is loaded.
+     * Readbacks still in flight are discarded when they complete.
+     */
+    void reset();
+
+    bool is_active() const
+    {
+        return active;
+    }
+
+    void write_json(JsonWriter &json) const;
+
+  private:
+    struct Slot {
+        GodotPackedByteArray                  buffer;
+        CapturedFrame                         view;
+        bool                                  in_flight = false;
+        std::chrono::steady_clock::time_point requested;
+    };
+
+    // Userdata of one asynchronous readback; owner is cleared when the capture is reset
+    struct Request {
+        std::shared_ptr<FrameCapture *> owner;
+        int                             slot = 0;
+    };
+
+    static void on_readback(void *userdata, const GDExtensionConstVariantPtr *args,
+                            GDExtensionInt arg_count);
+    static void free_request(void *userdata);
+
+    bool resolve_viewport();
+    bool request_readback(int slot_index);
+    void complete_readback(int slot_index, const GodotVariant &data);
+    bool read_image(Slot &slot);
+    void deliver(Slot &slot);
+    void disable(const char *reason);
+
+    std::array<Slot, slot_count>    slots;
+    int                             next_slot = 0;
+    Callback                        callback;
+    bool                            active   = true;
+    bool                            resolved = false;
+    std::shared_ptr<FrameCapture *> owner;
+
+    GodotVariant rendering_server;
+    GodotVariant rendering_device;
+    GodotVariant viewport_texture; // RID of the root viewport's color texture
+    int          width  = 0;
+    int          height = 0;
+    PixelFormat  format = PixelFormat::Unknown;
+
+    uint64_t         captured = 0;
+    uint64_t         skipped  = 0; // All slots in flight, or resized while in flight
+    uint64_t         bytes    = 0;
+    LatencyHistogram readback_time;
+};
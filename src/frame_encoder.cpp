@@ -0,0 +1,518 @@
+#include "frame_encoder.h"
+
+#include <algorithm>
+#include <array>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <iostream>
+
+#if !defined(_WIN32)
+#include <csignal>
+#endif
+
+#include "json_writer.h"
+
+class FrameEncoder::Output
+{
+  public:
+    virtual ~Output() = default;
+
+    /*
+     * Prepares the destination. Returns false if it cannot be used.
+     */
+    virtual bool open() = 0;
+
+    /*
+     * Encodes one frame. Returns the number of bytes written, 0 on failure.
+     */
+    virtual size_t write(const CapturedFrame &frame) = 0;
+
+    virtual void close()
+    {
+    }
+};
+
+namespace
+{
+using Clock = std::chrono::steady_clock;
+
+uint64_t nanoseconds_since(Clock::time_point start)
+{
+    return static_cast<uint64_t>(
+        std::chrono::duration_cast<std::chrono::nanoseconds>(Clock::now() - start).count());
+}
+
+const std::array<uint32_t, 256> crc_table = [] {
+    std::array<uint32_t, 256> table{};
+    for (uint32_t n = 0; n < 256; ++n) {
+        uint32_t c = n;
+        for (int k = 0; k < 8; ++k) {
+            c = (c & 1) ? 0xedb88320u ^ (c >> 1) : c >> 1;
+        }
+        table[n] = c;
+    }
+    return table;
+}();
+
+uint32_t crc32(const uint8_t *data, size_t size)
+{
+    uint32_t c = 0xffffffffu;
+    for (size_t i = 0; i < size; ++i) {
+        c = crc_table[(c ^ data[i]) & 0xff] ^ (c >> 8);
+    }
+    return c ^ 0xffffffffu;
+}
+
+uint32_t adler32(const uint8_t *data, size_t size)
+{
+    // 5552 is the largest run that cannot overflow the sums before the modulo
+    uint32_t a = 1;
+    uint32_t b = 0;
+    while (size > 0) {
+        size_t run = std::min<size_t>(size, 5552);
+        for (size_t i = 0; i < run; ++i) {
+            a += data[i];
+            b += a;
+        }
+        a %= 65521;
+        b %= 65521;
+        data += run;
+        size -= run;
+    }
+    return (b << 16) | a;
+}
+
+void put_u32(std::vector<uint8_t> &out, uint32_t value)
+{
+    out.push_back(static_cast<uint8_t>(value >> 24));
+    out.push_back(static_cast<uint8_t>(value >> 16));
+    out.push_back(static_cast<uint8_t>(value >> 8));
+    out.push_back(static_cast<uint8_t>(value));
+}
+
+/*
+ * Appends a chunk whose data is produced by fill(), computing the length and CRC afterwards.
+ */
+template <typename Fill>
+void put_chunk(std::vector<uint8_t> &out, const char *type, Fill fill)
+{
+    size_t start = out.size();
+    put_u32(out, 0);
+    out.insert(out.end(), type, type + 4);
+    fill(out);
+
+    auto length = static_cast<uint32_t>(out.size() - start - 8);
+    for (int i = 0; i < 4; ++i) {
+        out[start + static_cast<size_t>(i)] = static_cast<uint8_t>(length >> (24 - 8 * i));
+    }
+    put_u32(out, crc32(out.data() + start + 4, out.size() - start - 4));
+}
+
+/*
+ * Writes every frame to one file as tightly packed rows, e.g. for ffmpeg -f rawvideo.
+ */
+class RawOutput : public FrameEncoder::Output
+{
+  public:
+    explicit RawOutput(std::string p_path)
+        : path(std::move(p_path))
+    {
+    }
+
+    bool open() override
+    {
+        file.open(path, std::ios::binary | std::ios::trunc);
+        if (!file) {
+            std::cerr << "failed to open encoder output: " << path << std::endl;
+            return false;
+        }
+        return true;
+    }
+
+    size_t write(const CapturedFrame &frame) override
+    {
+        file.write(reinterpret_cast<const char *>(frame.pixels),
+                   static_cast<std::streamsize>(frame.size));
+        return file ? frame.size : 0;
+    }
+
+    void close() override
+    {
+        file.close();
+    }
+
+  private:
+    std::string   path;
+    std::ofstream file;
+};
+
+/*
+ * Writes frame_<n>.png files into a directory. The image data is stored uncompressed (deflate
+ * block type 0): encoding then costs little more than the file write and needs no zlib, at the
+ * price of files as large as the raw frame.
+ */
+class PngOutput : public FrameEncoder::Output
+{
+  public:
+    explicit PngOutput(std::string p_directory)
+        : directory(std::move(p_directory))
+    {
+    }
+
+    bool open() override
+    {
+        std::error_code error;
+        std::filesystem::create_directories(directory, error);
+        if (error) {
+            std::cerr << "failed to create encoder output directory " << directory.string()
+                      << ": " << error.message() << std::endl;
+            return false;
+        }
+        return true;
+    }
+
+    size_t write(const CapturedFrame &frame) override
+    {
+        encode(frame);
+
+        char name[32];
+        std::snprintf(name, sizeof(name), "frame_%06llu.png",
+                      static_cast<unsigned long long>(sequence++));
+        std::ofstream file(directory / name, std::ios::binary | std::ios::trunc);
+        file.write(reinterpret_cast<const char *>(png.data()),
+                   static_cast<std::streamsize>(png.size()));
+        return file ? png.size() : 0;
+    }
+
+  private:
+    void encode(const CapturedFrame &frame)
+    {
+        int  channels = bytes_per_pixel(frame.format);
+        auto row_size = static_cast<size_t>(frame.width) * static_cast<size_t>(channels);
+
+        // Scanlines with filter type 0, swizzled to RGBA where needed
+        scanlines.resize((row_size + 1) * static_cast<size_t>(frame.height));
+        for (int y = 0; y < frame.height; ++y) {
+            uint8_t       *dst = scanlines.data() + static_cast<size_t>(y) * (row_size + 1);
+            const uint8_t *src = frame.pixels + static_cast<size_t>(y) * frame.stride;
+            dst[0]             = 0;
+            std::memcpy(dst + 1, src, row_size);
+            if (frame.format == PixelFormat::BGRA8) {
+                for (size_t x = 1; x < row_size + 1; x += 4) {
+                    std::swap(dst[x], dst[x + 2]);
+                }
+            }
+        }
+
+        static const uint8_t signature[] = {0x89, 'P', 'N', 'G', '\r', '\n', 0x1a, '\n'};
+        png.assign(signature, signature + sizeof(signature));
+
+        put_chunk(png, "IHDR", [&](std::vector<uint8_t> &out) {
+            put_u32(out, static_cast<uint32_t>(frame.width));
+            put_u32(out, static_cast<uint32_t>(frame.height));
+            out.push_back(8);                     // Bit depth
+            out.push_back(channels == 4 ? 6 : 2); // Color type RGBA or RGB
+            out.push_back(0);                     // Compression
+            out.push_back(0);                     // Filter
+            out.push_back(0);                     // Interlace
+        });
+
+        put_chunk(png, "IDAT", [&](std::vector<uint8_t> &out) {
+            out.push_back(0x78); // zlib header: deflate, 32K window, no preset dictionary
+            out.push_back(0x01);
+            size_t offset = 0;
+            do {
+                size_t block = std::min<size_t>(scanlines.size() - offset, 65535);
+                bool   last  = offset + block == scanlines.size();
+                out.push_back(last ? 1 : 0);
+                out.push_back(static_cast<uint8_t>(block));
+                out.push_back(static_cast<uint8_t>(block >> 8));
+                out.push_back(static_cast<uint8_t>(~block));
+                out.push_back(static_cast<uint8_t>(~block >> 8));
+                out.insert(out.end(), scanlines.begin() + static_cast<ptrdiff_t>(offset),
+                           scanlines.begin() + static_cast<ptrdiff_t>(offset + block));
+                offset += block;
+            } while (offset < scanlines.size());
+            put_u32(out, adler32(scanlines.data(), scanlines.size()));
+        });
+
+        put_chunk(png, "IEND", [](std::vector<uint8_t> &) {});
+    }
+
+    std::filesystem::path directory;
+    std::vector<uint8_t>  scanlines; // Reused between frames
+    std::vector<uint8_t>  png;
+    uint64_t              sequence = 0;
+};
+
+/*
+ * Pipes raw frames into ffmpeg, which encodes them with libx264. ffmpeg is an optional runtime
+ * dependency looked up on PATH; the pipe is opened with the size of the first frame and frames
+ * of any other size are rejected.
+ */
+class H264Output : public FrameEncoder::Output
+{
+  public:
+    H264Output(std::string p_path, double p_frame_rate)
+        : path(std::move(p_path))
+        , frame_rate(p_frame_rate)
+    {
+    }
+
+    ~H264Output() override
+    {
+        close();
+    }
+
+    bool open() override
+    {
+#if defined(_WIN32)
+        bool found = std::system("ffmpeg -version >NUL 2>&1") == 0;
+#else
+        bool found = std::system("ffmpeg -version >/dev/null 2>&1") == 0;
+
+        // A failing ffmpeg must surface as a write error, not kill the host
+        std::signal(SIGPIPE, SIG_IGN);
+#endif
+        if (!found) {
+            std::cerr << "ffmpeg was not found on PATH, it is required for H.264 encoding"
+                      << std::endl;
+        }
+        return found;
+    }
+
+    size_t write(const CapturedFrame &frame) override
+    {
+        if (pipe == nullptr && !start(frame)) {
+            return 0;
+        }
+        if (frame.width != width || frame.height != height || frame.format != format) {
+            return 0;
+        }
+        return std::fwrite(frame.pixels, 1, frame.size, pipe) == frame.size ? frame.size : 0;
+    }
+
+    void close() override
+    {
+        if (pipe == nullptr) {
+            return;
+        }
+#if defined(_WIN32)
+        int status = _pclose(pipe);
+#else
+        int status = pclose(pipe);
+#endif
+        pipe = nullptr;
+        if (status != 0) {
+            std::cerr << "ffmpeg exited with status " << status << std::endl;
+        }
+    }
+
+  private:
+    bool start(const CapturedFrame &frame)
+    {
+        const char *pixel_format = frame.format == PixelFormat::BGRA8  ? "bgra"
+                                   : frame.format == PixelFormat::RGB8 ? "rgb24"
+                                                                       : "rgba";
+
+        std::string command = "ffmpeg -loglevel error -y -f rawvideo -pix_fmt ";
+        command += pixel_format;
+        command += " -s " + std::to_string(frame.width) + "x" + std::to_string(frame.height);
+        command += " -r " + std::to_string(frame_rate);
+        command += " -i - -an -c:v libx264 -preset veryfast -pix_fmt yuv420p ";
+#if defined(_WIN32)
+        command += "\"" + path + "\"";
+        pipe = _popen(command.c_str(), "wb");
+#else
+        // Single-quote the path for the shell
+        command += "'";
+        for (char c : path) {
+            command += c == '\'' ? std::string("'\\''") : std::string(1, c);
+        }
+        command += "'";
+        pipe = popen(command.c_str(), "w");
+#endif
+        if (pipe == nullptr) {
+            std::cerr << "failed to start ffmpeg" << std::endl;
+            return false;
+        }
+        width  = frame.width;
+        height = frame.height;
+        format = frame.format;
+        return true;
+    }
+
+    std::string path;
+    double      frame_rate;
+    FILE       *pipe   = nullptr;
+    int         width  = 0;
+    int         height = 0;
+    PixelFormat format = PixelFormat::Unknown;
+};
+
+const char *format_name(EncodeFormat format)
+{
+    switch (format) {
+        case EncodeFormat::Raw:
+            return "raw";
+        case EncodeFormat::Png:
+            return "png";
+        case EncodeFormat::H264:
+            return "h264";
+        default:
+            return "none";
+    }
+}
+} // namespace
+
+FrameEncoder::FrameEncoder(EncodeFormat p_format, std::string p_output, QueuePolicy p_policy,
+                           int queue_size, double p_frame_rate)
+    : format(p_format)
+    , output_path(std::move(p_output))
+    , policy(p_policy)
+    , frame_rate(p_frame_rate)
+    , slots(static_cast<size_t>(std::max(queue_size, 1)))
+{
+}
+
+FrameEncoder::~FrameEncoder()
+{
+    stop();
+}
+
+bool FrameEncoder::start()
+{
+    switch (format) {
+        case EncodeFormat::Raw:
+            output = std::make_unique<RawOutput>(output_path);
+            break;
+        case EncodeFormat::Png:
+            output = std::make_unique<PngOutput>(output_path);
+            break;
+        case EncodeFormat::H264:
+            output = std::make_unique<H264Output>(output_path, frame_rate);
+            break;
+        default:
+            return false;
+    }
+    if (!output->open()) {
+        output.reset();
+        return false;
+    }
+
+    thread = std::thread([this] { run(); });
+    return true;
+}
+
+bool FrameEncoder::submit(const CapturedFrame &frame)
+{
+    ++submitted;
+
+    auto h = head.load(std::memory_order_relaxed);
+    auto t = tail.load(std::memory_order_acquire);
+    if (h - t == slots.size()) {
+        if (policy == QueuePolicy::Drop || !thread.joinable()) {
+            ++dropped;
+            return false;
+        }
+
+        ++blocked;
+        auto started = Clock::now();
+        do {
+            tail.wait(t, std::memory_order_acquire);
+            t = tail.load(std::memory_order_acquire);
+        } while (h - t == slots.size());
+        blocked_ns += nanoseconds_since(started);
+    }
+    queue_depth = std::max(queue_depth, h - t + 1);
+
+    // Reuses the slot's capacity, so this only allocates when frames grow
+    auto &slot = slots[h % slots.size()];
+    slot.pixels.assign(frame.pixels, frame.pixels + frame.size);
+    slot.width  = frame.width;
+    slot.height = frame.height;
+    slot.format = frame.format;
+    slot.frame  = frame.frame;
+
+    head.store(h + 1, std::memory_order_release);
+    wakeups.fetch_add(1, std::memory_order_release);
+    wakeups.notify_one();
+    return true;
+}
+
+void FrameEncoder::stop()
+{
+    if (!thread.joinable()) {
+        return;
+    }
+
+    stopping.store(true, std::memory_order_release);
+    wakeups.fetch_add(1, std::memory_order_release);
+    wakeups.notify_one();
+    thread.join();
+}
+
+void FrameEncoder::run()
+{
+    while (true) {
+        // Read the wakeup count first so a frame queued after the check still wakes us
+        auto signal = wakeups.load(std::memory_order_acquire);
+        auto t      = tail.load(std::memory_order_relaxed);
+        if (t == head.load(std::memory_order_acquire)) {
+            if (stopping.load(std::memory_order_acquire)) {
+                break;
+            }
+            wakeups.wait(signal, std::memory_order_acquire);
+            continue;
+        }
+
+        auto         &slot = slots[t % slots.size()];
+        CapturedFrame frame;
+        frame.pixels = slot.pixels.data();
+        frame.size   = slot.pixels.size();
+        frame.width  = slot.width;
+        frame.height = slot.height;
+        frame.stride = slot.width * bytes_per_pixel(slot.format);
+        frame.format = slot.format;
+        frame.frame  = slot.frame;
+        frame.slot   = static_cast<int>(t % slots.size());
+
+        auto   started = Clock::now();
+        size_t written = output->write(frame);
+        encode_time.record(nanoseconds_since(started));
+        if (written > 0) {
+            encoded.fetch_add(1, std::memory_order_relaxed);
+            encoded_bytes.fetch_add(written, std::memory_order_relaxed);
+        } else {
+            failed.fetch_add(1, std::memory_order_relaxed);
+        }
+
+        tail.store(t + 1, std::memory_order_release);
+        tail.notify_one();
+    }
+
+    output->close();
+}
+
+void FrameEncoder::write_json(JsonWriter &json) const
+{
+    json.field("format", format_name(format));
+    json.field("policy", policy == QueuePolicy::Drop ? "drop" : "block");
+    json.field("queue_size", slots.size());
+    json.field("submitted", submitted);
+    json.field("encoded", encoded.load(std::memory_order_relaxed));
+    json.field("failed", failed.load(std::memory_order_relaxed));
+    json.field("dropped", dropped);
+    json.field("blocked", blocked);
+    json.field("blocked_s", static_cast<double>(blocked_ns) / 1e9);
+    json.field("max_queue_depth", queue_depth);
+    json.field("bytes_written", encoded_bytes.load(std::memory_order_relaxed));
+
+    json.begin_object("encode");
+    encode_time.snapshot().write_json(json);
+    json.end_object();
+}
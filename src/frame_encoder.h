@@ -0,0 +1,109 @@
+/*
+ * Background encoding of captured frames, decoupled from the iteration loop by a bounded ring.
+ */
+
+#pragma once
+
+#include <atomic>
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "frame_capture.h"
+#include "latency_histogram.h"
+
+class JsonWriter;
+
+enum class EncodeFormat {
+    None,
+    Raw,  // Every frame appended to one file as raw pixels
+    Png,  // One numbered PNG file per frame in a directory
+    H264, // Piped to an ffmpeg process found on PATH
+};
+
+/*
+ * What submit() does when the encoder falls behind and every queue slot is taken.
+ */
+enum class QueuePolicy {
+    Drop,  // Discard the new frame and count it
+    Block, // Wait for the encoder to free a slot
+};
+
+/*
+ * Hands captured frames to an encoder thread. Frames are copied into preallocated queue slots,
+ * because the capture ring reuses its buffers long before a slow encoder gets to them. The
+ * queue is a single-producer, single-consumer ring: submit() never takes a lock and only
+ * touches the encoder thread's state through atomics, so with the drop policy the iteration
+ * loop never waits for disk or encoder work.
+ */
+class FrameEncoder
+{
+  public:
+    /*
+     * Destination of the encoded frames, one implementation per format in frame_encoder.cpp.
+     */
+    class Output;
+
+    FrameEncoder(EncodeFormat p_format, std::string p_output, QueuePolicy p_policy,
+                 int queue_size, double p_frame_rate);
+    ~FrameEncoder();
+
+    FrameEncoder(const FrameEncoder &)            = delete;
+    FrameEncoder &operator=(const FrameEncoder &) = delete;
+
+    /*
+     * Starts the encoder thread. Returns false if the output cannot be created.
+     */
+    bool start();
+
+    /*
+     * Queues a copy of the frame. Returns false if it was dropped.
+     */
+    bool submit(const CapturedFrame &frame);
+
+    /*
+     * Encodes every queued frame, closes the output and joins the encoder thread.
+     */
+    void stop();
+
+    void write_json(JsonWriter &json) const;
+
+  private:
+    struct Slot {
+        std::vector<uint8_t> pixels; // Keeps its capacity, only grows when the frame does
+        int                  width  = 0;
+        int                  height = 0;
+        PixelFormat          format = PixelFormat::Unknown;
+        uint64_t             frame  = 0;
+    };
+
+    void run();
+
+    EncodeFormat format;
+    std::string  output_path;
+    QueuePolicy  policy;
+    double       frame_rate;
+
+    std::vector<Slot>       slots;
+    std::atomic<uint64_t>   head{0};    // Next slot to fill, written by submit()
+    std::atomic<uint64_t>   tail{0};    // Next slot to encode, written by the encoder thread
+    std::atomic<uint32_t>   wakeups{0}; // Bumped to wake the encoder thread
+    std::atomic<bool>       stopping{false};
+    std::unique_ptr<Output> output;
+    std::thread             thread;
+
+    // Written by submit() only
+    uint64_t submitted   = 0;
+    uint64_t dropped     = 0;
+    uint64_t blocked     = 0;
+    uint64_t blocked_ns  = 0;
+    uint64_t queue_depth = 0; // High-water mark
+
+    // Written by the encoder thread
+    std::atomic<uint64_t> encoded{0};
+    std::atomic<uint64_t> failed{0};
+    std::atomic<uint64_t> encoded_bytes{0};
+    LatencyHistogram      encode_time;
+};
@@ -0,0 +1,143 @@
+#include "frame_scheduler.h"
+
+#include <thread>
+
+#if defined(_WIN32)
+#include <windows.h>
+#ifndef CREATE_WAITABLE_TIMER_HIGH_RESOLUTION
+#define CREATE_WAITABLE_TIMER_HIGH_RESOLUTION 0x00000002
+#endif
+#else
+#include <cerrno>
+#include <ctime>
+#endif
+
+#include "event_loop.h"
+#include "godot_api.h"
+
+namespace
+{
+// OS sleeps overshoot by up to this much; the rest of the wait is spent yielding
+#if defined(__linux__)
+constexpr auto spin_margin = std::chrono::microseconds(50);
+#else
+constexpr auto spin_margin = std::chrono::microseconds(250);
+#endif
+} // namespace
+
+FrameScheduler::FrameScheduler()
+{
+#if defined(_WIN32)
+    timer = CreateWaitableTimerExW(nullptr, nullptr, CREATE_WAITABLE_TIMER_HIGH_RESOLUTION,
+                                   TIMER_ALL_ACCESS);
+    if (timer == nullptr) {
+        // Pre-1803 Windows has no high resolution timers, fall back to a regular one
+        timer = CreateWaitableTimerExW(nullptr, nullptr, 0, TIMER_ALL_ACCESS);
+    }
+#endif
+}
+
+FrameScheduler::~FrameScheduler()
+{
+#if defined(_WIN32)
+    if (timer != nullptr) {
+        CloseHandle(timer);
+    }
+#endif
+}
+
+void FrameScheduler::configure(FramePacing pacing, double p_rate_hz)
+{
+    mode = pacing;
+    if (p_rate_hz > 0.0) {
+        rate_hz = p_rate_hz;
+    }
+    interval = std::chrono::duration_cast<Clock::duration>(
+        std::chrono::duration<double>(1.0 / rate_hz));
+    deadline = Clock::now();
+}
+
+void FrameScheduler::follow_display()
+{
+    if (mode != FramePacing::VSync) {
+        return;
+    }
+
+    auto display = godot_singleton("DisplayServer");
+    if (display.is_nil()) {
+        return;
+    }
+
+    // Returns -1 when the refresh rate cannot be determined
+    double refresh_rate = display.call("screen_get_refresh_rate").to_float();
+    if (refresh_rate > 0.0) {
+        configure(FramePacing::VSync, refresh_rate);
+    }
+}
+
+void FrameScheduler::wait_for_next_frame()
+{
+    // Handlers still run when there is no time left to wait in
+    bool has_handlers = loop != nullptr && loop->has_sources();
+    if (mode == FramePacing::Unlimited) {
+        if (has_handlers) {
+            loop->dispatch_ready();
+        }
+        return;
+    }
+
+    deadline += interval;
+
+    auto now = Clock::now();
+    if (now >= deadline) {
+        // Running late; re-anchor when a whole frame was missed rather than bursting
+        if (now - deadline > interval) {
+            deadline = now;
+        }
+        if (has_handlers) {
+            loop->dispatch_ready();
+        }
+        return;
+    }
+
+    if (has_handlers) {
+        if (loop->wait_until(deadline - spin_margin)) {
+            // Woken for new input: run the frame now and pace the following ones from here
+            deadline = Clock::now();
+            return;
+        }
+    } else if (deadline - now > spin_margin) {
+        sleep_until(deadline - spin_margin);
+    }
+    while (Clock::now() < deadline) {
+        std::this_thread::yield();
+    }
+}
+
+void FrameScheduler::sleep_until(Clock::time_point target)
+{
+#if defined(_WIN32)
+    auto remaining = target - Clock::now();
+    if (timer != nullptr && remaining > Clock::duration::zero()) {
+        // Negative due times are relative, in 100ns units
+        LARGE_INTEGER due;
+        due.QuadPart = -static_cast<LONGLONG>(
+            std::chrono::duration_cast<std::chrono::nanoseconds>(remaining).count() / 100);
+        if (SetWaitableTimer(timer, &due, 0, nullptr, nullptr, FALSE)) {
+            WaitForSingleObject(timer, INFINITE);
+            return;
+        }
+    }
+    std::this_thread::sleep_until(target);
+#elif defined(__linux__)
+    // steady_clock is CLOCK_MONOTONIC on Linux, so an absolute sleep avoids drift from wakeups
+    auto since_epoch =
+        std::chrono::duration_cast<std::chrono::nanoseconds>(target.time_since_epoch());
+    timespec ts;
+    ts.tv_sec  = static_cast<time_t>(since_epoch.count() / 1000000000);
+    ts.tv_nsec = static_cast<long>(since_epoch.count() % 1000000000);
+    while (clock_nanosleep(CLOCK_MONOTONIC, TIMER_ABSTIME, &ts, nullptr) == EINTR) {}
+#else
+    std::this_thread::sleep_until(target);
+#endif
+}
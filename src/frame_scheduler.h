@@ -0,0 +1,89 @@
+/*
+ * Host-side frame pacing for the engine iteration loop.
+ */
+
+#pragma once
+
+#include <chrono>
+
+class EventLoop;
+
+/*
+ * How the host paces calls to libgodot_iteration_godot_instance().
+ */
+enum class FramePacing {
+    Unlimited,  // Iterate as fast as possible (the engine may still pace itself)
+    TargetRate, // Iterate at a fixed rate in Hz
+    VSync,      // Iterate at the display refresh rate reported by the engine
+};
+
+/*
+ * Sleeps between iterations so that each one starts on an absolute deadline.
+ *
+ * Deadlines advance by a fixed interval rather than from the end of the previous frame, so
+ * per-frame jitter does not accumulate. If the host falls more than one interval behind, the
+ * schedule is re-anchored to now instead of bursting to catch up.
+ */
+class FrameScheduler
+{
+  public:
+    using Clock = std::chrono::steady_clock;
+
+    FrameScheduler();
+    ~FrameScheduler();
+
+    FrameScheduler(const FrameScheduler &)            = delete;
+    FrameScheduler &operator=(const FrameScheduler &) = delete;
+
+    /*
+     * Selects the pacing mode. The rate is only used for FramePacing::TargetRate and as the
+     * fallback for FramePacing::VSync until follow_display() is called.
+     */
+    void configure(FramePacing pacing, double rate_hz);
+
+    /*
+     * Queries the display refresh rate through the engine when following vsync. Needs a loaded
+     * project; keeps the previous rate if the display reports none (e.g. headless).
+     */
+    void follow_display();
+
+    /*
+     * Gives the time spent waiting for deadlines to loop's handlers. A wake() ends the wait and
+     * re-anchors the schedule, so the next frame starts at once. With unlimited pacing, ready
+     * handlers run between iterations without waiting.
+     */
+    void set_event_loop(EventLoop *p_loop)
+    {
+        loop = p_loop;
+    }
+
+    /*
+     * Blocks until the next frame is due. Returns immediately when pacing is unlimited.
+     */
+    void wait_for_next_frame();
+
+    FramePacing pacing() const
+    {
+        return mode;
+    }
+
+    double rate() const
+    {
+        return rate_hz;
+    }
+
+    Clock::time_point next_deadline() const
+    {
+        return deadline;
+    }
+
+  private:
+    void sleep_until(Clock::time_point target);
+
+    FramePacing       mode     = FramePacing::Unlimited;
+    double            rate_hz  = 60.0;
+    Clock::duration   interval = Clock::duration::zero();
+    Clock::time_point deadline;
+    EventLoop        *loop  = nullptr;
+    void             *timer = nullptr; // Waitable timer handle on Windows
+};
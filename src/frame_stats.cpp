@@ -0,0 +1,31 @@
+#include "frame_stats.h"
+
+#include "json_writer.h"
+
+void FrameStats::write_json(JsonWriter &json)
+{
+    auto iteration_now = iteration.snapshot();
+    auto frame_now     = frame.snapshot();
+
+    json.field("iterations", iterations);
+
+    json.begin_object("iteration");
+    iteration_now.write_json(json);
+    json.end_object();
+
+    json.begin_object("frame");
+    frame_now.write_json(json);
+    json.end_object();
+
+    json.begin_object("window");
+    json.begin_object("iteration");
+    iteration_now.since(last_iteration).write_json(json);
+    json.end_object();
+    json.begin_object("frame");
+    frame_now.since(last_frame).write_json(json);
+    json.end_object();
+    json.end_object();
+
+    last_iteration = iteration_now;
+    last_frame     = frame_now;
+}
@@ -0,0 +1,81 @@
+/*
+ * Per-iteration timing of the engine loop.
+ */
+
+#pragma once
+
+#include <chrono>
+#include <cstdint>
+
+#include "latency_histogram.h"
+
+class JsonWriter;
+
+/*
+ * Records how long each libgodot_iteration_godot_instance() call takes and the time between
+ * the starts of consecutive iterations (the frame time, which includes host pacing).
+ */
+class FrameStats
+{
+  public:
+    using Clock = std::chrono::steady_clock;
+
+    void begin_iteration()
+    {
+        auto now = Clock::now();
+        if (iterations > 0) {
+            frame.record(elapsed_ns(last_start, now));
+        }
+        last_start = now;
+    }
+
+    void end_iteration()
+    {
+        last_iteration_ns = elapsed_ns(last_start, Clock::now());
+        iteration.record(last_iteration_ns);
+        ++iterations;
+    }
+
+    uint64_t iteration_count() const
+    {
+        return iterations;
+    }
+
+    /*
+     * Duration of the iteration that ended last, in nanoseconds.
+     */
+    uint64_t last_iteration_duration() const
+    {
+        return last_iteration_ns;
+    }
+
+    const LatencyHistogram &iteration_histogram() const
+    {
+        return iteration;
+    }
+
+    const LatencyHistogram &frame_histogram() const
+    {
+        return frame;
+    }
+
+    /*
+     * Writes totals since startup and, under "window", the samples since the previous call.
+     */
+    void write_json(JsonWriter &json);
+
+  private:
+    static uint64_t elapsed_ns(Clock::time_point from, Clock::time_point to)
+    {
+        return static_cast<uint64_t>(
+            std::chrono::duration_cast<std::chrono::nanoseconds>(to - from).count());
+    }
+
+    LatencyHistogram  iteration;
+    LatencyHistogram  frame;
+    HistogramSnapshot last_iteration;
+    HistogramSnapshot last_frame;
+    Clock::time_point last_start;
+    uint64_t          iterations        = 0;
+    uint64_t          last_iteration_ns = 0;
+};
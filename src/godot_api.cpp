@@ -0,0 +1,544 @@
+#include "godot_api.h"
+
+#include <cstring>
+#include <iostream>
+
+namespace
+{
+// Engine String is a single CowData pointer
+struct StringStorage {
+    void *data = nullptr;
+};
+
+// Engine Array is a single pointer to its shared, reference counted contents
+struct ArrayStorage {
+    void *data = nullptr;
+};
+
+// Userdata of the Callables made by GodotVariant::new_callable()
+struct CallableTarget {
+    GodotVariant::CallableFunc func;
+    void                      *userdata;
+    GodotVariant::CallableFree free_func;
+};
+
+void call_callable(void *userdata, const GDExtensionConstVariantPtr *args, GDExtensionInt count,
+                   GDExtensionVariantPtr r_return, GDExtensionCallError *r_error)
+{
+    auto *target = static_cast<CallableTarget *>(userdata);
+    target->func(target->userdata, args, count);
+    r_error->error = GDEXTENSION_CALL_OK;
+}
+
+void free_callable(void *userdata)
+{
+    auto *target = static_cast<CallableTarget *>(userdata);
+    if (target->free_func != nullptr) {
+        target->free_func(target->userdata);
+    }
+    delete target;
+}
+
+template <typename T>
+bool resolve(GDExtensionInterfaceGetProcAddress get_proc_address, const char *name, T &r_func)
+{
+    r_func = reinterpret_cast<T>(get_proc_address(name));
+    if (r_func == nullptr) {
+        std::cerr << "missing GDExtension interface function: " << name << std::endl;
+        return false;
+    }
+    return true;
+}
+} // namespace
+
+GodotApi &GodotApi::get()
+{
+    static GodotApi api;
+    return api;
+}
+
+bool GodotApi::load(GDExtensionInterfaceGetProcAddress p_get_proc_address,
+                    GDExtensionClassLibraryPtr         p_library)
+{
+    library          = p_library;
+    get_proc_address = p_get_proc_address;
+
+    GodotApi api = *this;
+
+    bool ok = resolve(p_get_proc_address, "variant_new_copy", api.variant_new_copy)
+              && resolve(p_get_proc_address, "variant_new_nil", api.variant_new_nil)
+              && resolve(p_get_proc_address, "variant_destroy", api.variant_destroy)
+              && resolve(p_get_proc_address, "variant_get_type", api.variant_get_type)
+              && resolve(p_get_proc_address, "get_variant_from_type_constructor",
+                         api.get_variant_from_type_constructor)
+              && resolve(p_get_proc_address, "get_variant_to_type_constructor",
+                         api.get_variant_to_type_constructor)
+              && resolve(p_get_proc_address, "variant_get_ptr_constructor",
+                         api.variant_get_ptr_constructor)
+              && resolve(p_get_proc_address, "variant_get_ptr_destructor",
+                         api.variant_get_ptr_destructor)
+              && resolve(p_get_proc_address, "string_name_new_with_latin1_chars",
+                         api.string_name_new_with_latin1_chars)
+              && resolve(p_get_proc_address, "string_new_with_utf8_chars",
+                         api.string_new_with_utf8_chars)
+              && resolve(p_get_proc_address, "string_to_utf8_chars", api.string_to_utf8_chars)
+              && resolve(p_get_proc_address, "global_get_singleton", api.global_get_singleton)
+              && resolve(p_get_proc_address, "callable_custom_create2",
+                         api.callable_custom_create2)
+              && resolve(p_get_proc_address, "packed_byte_array_operator_index",
+                         api.packed_byte_array_operator_index)
+              && resolve(p_get_proc_address, "packed_byte_array_operator_index_const",
+                         api.packed_byte_array_operator_index_const)
+              && resolve(p_get_proc_address, "packed_float32_array_operator_index",
+                         api.packed_float32_array_operator_index)
+              && resolve(p_get_proc_address, "classdb_register_extension_class4",
+                         api.classdb_register_extension_class4)
+              && resolve(p_get_proc_address, "classdb_unregister_extension_class",
+                         api.classdb_unregister_extension_class)
+              && resolve(p_get_proc_address, "classdb_construct_object2",
+                         api.classdb_construct_object2)
+              && resolve(p_get_proc_address, "classdb_get_method_bind", api.classdb_get_method_bind)
+              && resolve(p_get_proc_address, "object_set_instance", api.object_set_instance)
+              && resolve(p_get_proc_address, "object_method_bind_ptrcall",
+                         api.object_method_bind_ptrcall)
+              && resolve(p_get_proc_address, "variant_call", api.variant_call);
+
+    // Only publish the table once it is complete, is_loaded() keys off variant_call
+    if (ok) {
+        *this = api;
+    }
+    return ok;
+}
+
+void GodotApi::unload()
+{
+    variant_call = nullptr;
+}
+
+GodotStringName::GodotStringName(const char *name)
+{
+    auto &api = GodotApi::get();
+    if (api.is_loaded()) {
+        api.string_name_new_with_latin1_chars(&data, name, true);
+    }
+}
+
+GodotStringName::~GodotStringName()
+{
+    auto &api = GodotApi::get();
+    if (api.is_loaded() && data != nullptr) {
+        api.variant_get_ptr_destructor(GDEXTENSION_VARIANT_TYPE_STRING_NAME)(&data);
+    }
+}
+
+GodotVariant::GodotVariant()
+{
+    std::memset(data, 0, sizeof(data));
+    auto &api = GodotApi::get();
+    if (api.is_loaded()) {
+        api.variant_new_nil(data);
+    }
+}
+
+GodotVariant::GodotVariant(const GodotVariant &other)
+{
+    std::memset(data, 0, sizeof(data));
+    auto &api = GodotApi::get();
+    if (api.is_loaded()) {
+        api.variant_new_copy(data, other.data);
+    }
+}
+
+GodotVariant::GodotVariant(GodotVariant &&other) noexcept
+{
+    // Variants are relocatable; take over the bytes and leave a nil behind
+    std::memcpy(data, other.data, sizeof(data));
+    std::memset(other.data, 0, sizeof(other.data));
+}
+
+GodotVariant::~GodotVariant()
+{
+    auto &api = GodotApi::get();
+    if (api.is_loaded()) {
+        api.variant_destroy(data);
+    }
+}
+
+GodotVariant &GodotVariant::operator=(const GodotVariant &other)
+{
+    if (this != &other) {
+        GodotVariant copy(other);
+        *this = std::move(copy);
+    }
+    return *this;
+}
+
+GodotVariant &GodotVariant::operator=(GodotVariant &&other) noexcept
+{
+    if (this != &other) {
+        auto &api = GodotApi::get();
+        if (api.is_loaded()) {
+            api.variant_destroy(data);
+        }
+        std::memcpy(data, other.data, sizeof(data));
+        std::memset(other.data, 0, sizeof(other.data));
+    }
+    return *this;
+}
+
+GodotVariant GodotVariant::from_bool(bool value)
+{
+    GodotVariant    result;
+    GDExtensionBool native = value ? 1 : 0;
+    GodotApi::get().get_variant_from_type_constructor(GDEXTENSION_VARIANT_TYPE_BOOL)(result.data,
+                                                                                    &native);
+    return result;
+}
+
+GodotVariant GodotVariant::from_int(int64_t value)
+{
+    GodotVariant result;
+    GodotApi::get().get_variant_from_type_constructor(GDEXTENSION_VARIANT_TYPE_INT)(result.data,
+                                                                                   &value);
+    return result;
+}
+
+GodotVariant GodotVariant::from_float(double value)
+{
+    GodotVariant result;
+    GodotApi::get().get_variant_from_type_constructor(GDEXTENSION_VARIANT_TYPE_FLOAT)(result.data,
+                                                                                     &value);
+    return result;
+}
+
+GodotVariant GodotVariant::from_string(const char *value)
+{
+    auto         &api = GodotApi::get();
+    GodotVariant  result;
+    StringStorage string;
+    api.string_new_with_utf8_chars(&string, value);
+    api.get_variant_from_type_constructor(GDEXTENSION_VARIANT_TYPE_STRING)(result.data, &string);
+    api.variant_get_ptr_destructor(GDEXTENSION_VARIANT_TYPE_STRING)(&string);
+    return result;
+}
+
+GodotVariant GodotVariant::from_object(GDExtensionObjectPtr object)
+{
+    GodotVariant result;
+    if (object != nullptr) {
+        GodotApi::get().get_variant_from_type_constructor(GDEXTENSION_VARIANT_TYPE_OBJECT)(
+            result.data, &object);
+    }
+    return result;
+}
+
+GodotVariant GodotVariant::new_array()
+{
+    auto        &api = GodotApi::get();
+    GodotVariant result;
+    ArrayStorage array;
+    api.variant_get_ptr_constructor(GDEXTENSION_VARIANT_TYPE_ARRAY, 0)(&array, nullptr);
+    api.get_variant_from_type_constructor(GDEXTENSION_VARIANT_TYPE_ARRAY)(result.data, &array);
+    api.variant_get_ptr_destructor(GDEXTENSION_VARIANT_TYPE_ARRAY)(&array);
+    return result;
+}
+
+GodotVariant GodotVariant::from_bytes(const void *data, size_t size)
+{
+    auto        &api = GodotApi::get();
+    GodotVariant result;
+    alignas(8) uint8_t array[16];
+    api.variant_get_ptr_constructor(GDEXTENSION_VARIANT_TYPE_PACKED_BYTE_ARRAY, 0)(array, nullptr);
+    api.get_variant_from_type_constructor(GDEXTENSION_VARIANT_TYPE_PACKED_BYTE_ARRAY)(result.data,
+                                                                                      array);
+    api.variant_get_ptr_destructor(GDEXTENSION_VARIANT_TYPE_PACKED_BYTE_ARRAY)(array);
+    if (size == 0) {
+        return result;
+    }
+
+    // Resize through the variant, then write through a reference once the variant let go of it
+    result.call("resize", {GodotVariant::from_int(static_cast<int64_t>(size))});
+    api.get_variant_to_type_constructor(GDEXTENSION_VARIANT_TYPE_PACKED_BYTE_ARRAY)(array,
+                                                                                    result.data);
+    result = GodotVariant();
+    std::memcpy(api.packed_byte_array_operator_index(array, 0), data, size);
+    api.get_variant_from_type_constructor(GDEXTENSION_VARIANT_TYPE_PACKED_BYTE_ARRAY)(result.data,
+                                                                                      array);
+    api.variant_get_ptr_destructor(GDEXTENSION_VARIANT_TYPE_PACKED_BYTE_ARRAY)(array);
+    return result;
+}
+
+GodotVariant GodotVariant::new_callable(CallableFunc func, void *userdata, CallableFree free_func)
+{
+    auto        &api = GodotApi::get();
+    GodotVariant result;
+
+    GDExtensionCallableCustomInfo2 info = {};
+    info.callable_userdata              = new CallableTarget{func, userdata, free_func};
+    info.token                          = api.library;
+    info.call_func                      = call_callable;
+    info.free_func                      = free_callable;
+
+    // A Callable is an object id and a method name, or a pointer to the custom callable
+    alignas(8) uint8_t callable[16];
+    api.callable_custom_create2(callable, &info);
+    api.get_variant_from_type_constructor(GDEXTENSION_VARIANT_TYPE_CALLABLE)(result.data,
+                                                                             callable);
+    api.variant_get_ptr_destructor(GDEXTENSION_VARIANT_TYPE_CALLABLE)(callable);
+    return result;
+}
+
+GodotVariant GodotVariant::from_ptr(GDExtensionConstVariantPtr ptr)
+{
+    GodotVariant result;
+    auto        &api = GodotApi::get();
+    if (api.is_loaded() && ptr != nullptr) {
+        api.variant_destroy(result.data);
+        api.variant_new_copy(result.data, ptr);
+    }
+    return result;
+}
+
+GDExtensionVariantType GodotVariant::type() const
+{
+    auto &api = GodotApi::get();
+    return api.is_loaded() ? api.variant_get_type(data) : GDEXTENSION_VARIANT_TYPE_NIL;
+}
+
+bool GodotVariant::to_bool() const
+{
+    GDExtensionBool value = 0;
+    if (type() == GDEXTENSION_VARIANT_TYPE_BOOL) {
+        GodotApi::get().get_variant_to_type_constructor(GDEXTENSION_VARIANT_TYPE_BOOL)(
+            &value, const_cast<uint8_t *>(data));
+    }
+    return value != 0;
+}
+
+int64_t GodotVariant::to_int() const
+{
+    switch (type()) {
+        case GDEXTENSION_VARIANT_TYPE_INT: {
+            int64_t value = 0;
+            GodotApi::get().get_variant_to_type_constructor(GDEXTENSION_VARIANT_TYPE_INT)(
+                &value, const_cast<uint8_t *>(data));
+            return value;
+        }
+        case GDEXTENSION_VARIANT_TYPE_FLOAT:
+            return static_cast<int64_t>(to_float());
+        case GDEXTENSION_VARIANT_TYPE_BOOL:
+            return to_bool() ? 1 : 0;
+        default:
+            return 0;
+    }
+}
+
+double GodotVariant::to_float() const
+{
+    switch (type()) {
+        case GDEXTENSION_VARIANT_TYPE_FLOAT: {
+            double value = 0.0;
+            GodotApi::get().get_variant_to_type_constructor(GDEXTENSION_VARIANT_TYPE_FLOAT)(
+                &value, const_cast<uint8_t *>(data));
+            return value;
+        }
+        case GDEXTENSION_VARIANT_TYPE_INT:
+            return static_cast<double>(to_int());
+        default:
+            return 0.0;
+    }
+}
+
+std::string GodotVariant::to_string() const
+{
+    auto &api = GodotApi::get();
+    if (type() != GDEXTENSION_VARIANT_TYPE_STRING) {
+        return {};
+    }
+
+    StringStorage string;
+    api.get_variant_to_type_constructor(GDEXTENSION_VARIANT_TYPE_STRING)(
+        &string, const_cast<uint8_t *>(data));
+
+    // First pass measures, second pass writes
+    GDExtensionInt length = api.string_to_utf8_chars(&string, nullptr, 0);
+    std::string    result(static_cast<size_t>(length), '\0');
+    api.string_to_utf8_chars(&string, result.data(), length);
+
+    api.variant_get_ptr_destructor(GDEXTENSION_VARIANT_TYPE_STRING)(&string);
+    return result;
+}
+
+GDExtensionObjectPtr GodotVariant::to_object() const
+{
+    GDExtensionObjectPtr object = nullptr;
+    if (type() == GDEXTENSION_VARIANT_TYPE_OBJECT) {
+        GodotApi::get().get_variant_to_type_constructor(GDEXTENSION_VARIANT_TYPE_OBJECT)(
+            &object, const_cast<uint8_t *>(data));
+    }
+    return object;
+}
+
+GodotVariant GodotVariant::call(const GodotStringName                &method,
+                                std::initializer_list<GodotVariant> args) const
+{
+    auto        &api = GodotApi::get();
+    GodotVariant result;
+    if (!api.is_loaded() || is_nil()) {
+        return result;
+    }
+
+    // Godot calls take at most a handful of arguments, keep them on the stack
+    GDExtensionConstVariantPtr argv[8];
+    GDExtensionInt             argc = 0;
+    for (const auto &arg : args) {
+        if (argc == 8) {
+            break;
+        }
+        argv[argc++] = arg.ptr();
+    }
+
+    GDExtensionCallError error;
+    api.variant_destroy(result.data);
+    api.variant_call(const_cast<uint8_t *>(data), method.ptr(), argv, argc, result.data, &error);
+    if (error.error != GDEXTENSION_CALL_OK) {
+        std::cerr << "engine call failed with error " << error.error << std::endl;
+    }
+    return result;
+}
+
+GodotVariant GodotVariant::call(const char *method, std::initializer_list<GodotVariant> args) const
+{
+    GodotStringName name(method);
+    return call(name, args);
+}
+
+GodotPackedByteArray::GodotPackedByteArray(const GodotVariant &variant)
+{
+    auto &api = GodotApi::get();
+    if (variant.type() != GDEXTENSION_VARIANT_TYPE_PACKED_BYTE_ARRAY) {
+        return;
+    }
+
+    // Takes a reference to the variant's array, the bytes themselves are not copied
+    api.get_variant_to_type_constructor(GDEXTENSION_VARIANT_TYPE_PACKED_BYTE_ARRAY)(
+        storage, const_cast<GDExtensionVariantPtr>(variant.ptr()));
+    valid  = true;
+    length = static_cast<size_t>(variant.call("size").to_int());
+    if (length > 0) {
+        bytes = api.packed_byte_array_operator_index_const(storage, 0);
+    }
+}
+
+GodotPackedByteArray::GodotPackedByteArray(GodotPackedByteArray &&other) noexcept
+{
+    *this = std::move(other);
+}
+
+GodotPackedByteArray::~GodotPackedByteArray()
+{
+    release();
+}
+
+GodotPackedByteArray &GodotPackedByteArray::operator=(GodotPackedByteArray &&other) noexcept
+{
+    if (this != &other) {
+        release();
+        std::memcpy(storage, other.storage, sizeof(storage));
+        valid        = other.valid;
+        bytes        = other.bytes;
+        length       = other.length;
+        other.valid  = false;
+        other.bytes  = nullptr;
+        other.length = 0;
+    }
+    return *this;
+}
+
+void GodotPackedByteArray::release()
+{
+    auto &api = GodotApi::get();
+    if (valid && api.is_loaded()) {
+        api.variant_get_ptr_destructor(GDEXTENSION_VARIANT_TYPE_PACKED_BYTE_ARRAY)(storage);
+    }
+    valid  = false;
+    bytes  = nullptr;
+    length = 0;
+}
+
+GodotPackedFloat32Array::GodotPackedFloat32Array(const GodotVariant &variant)
+{
+    auto &api = GodotApi::get();
+    if (variant.type() != GDEXTENSION_VARIANT_TYPE_PACKED_FLOAT32_ARRAY) {
+        return;
+    }
+
+    api.get_variant_to_type_constructor(GDEXTENSION_VARIANT_TYPE_PACKED_FLOAT32_ARRAY)(
+        storage, const_cast<GDExtensionVariantPtr>(variant.ptr()));
+    valid  = true;
+    length = static_cast<size_t>(variant.call("size").to_int());
+}
+
+GodotPackedFloat32Array::GodotPackedFloat32Array(GodotPackedFloat32Array &&other) noexcept
+{
+    *this = std::move(other);
+}
+
+GodotPackedFloat32Array::~GodotPackedFloat32Array()
+{
+    release();
+}
+
+GodotPackedFloat32Array &GodotPackedFloat32Array::operator=(
+    GodotPackedFloat32Array &&other) noexcept
+{
+    if (this != &other) {
+        release();
+        std::memcpy(storage, other.storage, sizeof(storage));
+        valid        = other.valid;
+        length       = other.length;
+        other.valid  = false;
+        other.length = 0;
+    }
+    return *this;
+}
+
+float *GodotPackedFloat32Array::data()
+{
+    if (!valid || length == 0) {
+        return nullptr;
+    }
+    return GodotApi::get().packed_float32_array_operator_index(storage, 0);
+}
+
+GodotVariant GodotPackedFloat32Array::variant() const
+{
+    GodotVariant result;
+    if (valid) {
+        GodotApi::get().get_variant_from_type_constructor(
+            GDEXTENSION_VARIANT_TYPE_PACKED_FLOAT32_ARRAY)(result.ptr(),
+                                                          const_cast<uint8_t *>(storage));
+    }
+    return result;
+}
+
+void GodotPackedFloat32Array::release()
+{
+    auto &api = GodotApi::get();
+    if (valid && api.is_loaded()) {
+        api.variant_get_ptr_destructor(GDEXTENSION_VARIANT_TYPE_PACKED_FLOAT32_ARRAY)(storage);
+    }
+    valid  = false;
+    length = 0;
+}
+
+GodotVariant godot_singleton(const char *name)
+{
+    auto &api = GodotApi::get();
+    if (!api.is_loaded()) {
+        return {};
+    }
+
+    GodotStringName singleton_name(name);
+    return GodotVariant::from_object(api.global_get_singleton(singleton_name.ptr()));
+}
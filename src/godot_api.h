@@ -0,0 +1,269 @@
+/*
+ * Thin C++ wrappers around the GDExtension interface used by the host.
+ *
+ * The host has no godot-cpp bindings; everything it needs from the engine is resolved through
+ * the GDExtensionInterfaceGetProcAddress handed to init_extension() and called dynamically by
+ * name. This is not meant for per-node hot paths, only for the handful of calls the host makes
+ * per frame or per run.
+ */
+
+#pragma once
+
+#include <cstdint>
+#include <initializer_list>
+#include <string>
+
+#include <gdextension_interface.h>
+
+/*
+ * Resolved GDExtension interface functions, filled in once from init_extension().
+ */
+struct GodotApi {
+    GDExtensionClassLibraryPtr         library          = nullptr;
+    GDExtensionInterfaceGetProcAddress get_proc_address = nullptr;
+
+    GDExtensionInterfaceVariantNewCopy                variant_new_copy                  = nullptr;
+    GDExtensionInterfaceVariantNewNil                 variant_new_nil                   = nullptr;
+    GDExtensionInterfaceVariantDestroy                variant_destroy                   = nullptr;
+    GDExtensionInterfaceVariantCall                   variant_call                      = nullptr;
+    GDExtensionInterfaceVariantGetType                variant_get_type                  = nullptr;
+    GDExtensionInterfaceGetVariantFromTypeConstructor get_variant_from_type_constructor = nullptr;
+    GDExtensionInterfaceGetVariantToTypeConstructor   get_variant_to_type_constructor   = nullptr;
+    GDExtensionInterfaceVariantGetPtrConstructor      variant_get_ptr_constructor       = nullptr;
+    GDExtensionInterfaceVariantGetPtrDestructor       variant_get_ptr_destructor        = nullptr;
+    GDExtensionInterfaceStringNameNewWithLatin1Chars  string_name_new_with_latin1_chars = nullptr;
+    GDExtensionInterfaceStringNewWithUtf8Chars        string_new_with_utf8_chars        = nullptr;
+    GDExtensionInterfaceStringToUtf8Chars             string_to_utf8_chars              = nullptr;
+    GDExtensionInterfaceGlobalGetSingleton            global_get_singleton              = nullptr;
+    GDExtensionInterfaceCallableCustomCreate2         callable_custom_create2           = nullptr;
+
+    // Packed array element access
+    GDExtensionInterfacePackedByteArrayOperatorIndex packed_byte_array_operator_index = nullptr;
+    GDExtensionInterfacePackedByteArrayOperatorIndexConst packed_byte_array_operator_index_const =
+        nullptr;
+    GDExtensionInterfacePackedFloat32ArrayOperatorIndex packed_float32_array_operator_index =
+        nullptr;
+
+    // Extension classes and direct method calls
+    GDExtensionInterfaceClassdbRegisterExtensionClass4  classdb_register_extension_class4 = nullptr;
+    GDExtensionInterfaceClassdbUnregisterExtensionClass classdb_unregister_extension_class =
+        nullptr;
+    GDExtensionInterfaceClassdbConstructObject2         classdb_construct_object2 = nullptr;
+    GDExtensionInterfaceClassdbGetMethodBind            classdb_get_method_bind = nullptr;
+    GDExtensionInterfaceObjectSetInstance               object_set_instance = nullptr;
+    GDExtensionInterfaceObjectMethodBindPtrcall         object_method_bind_ptrcall = nullptr;
+
+    /*
+     * Returns the process-wide interface table.
+     */
+    static GodotApi &get();
+
+    /*
+     * Resolves all interface functions. Returns false if any of them is missing.
+     */
+    bool load(GDExtensionInterfaceGetProcAddress p_get_proc_address,
+              GDExtensionClassLibraryPtr         p_library);
+
+    /*
+     * Marks the interface as unusable once the extension is deinitialized. Wrappers destroyed
+     * after this point leak their engine data instead of touching a torn-down engine.
+     */
+    void unload();
+
+    bool is_loaded() const
+    {
+        return variant_call != nullptr;
+    }
+};
+
+/*
+ * Owning wrapper of an engine StringName. Names created from literals are interned as static.
+ */
+class GodotStringName
+{
+  public:
+    explicit GodotStringName(const char *name);
+    ~GodotStringName();
+
+    GodotStringName(const GodotStringName &)            = delete;
+    GodotStringName &operator=(const GodotStringName &) = delete;
+
+    GDExtensionConstStringNamePtr ptr() const
+    {
+        return &data;
+    }
+
+    /*
+     * StringNames are interned, so two names are equal exactly when they share their data.
+     */
+    bool operator==(GDExtensionConstStringNamePtr other) const
+    {
+        return other != nullptr && *static_cast<void *const *>(other) == data;
+    }
+
+  private:
+    void *data = nullptr;
+};
+
+/*
+ * Owning wrapper of an engine Variant, large enough for both single and double precision builds.
+ */
+class GodotVariant
+{
+  public:
+    GodotVariant();
+    GodotVariant(const GodotVariant &other);
+    GodotVariant(GodotVariant &&other) noexcept;
+    ~GodotVariant();
+
+    GodotVariant &operator=(const GodotVariant &other);
+    GodotVariant &operator=(GodotVariant &&other) noexcept;
+
+    static GodotVariant from_bool(bool value);
+    static GodotVariant from_int(int64_t value);
+    static GodotVariant from_float(double value);
+    static GodotVariant from_string(const char *value);
+    static GodotVariant from_object(GDExtensionObjectPtr object);
+
+    /*
+     * Returns a new empty Array, e.g. for methods that fill an array argument.
+     */
+    static GodotVariant new_array();
+
+    /*
+     * Returns a new PackedByteArray holding a copy of size bytes at data.
+     */
+    static GodotVariant from_bytes(const void *data, size_t size);
+
+    using CallableFunc = void (*)(void *userdata, const GDExtensionConstVariantPtr *args,
+                                  GDExtensionInt arg_count);
+    using CallableFree = void (*)(void *userdata);
+
+    /*
+     * Returns a new Callable that runs func with userdata when the engine calls it, e.g. as the
+     * completion callback of an asynchronous engine method. free_func runs once the engine drops
+     * its last reference, which may be after the call or without any call at all.
+     */
+    static GodotVariant new_callable(CallableFunc func, void *userdata, CallableFree free_func);
+
+    /*
+     * Returns a new reference to the variant at ptr, e.g. an argument the engine passed in.
+     */
+    static GodotVariant from_ptr(GDExtensionConstVariantPtr ptr);
+
+    GDExtensionVariantType type() const;
+
+    bool is_nil() const
+    {
+        return type() == GDEXTENSION_VARIANT_TYPE_NIL;
+    }
+
+    bool                 to_bool() const;
+    int64_t              to_int() const;
+    double               to_float() const;
+    std::string          to_string() const;
+    GDExtensionObjectPtr to_object() const;
+
+    /*
+     * Calls a method on the wrapped value (usually an Object) by name. Missing methods or bad
+     * arguments are reported to stderr and yield a nil result.
+     */
+    GodotVariant call(const GodotStringName &method,
+                      std::initializer_list<GodotVariant> args = {}) const;
+    GodotVariant call(const char *method, std::initializer_list<GodotVariant> args = {}) const;
+
+    GDExtensionVariantPtr ptr()
+    {
+        return data;
+    }
+
+    GDExtensionConstVariantPtr ptr() const
+    {
+        return data;
+    }
+
+  private:
+    alignas(8) uint8_t data[40];
+};
+
+/*
+ * Shared reference to an engine PackedByteArray. Arrays are reference counted and copy on write,
+ * so holding one keeps the engine's buffer alive and readable without copying it.
+ */
+class GodotPackedByteArray
+{
+  public:
+    GodotPackedByteArray() = default;
+    explicit GodotPackedByteArray(const GodotVariant &variant);
+    GodotPackedByteArray(GodotPackedByteArray &&other) noexcept;
+    ~GodotPackedByteArray();
+
+    GodotPackedByteArray(const GodotPackedByteArray &)            = delete;
+    GodotPackedByteArray &operator=(const GodotPackedByteArray &) = delete;
+    GodotPackedByteArray &operator=(GodotPackedByteArray &&other) noexcept;
+
+    const uint8_t *data() const
+    {
+        return bytes;
+    }
+
+    size_t size() const
+    {
+        return length;
+    }
+
+  private:
+    void release();
+
+    alignas(8) uint8_t storage[16] = {};
+    bool           valid  = false;
+    const uint8_t *bytes  = nullptr;
+    size_t         length = 0;
+};
+
+/*
+ * Owned reference to an engine PackedFloat32Array the host writes into, e.g. a MultiMesh buffer.
+ * Handing it to the engine shares the buffer; writing afterwards only copies it if the engine
+ * kept a reference of its own.
+ */
+class GodotPackedFloat32Array
+{
+  public:
+    GodotPackedFloat32Array() = default;
+    explicit GodotPackedFloat32Array(const GodotVariant &variant);
+    GodotPackedFloat32Array(GodotPackedFloat32Array &&other) noexcept;
+    ~GodotPackedFloat32Array();
+
+    GodotPackedFloat32Array(const GodotPackedFloat32Array &)            = delete;
+    GodotPackedFloat32Array &operator=(const GodotPackedFloat32Array &) = delete;
+    GodotPackedFloat32Array &operator=(GodotPackedFloat32Array &&other) noexcept;
+
+    /*
+     * Returns the writable elements. Fetch again after the array was shared with the engine,
+     * a copy on write moves them.
+     */
+    float *data();
+
+    size_t size() const
+    {
+        return length;
+    }
+
+    /*
+     * Returns a variant sharing this array, for passing it to engine calls.
+     */
+    GodotVariant variant() const;
+
+  private:
+    void release();
+
+    alignas(8) uint8_t storage[16] = {};
+    bool   valid  = false;
+    size_t length = 0;
+};
+
+/*
+ * Looks up an engine singleton (e.g. "Engine", "DisplayServer") registered with the engine.
+ * Returns a nil variant if the engine has no such singleton.
+ */
+GodotVariant godot_singleton(const char *name);
@@ -0,0 +1,736 @@
+#include "host.h"
+
+#include <algorithm>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <filesystem>
+#include <iostream>
+#include <thread>
+
+#include <libgodot.h>
+
+#if defined(__GLIBC__)
+#include <malloc.h>
+#endif
+
+#include "frame_arena.h"
+#include "json_writer.h"
+
+namespace
+{
+Host *current_host = nullptr;
+
+// Iterations the shader warm-up draws for, long enough for background compilation to finish
+constexpr int warmup_frames = 60;
+
+// Engine metadata through which the scripts of a --shm host see actions and publish observations
+constexpr const char *actions_meta       = "host_actions";
+constexpr const char *actions_frame_meta = "host_actions_frame";
+constexpr const char *observation_meta   = "host_observation";
+
+void get_engine_observation(ChannelState &r_state)
+{
+    auto engine = godot_singleton("Engine");
+    auto name   = GodotVariant::from_string(observation_meta);
+    if (!engine.call("has_meta", {name}).to_bool()) {
+        return;
+    }
+    GodotPackedByteArray observation(engine.call("get_meta", {name}));
+    r_state.size = static_cast<uint32_t>(
+        std::min<size_t>(observation.size(), ChannelState::data_capacity));
+    if (r_state.size > 0) {
+        std::memcpy(r_state.data, observation.data(), r_state.size);
+    }
+}
+
+std::string action_name(const ChannelCommand &command, size_t offset)
+{
+    if (command.size <= offset) {
+        return {};
+    }
+    auto text = reinterpret_cast<const char *>(command.payload) + offset;
+    return std::string(text, strnlen(text, command.size - offset));
+}
+
+// Applies ShmPress and ShmRelease; returns false for every other type
+bool apply_input_command(const ChannelCommand &command)
+{
+    switch (command.type) {
+        case ShmPress: {
+            float strength = 1.0f;
+            if (command.size >= sizeof(strength)) {
+                std::memcpy(&strength, command.payload, sizeof(strength));
+            }
+            auto action = action_name(command, sizeof(strength));
+            godot_singleton("Input").call("action_press",
+                                          {GodotVariant::from_string(action.c_str()),
+                                           GodotVariant::from_float(strength)});
+            return true;
+        }
+        case ShmRelease: {
+            auto action = action_name(command, 0);
+            godot_singleton("Input").call("action_release",
+                                          {GodotVariant::from_string(action.c_str())});
+            return true;
+        }
+        default:
+            return false;
+    }
+}
+
+const char *level_name(GDExtensionInitializationLevel level)
+{
+    switch (level) {
+        case GDEXTENSION_INITIALIZATION_CORE:
+            return "core";
+        case GDEXTENSION_INITIALIZATION_SERVERS:
+            return "servers";
+        case GDEXTENSION_INITIALIZATION_SCENE:
+            return "scene";
+        case GDEXTENSION_INITIALIZATION_EDITOR:
+            return "editor";
+        default:
+            return "unknown";
+    }
+}
+} // namespace
+
+Host::Host(HostOptions &p_options)
+    : options(p_options)
+    , stats(std::make_unique<FrameStats>())
+    , memory(options.memory_interval, options.memory_budgets)
+    , placement(options.main_cpus, options.engine_cpus, options.numa_node, options.main_priority)
+{
+    current_host = this;
+    scheduler.set_event_loop(&events);
+
+    if (options.bench_iterations > 0) {
+        bench.emplace(options.bench_iterations, options.bench_fps);
+    }
+
+    reporter.set_interval(
+        std::chrono::milliseconds(static_cast<int64_t>(options.stats_interval_s * 1000.0)));
+    reporter.add_section("frame_stats", [this](JsonWriter &json) { stats->write_json(json); });
+    reporter.add_section("startup", [this](JsonWriter &json) { startup.write_json(json); });
+    reporter.add_section("jobs", [this](JsonWriter &json) { jobs.write_json(json); });
+    reporter.add_section("frame_arena", [](JsonWriter &json) { FrameArena::write_json(json); });
+    reporter.add_section("event_loop", [this](JsonWriter &json) { events.write_json(json); });
+    reporter.add_section("memory", [this](JsonWriter &json) {
+        memory.sample();
+        memory.write_json(json);
+    });
+    if (!options.main_cpus.empty() || !options.engine_cpus.empty() || options.numa_node >= 0
+        || options.main_priority != ThreadPriority::Normal) {
+        reporter.add_section("placement", [this](JsonWriter &json) { placement.write_json(json); });
+    }
+    if (options.memory_trim) {
+        memory.set_trim_handler([this] { trim_memory(); });
+    }
+    reporter.add_section("control_channel",
+                         [this](JsonWriter &json) { channel.write_json(json); });
+    if (!options.control_socket.empty()) {
+        control_socket.emplace(options.control_socket, events, channel);
+        reporter.add_section("control_socket",
+                             [this](JsonWriter &json) { control_socket->write_json(json); });
+    }
+    if (!options.shm_name.empty()) {
+        shm.emplace(options.shm_name, options.shm_lockstep);
+        reporter.add_section("shm", [this](JsonWriter &json) { shm->write_json(json); });
+    }
+
+    // Until an embedder installs its own, scripts exchange actions and observations. A replay
+    // gets them too, as the actions it feeds back were recorded from a --shm host.
+    if (!options.shm_name.empty() || !options.replay_path.empty()) {
+        command_handler = [this](const ChannelCommand &command) { queue_engine_action(command); };
+        state_writer    = get_engine_observation;
+    }
+    if (!options.record_path.empty()) {
+        recorder.emplace(options.record_path, options.record_fps);
+        reporter.add_section("record", [this](JsonWriter &json) { recorder->write_json(json); });
+    }
+    if (!options.replay_path.empty()) {
+        replay.emplace(options.replay_path);
+        reporter.add_section("replay", [this](JsonWriter &json) { replay->write_json(json); });
+    }
+    if (!options.shared_cache.empty()) {
+        shared_cache.emplace(options.shared_cache);
+        reporter.add_section("shared_cache",
+                             [this](JsonWriter &json) { shared_cache->write_json(json); });
+    }
+    if (options.preload_pack) {
+        reporter.add_section("pack", [this](JsonWriter &json) { pack.write_json(json); });
+    }
+    if (!options.prefetch.empty()) {
+        prefetch.emplace(options.prefetch);
+        reporter.add_section("prefetch", [this](JsonWriter &json) { prefetch->write_json(json); });
+        prefetch->set_callback([this](const std::string &path, double progress) {
+            if (options.startup_report) {
+                std::cout << "prefetch: " << path << " (" << static_cast<int>(progress * 100.0)
+                          << "%)" << std::endl;
+            }
+            if (prefetch_callback) {
+                prefetch_callback(path, progress);
+            }
+        });
+    }
+    if (!options.profile_path.empty()) {
+        profiler = std::make_unique<SamplingProfiler>(options.profile_path, options.profile_format,
+                                                      options.profile_rate);
+        reporter.add_section("profile", [this](JsonWriter &json) { profiler->write_json(json); });
+    }
+    if (options.warm_shader_cache) {
+        warmup.emplace(warmup_frames);
+        reporter.add_section("shader_warmup",
+                             [this](JsonWriter &json) { warmup->write_json(json); });
+    }
+    if (options.reload_on_signal || options.watch_project) {
+        reload.emplace(options.reload_on_signal, options.watch_project);
+        reporter.add_section("reload", [this](JsonWriter &json) { reload->write_json(json); });
+    }
+    if (options.frame_budget_ms > 0.0) {
+        budget.emplace(options.frame_budget_ms);
+        reporter.add_section("frame_budget",
+                             [this](JsonWriter &json) { budget->write_json(json); });
+    }
+    if (bench) {
+        reporter.add_section("bench", [this](JsonWriter &json) { bench->write_json(json); });
+    }
+    if (options.capture) {
+        capture = std::make_unique<FrameCapture>();
+        reporter.add_section("capture", [this](JsonWriter &json) { capture->write_json(json); });
+
+        // Encoding is just another consumer of the captured frames
+        capture->set_callback([this](const CapturedFrame &frame) {
+            if (encoder) {
+                encoder->submit(frame);
+            }
+            if (frame_callback) {
+                frame_callback(frame);
+            }
+        });
+    }
+    if (options.encode_format != EncodeFormat::None) {
+        double encode_rate = options.frame_pacing == FramePacing::TargetRate ? options.frame_rate
+                                                                              : 60.0;
+        encoder = std::make_unique<FrameEncoder>(options.encode_format, options.encode_output,
+                                                 options.encode_policy, options.encode_queue,
+                                                 encode_rate);
+        reporter.add_section("encoder", [this](JsonWriter &json) { encoder->write_json(json); });
+    }
+}
+
+Host::~Host()
+{
+    current_host = nullptr;
+}
+
+void Host::set_frame_callback(FrameCapture::Callback callback)
+{
+    frame_callback = std::move(callback);
+}
+
+void Host::set_prefetch_callback(ResourcePrefetch::ProgressCallback callback)
+{
+    prefetch_callback = std::move(callback);
+}
+
+void Host::set_command_handler(ControlChannel::CommandHandler handler)
+{
+    command_handler = std::move(handler);
+}
+
+void Host::set_state_writer(ControlChannel::StateWriter writer)
+{
+    state_writer = std::move(writer);
+}
+
+Host *Host::current()
+{
+    return current_host;
+}
+
+int Host::run()
+{
+    // Every thread started from here on inherits the engine placement
+    if (!placement.begin()) {
+        return EXIT_FAILURE;
+    }
+
+    if (!options.stats_file.empty() && !reporter.open(options.stats_file)) {
+        return EXIT_FAILURE;
+    }
+
+    if (encoder && !encoder->start()) {
+        return EXIT_FAILURE;
+    }
+
+    // Started before the engine so startup is profiled as well
+    if (profiler && !profiler->start()) {
+        return EXIT_FAILURE;
+    }
+
+    // Supervisors may attach while the engine starts
+    if (shm && !shm->open()) {
+        return EXIT_FAILURE;
+    }
+
+    if (control_socket && !control_socket->open()) {
+        return EXIT_FAILURE;
+    }
+
+    if (recorder && !recorder->open()) {
+        return EXIT_FAILURE;
+    }
+    if (replay && !replay->open()) {
+        return EXIT_FAILURE;
+    }
+
+    // Workers exist before the engine so native classes can use them from the first frame on
+    int workers = options.job_workers;
+    if (workers < 0) {
+        workers = std::max(1, static_cast<int>(std::thread::hardware_concurrency())) - 1;
+    }
+    jobs.start(workers, options.pin_jobs);
+
+    // The engine reads its shader and pipeline caches while it initializes; without a renderer
+    // there is nothing to read them
+    if (!options.shader_cache_dir.empty() && !warmup && !options.simulate) {
+        startup.begin("import_shader_cache");
+        import_shader_cache(options.shader_cache_dir);
+        startup.end();
+    }
+
+    if (!create_instance()) {
+        return EXIT_FAILURE;
+    }
+
+    // The engine started its threads while it initialized, the main thread now goes its own way
+    if (!placement.finish()) {
+        destroy_instance();
+        return EXIT_FAILURE;
+    }
+
+    // A warm-started host may be launched before it knows its first project
+    std::string path = options.project_path;
+    if (path.empty() && !next_warm_project(path)) {
+        destroy_instance();
+        return EXIT_SUCCESS;
+    }
+
+    bool ok = true;
+    do {
+        // A reload runs the same project again on the same instance, keeping the engine warm
+        do {
+            ok = run_project(path) && ok;
+        } while (reload_pending);
+    } while (options.warm_start && next_warm_project(path));
+
+    startup.begin("shutdown");
+
+    // Drain the encoder queue so the final report has the complete counts
+    if (encoder) {
+        encoder->stop();
+    }
+    if (profiler && !profiler->stop()) {
+        ok = false;
+    }
+    if (recorder) {
+        recorder->close();
+    }
+
+    // Everything that must persist is written, the engine's objects need not be freed one by one
+    if (options.fast_exit) {
+        if (shm) {
+            shm->close();
+        }
+        if (control_socket) {
+            control_socket->close();
+        }
+        startup.end();
+        if (options.startup_report) {
+            print_teardown(std::cout);
+        }
+        reporter.write(true);
+        std::cout.flush();
+        std::cerr.flush();
+        std::fflush(nullptr);
+        std::_Exit(ok ? EXIT_SUCCESS : EXIT_FAILURE);
+    }
+
+    startup.begin("destroy_instance");
+    destroy_instance();
+    startup.end();
+    jobs.stop();
+    if (shm) {
+        shm->close();
+    }
+    if (control_socket) {
+        control_socket->close();
+    }
+    startup.end();
+
+    // Written after teardown so the startup section times it too
+    if (options.startup_report) {
+        print_teardown(std::cout);
+    }
+    reporter.write(true);
+
+    // The pipeline cache is only written while the engine shuts down
+    if (warmup && ok && !options.shader_cache_dir.empty()) {
+        ok = export_shader_cache(warmup->user_data_dir(), options.shader_cache_dir);
+    }
+    return ok ? EXIT_SUCCESS : EXIT_FAILURE;
+}
+
+void Host::on_extension_initialize(GDExtensionInitializationLevel level)
+{
+    startup.mark(std::string("extension_initialize: ") + level_name(level));
+}
+
+void Host::on_extension_deinitialize(GDExtensionInitializationLevel level)
+{
+    startup.mark(std::string("extension_deinitialize: ") + level_name(level));
+}
+
+bool Host::create_instance()
+{
+    // Create an embedded Godot engine instance, host options are not forwarded
+    auto engine_argv = options.engine_argv();
+
+    startup.begin("create_instance");
+    {
+        ProfileScope scope("create_instance");
+        instance = libgodot_create_godot_instance(static_cast<int>(engine_argv.size() - 1),
+                                                  engine_argv.data(), init_extension);
+    }
+    startup.end();
+
+    if (instance == nullptr) {
+        std::cerr << "failed to initialize Godot Engine instance" << std::endl;
+        return false;
+    }
+    return true;
+}
+
+bool Host::run_project(const std::string &path)
+{
+    // Hosts loading the same pck share one copy of it in memory
+    std::string load_path = path;
+    if (shared_cache) {
+        startup.begin("shared_cache");
+        load_path = shared_cache->resolve(path);
+        startup.end();
+    }
+
+    // Pull a pck into the page cache so mounting it and loading from it does not wait on disk
+    std::error_code error;
+    if (options.preload_pack && std::filesystem::is_regular_file(load_path, error)) {
+        startup.begin("preload_pack");
+        pack.map(load_path);
+        startup.end();
+    }
+
+    // Load and start the project after the engine is initialized.
+    startup.begin("load_project");
+    bool loaded = false;
+    {
+        ProfileScope scope("load_project");
+        loaded = libgodot_load_project(instance, load_path.c_str());
+    }
+    startup.end();
+
+    if (!loaded) {
+        std::cerr << "failed to load Godot project: " << path << std::endl;
+        pack.unmap();
+        reload_pending = false;
+        return false;
+    }
+
+    if (reload) {
+        if (reload_pending) {
+            reload->reloaded(ReloadTrigger::Clock::now() - reload_started);
+            startup.mark("reloaded");
+            reload_pending = false;
+        }
+        reload->arm(path);
+    }
+
+    // The scene tree is new, look up its root viewport again
+    if (capture) {
+        capture->reset();
+    }
+
+    // Pace iterations from the host instead of spinning between frames
+    scheduler.configure(options.frame_pacing, options.frame_rate);
+    scheduler.follow_display();
+    if (budget) {
+        budget->start();
+    }
+
+    // Runs on the engine's worker threads alongside the first frames
+    if (prefetch) {
+        prefetch->start();
+    }
+
+    // Engine initialization only counts against the first project
+    if (bench) {
+        auto startup_time = startup.duration_of("load_project");
+        if (shared_cache) {
+            startup_time += startup.duration_of("shared_cache");
+        }
+        if (pack.is_mapped()) {
+            startup_time += startup.duration_of("preload_pack");
+        }
+        if (!warm) {
+            startup_time += startup.duration_of("create_instance");
+        }
+        bench->start(*stats, startup_time.count());
+    }
+
+    // Warming only draws the project's materials, a failure leaves nothing to run
+    bool warming = !warmup || warmup->start();
+    if (warming) {
+        run_loop();
+    }
+
+    if (bench) {
+        bench->finish(*stats);
+        bench->print(std::cout);
+    }
+
+    if (budget) {
+        budget->finish();
+    }
+    if (prefetch) {
+        prefetch->release();
+    }
+
+    // A fast exit leaves the last project loaded, and its pack mapped, for the process to drop
+    if (options.fast_exit && !options.warm_start && !reload_pending) {
+        return warming;
+    }
+
+    startup.begin("unload_project");
+    libgodot_unload_project(instance);
+    startup.end();
+    pack.unmap();
+
+    warm = true;
+    return warming;
+}
+
+void Host::run_loop()
+{
+    bool first_frame = true;
+
+    ControlChannel::CommandHandler dispatch = [this](const ChannelCommand &command) {
+        handle_command(command);
+    };
+
+    // Run Godot's per-frame iteration loop until it returns true (e.g. engine requests shutdown)
+    while (true) {
+        // A lockstep host waits here for the supervisor's next step
+        if (shm && !shm->receive(channel)) {
+            break;
+        }
+
+        if (first_frame) {
+            startup.begin("first_frame");
+        }
+
+        // Commands from control threads take effect before the engine processes the frame. A
+        // replay feeds the recorded ones instead and leaves live commands queued.
+        if (replay) {
+            replay->apply(dispatch);
+        } else {
+            channel.drain(dispatch);
+        }
+        publish_engine_actions(stats->iteration_count() + 1);
+
+        stats->begin_iteration();
+        bool quit = false;
+        {
+            ProfileScope scope("iteration");
+            quit = libgodot_iteration_godot_instance(instance);
+        }
+        stats->end_iteration();
+        clear_engine_actions();
+        if (recorder) {
+            recorder->end_iteration(stats->last_iteration_duration());
+        }
+        if (replay) {
+            replay->end_iteration(stats->last_iteration_duration());
+        }
+
+        if (state_writer || shm) {
+            auto &state = channel.back_state();
+            state.frame = stats->iteration_count();
+            state.size  = 0;
+            if (state_writer) {
+                state_writer(state);
+            }
+            if (shm) {
+                shm->publish(state, stats->last_iteration_duration());
+            }
+            channel.publish_state();
+        }
+
+        // Scratch memory of native classes only lives for the iteration
+        FrameArena::end_frame();
+        memory.poll(stats->iteration_count());
+
+        if (profiler) {
+            profiler->drain();
+        }
+
+        // Over budget, the next iteration must not be pushed back further by optional work
+        bool behind = false;
+        if (budget) {
+            budget->end_iteration(stats->last_iteration_duration());
+            behind = budget->is_behind();
+            if (behind) {
+                budget->skip_extras();
+            }
+        }
+
+        if (capture && capture->is_active() && !behind) {
+            capture->capture(stats->iteration_count());
+        }
+
+        if (prefetch && !prefetch->is_done() && prefetch->poll()) {
+            startup.mark("prefetch_done");
+        }
+
+        if (warmup && warmup->step()) {
+            break;
+        }
+
+        if (first_frame) {
+            startup.end();
+            first_frame = false;
+            if (options.startup_report) {
+                startup.print(std::cout);
+            }
+        }
+
+        if (control_socket && control_socket->take_quit()) {
+            quit = true;
+        }
+        if (quit || (bench && bench->is_done(*stats)) || (replay && replay->is_done())) {
+            break;
+        }
+
+        if (reload && reload->poll()) {
+            reload_started = ReloadTrigger::Clock::now();
+            reload_pending = true;
+            break;
+        }
+
+        if (!behind) {
+            reporter.poll();
+        }
+
+        // The supervisor paces a lockstep host, which still serves its event loop
+        if (!shm || !shm->is_lockstep()) {
+            scheduler.wait_for_next_frame();
+        } else if (events.has_sources()) {
+            events.dispatch_ready();
+        }
+    }
+}
+
+void Host::handle_command(const ChannelCommand &command)
+{
+    if (recorder) {
+        recorder->record(command);
+    }
+    if (!apply_input_command(command) && command_handler) {
+        command_handler(command);
+    }
+}
+
+void Host::queue_engine_action(const ChannelCommand &command)
+{
+    if (engine_actions.is_nil()) {
+        engine_actions = GodotVariant::new_array();
+    }
+    engine_actions.call("append", {GodotVariant::from_bytes(command.payload, command.size)});
+}
+
+void Host::publish_engine_actions(uint64_t frame)
+{
+    // The actions are stamped with the frame number of the observation published after this
+    // iteration
+    if (engine_actions.is_nil()) {
+        return;
+    }
+    auto engine = godot_singleton("Engine");
+    engine.call("set_meta", {GodotVariant::from_string(actions_meta), engine_actions});
+    engine.call("set_meta", {GodotVariant::from_string(actions_frame_meta),
+                             GodotVariant::from_int(static_cast<int64_t>(frame))});
+}
+
+void Host::clear_engine_actions()
+{
+    // Scripts must not take the actions of an earlier iteration for new ones
+    if (engine_actions.is_nil()) {
+        return;
+    }
+    auto engine = godot_singleton("Engine");
+    engine.call("remove_meta", {GodotVariant::from_string(actions_meta)});
+    engine.call("remove_meta", {GodotVariant::from_string(actions_frame_meta)});
+    engine_actions = GodotVariant();
+}
+
+void Host::trim_memory()
+{
+    size_t released = prefetch ? prefetch->release_loaded() : 0;
+    FrameArena::trim();
+#if defined(__GLIBC__)
+    // Freed engine allocations mostly stay in malloc's free lists otherwise
+    malloc_trim(0);
+#endif
+    std::cerr << "memory trimmed, released " << released << " prefetched resources" << std::endl;
+}
+
+void Host::print_teardown(std::ostream &out) const
+{
+    auto milliseconds = [this](const char *phase) {
+        return std::chrono::duration<double, std::milli>(startup.duration_of(phase)).count();
+    };
+    if (options.fast_exit) {
+        out << "teardown: fast exit after " << milliseconds("shutdown") << " ms" << std::endl;
+    } else {
+        out << "teardown: unload_project " << milliseconds("unload_project") << " ms, shutdown "
+            << milliseconds("shutdown") << " ms (destroy_instance "
+            << milliseconds("destroy_instance") << " ms)" << std::endl;
+    }
+}
+
+void Host::destroy_instance()
+{
+    // Cleanly destroy the engine instance
+    if (instance != nullptr) {
+        libgodot_destroy_godot_instance(instance);
+        instance = nullptr;
+    }
+}
+
+bool Host::next_warm_project(std::string &r_path)
+{
+    // Orchestrators wait for this line before handing over the next job
+    std::cout << "warm-start: ready" << std::endl;
+
+    std::string line;
+    while (std::getline(std::cin, line)) {
+        if (!line.empty() && line.back() == '\r') {
+            line.pop_back();
+        }
+        if (!line.empty()) {
+            r_path = line;
+            return true;
+        }
+    }
+    return false;
+}
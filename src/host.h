@@ -0,0 +1,176 @@
+/*
+ * Lifecycle of the embedded engine instance and the projects run on it.
+ */
+
+#pragma once
+
+#include <memory>
+#include <optional>
+#include <ostream>
+#include <string>
+
+#include <gdextension_interface.h>
+
+#include "bench_run.h"
+#include "control_channel.h"
+#include "control_socket.h"
+#include "event_loop.h"
+#include "frame_capture.h"
+#include "frame_budget.h"
+#include "frame_encoder.h"
+#include "frame_scheduler.h"
+#include "frame_stats.h"
+#include "godot_api.h"
+#include "host_options.h"
+#include "input_log.h"
+#include "job_system.h"
+#include "memory_report.h"
+#include "pack_mapping.h"
+#include "reload_trigger.h"
+#include "resource_prefetch.h"
+#include "sampling_profiler.h"
+#include "shader_warmup.h"
+#include "shared_cache.h"
+#include "shm_transport.h"
+#include "startup_profile.h"
+#include "stats_reporter.h"
+#include "thread_placement.h"
+
+/*
+ * The host's GDExtension entry point, defined in main.cpp.
+ */
+GDExtensionBool init_extension(GDExtensionInterfaceGetProcAddress p_get_proc_address,
+                               GDExtensionClassLibraryPtr         p_library,
+                               GDExtensionInitialization         *r_initialization);
+
+/*
+ * Owns one engine instance and drives its iteration loop. With warm start, the instance
+ * outlives the project: once a project ends it is unloaded and the next one is loaded into
+ * the same, already initialized engine.
+ */
+class Host
+{
+  public:
+    explicit Host(HostOptions &p_options);
+    ~Host();
+
+    Host(const Host &)            = delete;
+    Host &operator=(const Host &) = delete;
+
+    /*
+     * Creates the instance, runs every project and tears down. Returns the process exit code.
+     */
+    int run();
+
+    /*
+     * Receives every captured frame when capture is enabled, right after the iteration that
+     * rendered it.
+     */
+    void set_frame_callback(FrameCapture::Callback callback);
+
+    /*
+     * Receives the progress of --prefetch requests as each of them finishes.
+     */
+    void set_prefetch_callback(ResourcePrefetch::ProgressCallback callback);
+
+    /*
+     * Commands sent here from any thread reach the command handler on the engine thread right
+     * before the next iteration. After each iteration the state writer fills a snapshot that
+     * control threads read with ControlChannel::latest_state().
+     */
+    ControlChannel &control_channel()
+    {
+        return channel;
+    }
+
+    void set_command_handler(ControlChannel::CommandHandler handler);
+    void set_state_writer(ControlChannel::StateWriter writer);
+
+    /*
+     * The loop that runs embedder file descriptors and timers on the engine thread while the host
+     * waits for the next frame.
+     */
+    EventLoop &event_loop()
+    {
+        return events;
+    }
+
+    /*
+     * Returns the running host, for callbacks the engine makes without user data.
+     */
+    static Host *current();
+
+    /*
+     * Hooks for the host's GDExtension, called for each initialization level.
+     */
+    void on_extension_initialize(GDExtensionInitializationLevel level);
+    void on_extension_deinitialize(GDExtensionInitializationLevel level);
+
+  private:
+    bool create_instance();
+    bool run_project(const std::string &path);
+    void run_loop();
+
+    /*
+     * Applies a command from the control channel or a replay, recording it with --record.
+     */
+    void handle_command(const ChannelCommand &command);
+
+    /*
+     * The default command handler: collects the actions of the next iteration for scripts,
+     * which see them only during that iteration.
+     */
+    void queue_engine_action(const ChannelCommand &command);
+    void publish_engine_actions(uint64_t frame);
+    void clear_engine_actions();
+
+    /*
+     * Gives memory back after a --memory-budget was exceeded, with --memory-trim.
+     */
+    void trim_memory();
+    void destroy_instance();
+
+    /*
+     * Prints how long the teardown after the last project took, with --startup-report.
+     */
+    void print_teardown(std::ostream &out) const;
+
+    /*
+     * Reads the next project path from stdin for warm start. Returns false at end of input.
+     */
+    bool next_warm_project(std::string &r_path);
+
+    HostOptions                        &options;
+    GDExtensionObjectPtr               instance = nullptr;
+    StartupProfile                     startup;
+    std::unique_ptr<FrameStats>        stats;
+    StatsReporter                      reporter;
+    MemoryReport                       memory;
+    FrameScheduler                     scheduler;
+    EventLoop                          events;
+    ControlChannel                     channel;
+    ControlChannel::CommandHandler     command_handler;
+    ControlChannel::StateWriter        state_writer;
+    GodotVariant                       engine_actions; // Array of the next iteration's actions
+    std::optional<ControlSocket>       control_socket;
+    std::optional<ShmTransport>        shm;
+    std::optional<InputRecorder>       recorder;
+    std::optional<InputReplay>         replay;
+    std::optional<FrameBudget>         budget;
+    std::optional<BenchRun>            bench;
+    JobSystem                          jobs;
+    ThreadPlacement                    placement;
+    std::unique_ptr<FrameCapture>      capture;
+    FrameCapture::Callback             frame_callback;
+    std::unique_ptr<FrameEncoder>      encoder;
+    std::unique_ptr<SamplingProfiler>  profiler;
+    std::optional<SharedCache>         shared_cache;
+    PackMapping                        pack; // Current pck project with --preload-pack
+    std::optional<ResourcePrefetch>    prefetch;
+    std::optional<ReloadTrigger>       reload;
+    std::optional<ShaderWarmup>        warmup;
+    ReloadTrigger::Clock::time_point   reload_started;
+    bool                               reload_pending = false; // Load the project again when done
+    ResourcePrefetch::ProgressCallback prefetch_callback;
+    bool                               warm = false; // An earlier project ran on this instance
+};
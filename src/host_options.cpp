@@ -0,0 +1,567 @@
+#include "host_options.h"
+
+#include <algorithm>
+#include <cstdlib>
+#include <iostream>
+
+#include "input_log.h"
+#include "shared_cache.h"
+
+namespace
+{
+bool parse_number(const std::string &text, double &r_value)
+{
+    char *end = nullptr;
+    r_value   = std::strtod(text.c_str(), &end);
+    return end != text.c_str() && *end == '\0';
+}
+
+bool parse_integer(const std::string &text, int64_t &r_value)
+{
+    char *end = nullptr;
+    r_value   = std::strtoll(text.c_str(), &end, 10);
+    return end != text.c_str() && *end == '\0';
+}
+
+bool parse_frame_rate(const std::string &text, HostOptions &r_options)
+{
+    if (text == "unlimited") {
+        r_options.frame_pacing = FramePacing::Unlimited;
+        return true;
+    }
+    if (text == "vsync") {
+        r_options.frame_pacing = FramePacing::VSync;
+        return true;
+    }
+
+    double rate = 0.0;
+    if (!parse_number(text, rate) || rate <= 0.0) {
+        return false;
+    }
+    r_options.frame_pacing = FramePacing::TargetRate;
+    r_options.frame_rate   = rate;
+    return true;
+}
+
+bool parse_encode_format(const std::string &text, EncodeFormat &r_format)
+{
+    if (text == "raw") {
+        r_format = EncodeFormat::Raw;
+    } else if (text == "png") {
+        r_format = EncodeFormat::Png;
+    } else if (text == "h264") {
+        r_format = EncodeFormat::H264;
+    } else {
+        return false;
+    }
+    return true;
+}
+} // namespace
+
+bool HostOptions::parse(int argc, char *argv[])
+{
+    engine_args.clear();
+    engine_args.emplace_back(argc > 0 ? argv[0] : PROJECT_NAME);
+
+    bool host_args_done = false;
+    for (int i = 1; i < argc; ++i) {
+        std::string arg = argv[i];
+
+        if (host_args_done || arg.rfind("--", 0) != 0) {
+            engine_args.push_back(arg);
+            continue;
+        }
+        if (arg == "--" || arg == "++") {
+            host_args_done = true;
+            engine_args.push_back(arg);
+            continue;
+        }
+
+        // Fetches the value of the current option or fails if there is none
+        auto value = [&](std::string &r_value) {
+            if (i + 1 >= argc) {
+                std::cerr << "missing value for " << arg << std::endl;
+                return false;
+            }
+            r_value = argv[++i];
+            return true;
+        };
+
+        std::string option_value;
+        if (arg == "--frame-rate") {
+            if (!value(option_value) || !parse_frame_rate(option_value, *this)) {
+                std::cerr << "invalid frame rate, expected <hz>, vsync or unlimited" << std::endl;
+                return false;
+            }
+        } else if (arg == "--frame-budget") {
+            if (!value(option_value) || !parse_number(option_value, frame_budget_ms)
+                || frame_budget_ms <= 0.0) {
+                std::cerr << "invalid frame budget, expected milliseconds" << std::endl;
+                return false;
+            }
+        } else if (arg == "--stats-file") {
+            if (!value(stats_file)) {
+                return false;
+            }
+        } else if (arg == "--stats-interval") {
+            if (!value(option_value) || !parse_number(option_value, stats_interval_s)
+                || stats_interval_s < 0.0) {
+                std::cerr << "invalid stats interval, expected seconds" << std::endl;
+                return false;
+            }
+        } else if (arg == "--memory-interval") {
+            int64_t iterations = 0;
+            if (!value(option_value) || !parse_integer(option_value, iterations)
+                || iterations < 0) {
+                std::cerr << "invalid memory sample interval, expected iterations" << std::endl;
+                return false;
+            }
+            memory_interval = static_cast<uint64_t>(iterations);
+        } else if (arg == "--memory-budget") {
+            if (!value(option_value)) {
+                return false;
+            }
+            auto   separator = option_value.find('=');
+            double mebibytes = 0.0;
+            if (separator == std::string::npos
+                || !MemoryReport::is_subsystem(option_value.substr(0, separator))
+                || !parse_number(option_value.substr(separator + 1), mebibytes)
+                || mebibytes <= 0.0) {
+                std::cerr << "invalid memory budget, expected <subsystem>=<MiB> with subsystem "
+                             "rss, static, video, texture, buffer or arena"
+                          << std::endl;
+                return false;
+            }
+            memory_budgets.push_back(
+                {option_value.substr(0, separator),
+                 static_cast<uint64_t>(mebibytes * 1024.0 * 1024.0)});
+        } else if (arg == "--memory-trim") {
+            memory_trim = true;
+        } else if (arg == "--profile") {
+            if (!value(profile_path)) {
+                return false;
+            }
+        } else if (arg == "--profile-format") {
+            if (!value(option_value) || (option_value != "folded" && option_value != "chrome")) {
+                std::cerr << "invalid profile format, expected folded or chrome" << std::endl;
+                return false;
+            }
+            profile_format =
+                option_value == "folded" ? ProfileFormat::Folded : ProfileFormat::Chrome;
+        } else if (arg == "--profile-rate") {
+            int64_t rate = 0;
+            if (!value(option_value) || !parse_integer(option_value, rate) || rate <= 0
+                || rate > 100000) {
+                std::cerr << "invalid profile rate" << std::endl;
+                return false;
+            }
+            profile_rate = static_cast<int>(rate);
+        } else if (arg == "--bench") {
+            int64_t iterations = 0;
+            if (!value(option_value) || !parse_integer(option_value, iterations)
+                || iterations <= 0) {
+                std::cerr << "invalid benchmark iteration count" << std::endl;
+                return false;
+            }
+            bench_iterations = static_cast<uint64_t>(iterations);
+        } else if (arg == "--bench-fps") {
+            int64_t fps = 0;
+            if (!value(option_value) || !parse_integer(option_value, fps) || fps <= 0) {
+                std::cerr << "invalid benchmark frame rate" << std::endl;
+                return false;
+            }
+            bench_fps = static_cast<int>(fps);
+        } else if (arg == "--simulate") {
+            simulate = true;
+        } else if (arg == "--fast-exit") {
+            fast_exit = true;
+        } else if (arg == "--instances" || arg == "--replica") {
+            int64_t number = 0;
+            if (!value(option_value) || !parse_integer(option_value, number) || number < 0
+                || number > 4096 || (arg == "--instances" && number == 0)) {
+                std::cerr << "invalid value for " << arg << std::endl;
+                return false;
+            }
+            (arg == "--instances" ? instances : replica_index) = static_cast<int>(number);
+        } else if (arg == "--startup-report") {
+            startup_report = true;
+        } else if (arg == "--warm-start") {
+            warm_start = true;
+        } else if (arg == "--reload-on-signal") {
+            reload_on_signal = true;
+        } else if (arg == "--watch") {
+            watch_project = true;
+        } else if (arg == "--preload-pack") {
+            preload_pack = true;
+        } else if (arg == "--shared-cache") {
+            if (shared_cache.empty()) {
+                shared_cache = SharedCache::default_directory();
+            }
+        } else if (arg == "--shared-cache-dir") {
+            if (!value(shared_cache)) {
+                return false;
+            }
+        } else if (arg == "--prefetch") {
+            if (!value(option_value)) {
+                return false;
+            }
+            prefetch.push_back(option_value);
+        } else if (arg == "--warm-shader-cache") {
+            warm_shader_cache = true;
+        } else if (arg == "--shader-cache-dir") {
+            if (!value(shader_cache_dir)) {
+                return false;
+            }
+        } else if (arg == "--control-socket") {
+            if (!value(control_socket)) {
+                return false;
+            }
+        } else if (arg == "--shm") {
+            if (!value(shm_name)) {
+                return false;
+            }
+        } else if (arg == "--shm-lockstep") {
+            shm_lockstep = true;
+        } else if (arg == "--record") {
+            if (!value(record_path)) {
+                return false;
+            }
+        } else if (arg == "--record-fps") {
+            int64_t fps = 0;
+            if (!value(option_value) || !parse_integer(option_value, fps) || fps <= 0
+                || fps > 10000) {
+                std::cerr << "invalid recording frame rate" << std::endl;
+                return false;
+            }
+            record_fps = static_cast<int>(fps);
+        } else if (arg == "--replay") {
+            if (!value(replay_path)) {
+                return false;
+            }
+        } else if (arg == "--capture") {
+            capture = true;
+        } else if (arg == "--jobs") {
+            int64_t workers = 0;
+            if (!value(option_value) || !parse_integer(option_value, workers) || workers < 0
+                || workers > 1024) {
+                std::cerr << "invalid job worker count" << std::endl;
+                return false;
+            }
+            job_workers = static_cast<int>(workers);
+        } else if (arg == "--pin-jobs") {
+            pin_jobs = true;
+        } else if (arg == "--main-cpus" || arg == "--engine-cpus") {
+            auto &cpus = arg == "--main-cpus" ? main_cpus : engine_cpus;
+            if (!value(option_value) || !ThreadPlacement::parse_cpu_list(option_value, cpus)) {
+                std::cerr << "invalid CPU list, expected e.g. 0-3,8" << std::endl;
+                return false;
+            }
+        } else if (arg == "--numa-node") {
+            int64_t node = 0;
+            if (!value(option_value) || !parse_integer(option_value, node) || node < 0
+                || node > 255) {
+                std::cerr << "invalid NUMA node" << std::endl;
+                return false;
+            }
+            numa_node = static_cast<int>(node);
+        } else if (arg == "--main-priority") {
+            if (!value(option_value)) {
+                return false;
+            }
+            if (option_value == "normal") {
+                main_priority = ThreadPriority::Normal;
+            } else if (option_value == "high") {
+                main_priority = ThreadPriority::High;
+            } else if (option_value == "realtime") {
+                main_priority = ThreadPriority::Realtime;
+            } else {
+                std::cerr << "invalid main thread priority, expected normal, high or realtime"
+                          << std::endl;
+                return false;
+            }
+        } else if (arg == "--encode") {
+            if (!value(option_value) || !parse_encode_format(option_value, encode_format)) {
+                std::cerr << "invalid encoder, expected raw, png or h264" << std::endl;
+                return false;
+            }
+            capture = true;
+        } else if (arg == "--encode-output") {
+            if (!value(encode_output)) {
+                return false;
+            }
+        } else if (arg == "--encode-policy") {
+            if (!value(option_value) || (option_value != "drop" && option_value != "block")) {
+                std::cerr << "invalid encoder queue policy, expected drop or block" << std::endl;
+                return false;
+            }
+            encode_policy = option_value == "drop" ? QueuePolicy::Drop : QueuePolicy::Block;
+        } else if (arg == "--encode-queue") {
+            int64_t frames = 0;
+            if (!value(option_value) || !parse_integer(option_value, frames) || frames <= 0
+                || frames > 1024) {
+                std::cerr << "invalid encoder queue size" << std::endl;
+                return false;
+            }
+            encode_queue = static_cast<int>(frames);
+        } else {
+            engine_args.push_back(arg);
+        }
+    }
+
+    // As before, the first argument left for the engine names the project
+    bool has_project = engine_args.size() >= 2 && engine_args[1].rfind("-", 0) != 0
+                       && engine_args[1] != "++";
+    if (has_project) {
+        project_path = engine_args[1];
+    } else if (!warm_start) {
+        print_usage();
+        return false;
+    }
+
+    // Replicas share one command line, keep their reports apart
+    if (replica_index >= 0 && !stats_file.empty() && stats_file != "-") {
+        stats_file += "." + std::to_string(replica_index);
+    }
+
+    if (replica_index >= 0 && !profile_path.empty()) {
+        profile_path += "." + std::to_string(replica_index);
+    }
+
+    if (replica_index >= 0 && !control_socket.empty()) {
+        control_socket += "." + std::to_string(replica_index);
+    }
+
+    if (replica_index >= 0 && !shm_name.empty()) {
+        shm_name += "." + std::to_string(replica_index);
+    }
+
+    if (shm_lockstep && shm_name.empty()) {
+        std::cerr << "--shm-lockstep needs a --shm segment name" << std::endl;
+        return false;
+    }
+
+    // A log covers one continuous run of one project, fed only by the host
+    bool input_log = !record_path.empty() || !replay_path.empty();
+    if (!record_path.empty() && !replay_path.empty()) {
+        std::cerr << "--record cannot be combined with --replay" << std::endl;
+        return false;
+    }
+    if (input_log && (warm_start || reload_on_signal || watch_project)) {
+        std::cerr << "--record and --replay cannot be combined with --warm-start, "
+                     "--reload-on-signal or --watch"
+                  << std::endl;
+        return false;
+    }
+    if (!replay_path.empty() && !shm_name.empty()) {
+        std::cerr << "--replay cannot be combined with --shm, the commands come from the log"
+                  << std::endl;
+        return false;
+    }
+    if (!replay_path.empty() && !InputReplay::read_fixed_fps(replay_path, record_fps)) {
+        std::cerr << "cannot read input log " << replay_path << std::endl;
+        return false;
+    }
+    if (replica_index >= 0 && !record_path.empty()) {
+        record_path += "." + std::to_string(replica_index);
+    }
+
+    // Threads of a NUMA node stay on its CPUs unless given others
+    if (numa_node >= 0) {
+        std::vector<unsigned> node_cpus;
+        if (!ThreadPlacement::numa_node_cpus(numa_node, node_cpus)) {
+            std::cerr << "NUMA node " << numa_node << " does not exist" << std::endl;
+            return false;
+        }
+        if (main_cpus.empty()) {
+            main_cpus = node_cpus;
+        }
+        if (engine_cpus.empty()) {
+            engine_cpus = node_cpus;
+        }
+    }
+    if (pin_jobs && !engine_cpus.empty()) {
+        std::cerr << "--pin-jobs cannot be combined with --engine-cpus or --numa-node" << std::endl;
+        return false;
+    }
+
+    if (encode_format != EncodeFormat::None && encode_output.empty()) {
+        std::cerr << "--encode needs an --encode-output path" << std::endl;
+        return false;
+    }
+
+    // Replicas would all write to the same encoder output
+    if (replica_index >= 0 && !encode_output.empty()) {
+        encode_output += "." + std::to_string(replica_index);
+    }
+
+    // The dummy renderer of a headless engine has no pixels to read back
+    if (capture && (bench_iterations > 0 || simulate)) {
+        std::cerr << "--capture cannot be combined with --bench or --simulate, which run headless"
+                  << std::endl;
+        return false;
+    }
+    auto user_args = std::find_if(engine_args.begin() + 1, engine_args.end(),
+                                  [](const std::string &a) { return a == "--" || a == "++"; });
+    bool headless  = std::find(engine_args.begin() + 1, user_args, "--headless") != user_args;
+    if (capture && headless) {
+        std::cerr << "--capture cannot be combined with --headless" << std::endl;
+        return false;
+    }
+
+    // The pipeline cache is written while the engine shuts down
+    if (warm_shader_cache && fast_exit) {
+        std::cerr << "--warm-shader-cache cannot be combined with --fast-exit" << std::endl;
+        return false;
+    }
+
+    // Warming needs a renderer and runs exactly one project
+    if (warm_shader_cache && (bench_iterations > 0 || warm_start || simulate)) {
+        std::cerr << "--warm-shader-cache cannot be combined with --bench, --warm-start or "
+                     "--simulate"
+                  << std::endl;
+        return false;
+    }
+
+    // --headless already selects the headless display, dummy rendering and dummy audio
+    // drivers; the render loop is also skipped, so iterations do no drawing work at all.
+    if (simulate) {
+        add_engine_argument("--headless");
+        add_engine_argument("--disable-render-loop");
+        add_engine_argument("--xr-mode");
+        add_engine_argument("off");
+    }
+
+    // Recorded iterations all get the same delta, so a replay feeds the engine the same timesteps.
+    // A benchmark of a replay runs at the log's rate, a recorded benchmark at its own.
+    if (input_log && bench_iterations > 0) {
+        if (replay_path.empty()) {
+            record_fps = bench_fps;
+        } else {
+            bench_fps = record_fps;
+        }
+    } else if (input_log) {
+        add_engine_argument("--fixed-fps");
+        add_engine_argument(std::to_string(record_fps));
+    }
+
+    // Benchmarks run headless with a fixed delta per iteration and no host pacing
+    if (bench_iterations > 0) {
+        if (!simulate) {
+            add_engine_argument("--headless");
+        }
+        add_engine_argument("--fixed-fps");
+        add_engine_argument(std::to_string(bench_fps));
+        frame_pacing = FramePacing::Unlimited;
+    }
+    return true;
+}
+
+void HostOptions::add_engine_argument(const std::string &arg)
+{
+    auto separator = std::find_if(engine_args.begin() + 1, engine_args.end(),
+                                  [](const std::string &a) { return a == "--" || a == "++"; });
+    engine_args.insert(separator, arg);
+}
+
+std::vector<char *> HostOptions::engine_argv()
+{
+    std::vector<char *> argv;
+    argv.reserve(engine_args.size() + 1);
+    for (auto &arg : engine_args) {
+        argv.push_back(arg.data());
+    }
+    argv.push_back(nullptr);
+    return argv;
+}
+
+void HostOptions::print_usage()
+{
+    std::cerr << "Usage: " PROJECT_NAME " [host options] <project_path_or_pck> [engine arguments]\n"
+              << "\n"
+              << "Host options:\n"
+              << "  --frame-rate <hz|vsync|unlimited>\n"
+              << "      Pace engine iterations from the host (default: unlimited).\n"
+              << "  --frame-budget <ms>\n"
+              << "      Bound iteration time by limiting physics catch-up steps when behind.\n"
+              << "  --stats-file <path|->\n"
+              << "      Write frame time histograms as JSON Lines at shutdown.\n"
+              << "  --stats-interval <seconds>\n"
+              << "      Also write a report every interval while running.\n"
+              << "  --memory-interval <iterations>\n"
+              << "      Also sample memory every interval iterations (default: per report).\n"
+              << "  --memory-budget <subsystem>=<MiB>\n"
+              << "      Warn when rss, static, video, texture, buffer or arena exceeds it.\n"
+              << "  --memory-trim\n"
+              << "      Drop prefetched resources and trim the heap when a budget is exceeded.\n"
+              << "  --profile <path>\n"
+              << "      Sample call stacks of all threads and write them at shutdown.\n"
+              << "  --profile-format <folded|chrome>\n"
+              << "      Folded stacks for flame graphs or a Chrome trace (default: folded).\n"
+              << "  --profile-rate <hz>\n"
+              << "      Samples per second of CPU time (default: 999).\n"
+              << "  --bench <iterations>\n"
+              << "      Run exactly this many iterations headless and report throughput.\n"
+              << "  --bench-fps <fps>\n"
+              << "      Fixed simulated frame rate of the benchmark (default: 60).\n"
+              << "  --simulate\n"
+              << "      Run physics and scripts only, without display, audio or rendering.\n"
+              << "  --fast-exit\n"
+              << "      Flush host output and exit without unloading the project or the engine.\n"
+              << "  --instances <count>\n"
+              << "      Run this many replicas, one process each, and wait for all of them.\n"
+              << "  --startup-report\n"
+              << "      Print the startup timeline after the first frame of each project.\n"
+              << "  --warm-start\n"
+              << "      Keep the engine after a project ends and load the next one from stdin.\n"
+              << "  --reload-on-signal\n"
+              << "      Unload and reload the project on the same instance on SIGHUP.\n"
+              << "  --watch\n"
+              << "      Reload the project on the same instance when it changes on disk.\n"
+              << "  --preload-pack\n"
+              << "      Map a pck project into memory and prefetch it before loading it.\n"
+              << "  --shared-cache\n"
+              << "      Load one copy of each pck project, indexed by content in /dev/shm.\n"
+              << "  --shared-cache-dir <path>\n"
+              << "      Directory to keep the per-user store in, implies --shared-cache.\n"
+              << "  --prefetch <res://path>\n"
+              << "      Load a resource on worker threads right after the project, repeatable.\n"
+              << "  --warm-shader-cache\n"
+              << "      Draw every material off-screen to fill the shader caches, then exit.\n"
+              << "  --shader-cache-dir <path>\n"
+              << "      Export the caches there after warming, import them at startup otherwise.\n"
+              << "  --control-socket <path>\n"
+              << "      Accept press, release and quit commands on a Unix socket at path.\n"
+              << "  --shm <name>\n"
+              << "      Exchange commands and state with a supervisor through shared memory.\n"
+              << "  --shm-lockstep\n"
+              << "      Run one iteration per step the supervisor grants over --shm.\n"
+              << "  --record <path>\n"
+              << "      Log the commands and duration of every iteration, at a fixed timestep.\n"
+              << "  --record-fps <fps>\n"
+              << "      Fixed timestep of the recording, as --fixed-fps (default: 60).\n"
+              << "  --replay <path>\n"
+              << "      Feed a recorded log back into the iterations and compare their times.\n"
+              << "  --capture\n"
+              << "      Read back the rendered root viewport after every iteration.\n"
+              << "  --jobs <workers>\n"
+              << "      Job system workers for native classes (default: one per extra core).\n"
+              << "  --pin-jobs\n"
+              << "      Pin each job worker to its own CPU.\n"
+              << "  --main-cpus <list>\n"
+              << "      CPUs the thread running the iterations may use, e.g. 2 or 0-3,8.\n"
+              << "  --engine-cpus <list>\n"
+              << "      CPUs of the threads the engine starts and of the job workers.\n"
+              << "  --numa-node <node>\n"
+              << "      Bind memory to a NUMA node, and threads to its CPUs unless given others.\n"
+              << "  --main-priority <normal|high|realtime>\n"
+              << "      Scheduling priority of the thread running the iterations.\n"
+              << "  --encode <raw|png|h264>\n"
+              << "      Encode captured frames on a background thread, implies --capture.\n"
+              << "  --encode-output <path>\n"
+              << "      Raw or H.264 output file, or the directory for the PNG sequence.\n"
+              << "  --encode-policy <drop|block>\n"
+              << "      Drop frames or wait when the encoder queue is full (default: drop).\n"
+              << "  --encode-queue <frames>\n"
+              << "      Frames the encoder queue can hold (default: 8).\n"
+              << std::flush;
+}
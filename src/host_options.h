@@ -0,0 +1,102 @@
+/*
+ * Command line options consumed by the host before the rest is handed to the engine.
+ */
+
+#pragma once
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+#include "frame_encoder.h"
+#include "frame_scheduler.h"
+#include "memory_report.h"
+#include "sampling_profiler.h"
+#include "thread_placement.h"
+
+struct HostOptions {
+    std::string              project_path;
+    std::vector<std::string> engine_args; // argv[0] plus every argument not consumed by the host
+
+    FramePacing frame_pacing = FramePacing::Unlimited;
+    double      frame_rate   = 60.0;
+
+    double frame_budget_ms = 0.0; // Iteration time budget, 0 to let iterations take any time
+
+    std::string stats_file;             // JSON Lines report destination, "-" for stdout
+    double      stats_interval_s = 0.0; // Seconds between periodic reports, 0 for shutdown only
+
+    uint64_t                  memory_interval = 0;     // Iterations between memory samples, or 0
+    std::vector<MemoryBudget> memory_budgets;          // Per-subsystem limits of the memory report
+    bool                      memory_trim     = false; // Give memory back when a budget is exceeded
+
+    std::string   profile_path;                           // Sampling profiler output, or empty
+    ProfileFormat profile_format = ProfileFormat::Folded;
+    int           profile_rate   = 999;                   // Samples per second of CPU time
+
+    uint64_t bench_iterations = 0;  // Run exactly this many iterations headless, 0 to disable
+    int      bench_fps        = 60; // Fixed simulated frame rate of the benchmark
+
+    int instances     = 1;  // Number of replica processes to run side by side
+    int replica_index = -1; // Index of this process when started as a replica
+
+    bool startup_report = false; // Print the startup timeline after the first frame
+    bool warm_start     = false; // Keep the instance and read further projects from stdin
+    bool simulate       = false; // Physics and scripts only, with dummy display, audio and renderer
+    bool preload_pack   = false; // Map a pck project into memory before the engine mounts it
+    bool fast_exit      = false; // Flush host output and end the process without engine teardown
+
+    bool reload_on_signal = false; // Reload the project in place on SIGHUP
+    bool watch_project    = false; // Reload the project in place when it changes on disk
+
+    std::string shared_cache; // Store directory for pck projects, empty to load them in place
+
+    std::vector<std::string> prefetch; // Resources to load on worker threads after each load
+
+    bool        warm_shader_cache = false; // Draw every material off-screen once, then exit
+    std::string shader_cache_dir;          // Exported by --warm-shader-cache, imported otherwise
+
+    std::string control_socket; // Unix socket accepting input and quit commands, or empty
+
+    std::string shm_name;             // Shared memory segment for a supervisor, or empty
+    bool        shm_lockstep = false; // Run one iteration per step the supervisor grants
+
+    std::string record_path;     // Log of the inputs of every iteration, or empty
+    std::string replay_path;     // Log to feed back instead of live commands, or empty
+    int         record_fps = 60; // Fixed timestep of a recording, from the log when replaying
+
+    bool capture = false; // Read back the root viewport after every iteration
+
+    int  job_workers = -1;    // Job system worker threads, -1 for one per core besides the caller
+    bool pin_jobs    = false; // Pin each job worker to its own CPU
+
+    std::vector<unsigned> main_cpus;                            // CPUs of the iteration thread
+    std::vector<unsigned> engine_cpus;                          // CPUs of engine and job threads
+    int                   numa_node     = -1;                   // Node to bind memory to, or -1
+    ThreadPriority        main_priority = ThreadPriority::Normal;
+
+    EncodeFormat encode_format = EncodeFormat::None; // Encode captured frames, implies capture
+    std::string  encode_output;                      // File or directory the encoder writes to
+    QueuePolicy  encode_policy = QueuePolicy::Drop;  // What to do when the encoder falls behind
+    int          encode_queue  = 8;                  // Frames buffered for the encoder thread
+
+    /*
+     * Splits argv into host options and engine arguments. Host options are only recognized
+     * before a "--" separator; the first remaining argument is the project path or pck, which
+     * may be omitted with --warm-start.
+     * Prints the problem and returns false on invalid input.
+     */
+    bool parse(int argc, char *argv[]);
+
+    /*
+     * Adds an argument for the engine, keeping it ahead of any "--" user argument separator.
+     */
+    void add_engine_argument(const std::string &arg);
+
+    /*
+     * Returns a null-terminated argv view of engine_args; valid while engine_args is unchanged.
+     */
+    std::vector<char *> engine_argv();
+
+    static void print_usage();
+};
@@ -0,0 +1,261 @@
+#include "input_log.h"
+
+#include <algorithm>
+#include <cstring>
+#include <iostream>
+#include <iterator>
+
+#include "json_writer.h"
+
+namespace
+{
+constexpr char     log_magic[4]     = {'G', 'T', 'I', 'L'};
+constexpr uint32_t log_version      = 1;
+constexpr size_t   header_size      = 16;
+constexpr size_t   flush_block_size = 64 * 1024;
+
+void put_varint(std::vector<uint8_t> &r_out, uint64_t value)
+{
+    while (value >= 0x80) {
+        r_out.push_back(static_cast<uint8_t>(value | 0x80));
+        value >>= 7;
+    }
+    r_out.push_back(static_cast<uint8_t>(value));
+}
+
+bool get_varint(const uint8_t *&r_cursor, const uint8_t *end, uint64_t &r_value)
+{
+    r_value = 0;
+    for (int shift = 0; shift < 64 && r_cursor < end; shift += 7) {
+        uint8_t byte = *r_cursor++;
+        r_value |= static_cast<uint64_t>(byte & 0x7f) << shift;
+        if ((byte & 0x80) == 0) {
+            return true;
+        }
+    }
+    return false;
+}
+
+bool parse_header(const uint8_t *data, size_t size, int &r_fixed_fps)
+{
+    if (size < header_size || std::memcmp(data, log_magic, sizeof(log_magic)) != 0) {
+        return false;
+    }
+    uint32_t version = 0;
+    uint32_t fps     = 0;
+    std::memcpy(&version, data + 4, sizeof(version));
+    std::memcpy(&fps, data + 8, sizeof(fps));
+    if (version != log_version || fps == 0) {
+        return false;
+    }
+    r_fixed_fps = static_cast<int>(fps);
+    return true;
+}
+} // namespace
+
+InputRecorder::InputRecorder(std::string p_path, int p_fixed_fps)
+    : path(std::move(p_path))
+    , fixed_fps(p_fixed_fps)
+{
+}
+
+InputRecorder::~InputRecorder()
+{
+    close();
+}
+
+bool InputRecorder::open()
+{
+    file.open(path, std::ios::binary | std::ios::trunc);
+    if (!file) {
+        std::cerr << "failed to create input log " << path << std::endl;
+        return false;
+    }
+
+    uint8_t  header[header_size] = {};
+    uint32_t fps                 = static_cast<uint32_t>(fixed_fps);
+    std::memcpy(header, log_magic, sizeof(log_magic));
+    std::memcpy(header + 4, &log_version, sizeof(log_version));
+    std::memcpy(header + 8, &fps, sizeof(fps));
+    buffer.reserve(flush_block_size + 1024);
+    buffer.assign(std::begin(header), std::end(header));
+    return true;
+}
+
+void InputRecorder::record(const ChannelCommand &command)
+{
+    auto size = std::min<size_t>(command.size, sizeof(command.payload));
+    put_varint(commands, command.type);
+    put_varint(commands, size);
+    commands.insert(commands.end(), command.payload, command.payload + size);
+    ++iteration_commands;
+}
+
+void InputRecorder::end_iteration(uint64_t iteration_ns)
+{
+    if (!file.is_open()) {
+        return;
+    }
+
+    put_varint(buffer, iteration_ns / 1000);
+    put_varint(buffer, iteration_commands);
+    buffer.insert(buffer.end(), commands.begin(), commands.end());
+    commands.clear();
+    total_commands += iteration_commands;
+    iteration_commands = 0;
+    ++iterations;
+
+    if (buffer.size() >= flush_block_size) {
+        flush();
+    }
+}
+
+void InputRecorder::flush()
+{
+    file.write(reinterpret_cast<const char *>(buffer.data()),
+               static_cast<std::streamsize>(buffer.size()));
+    bytes_written += buffer.size();
+    buffer.clear();
+}
+
+void InputRecorder::close()
+{
+    if (!file.is_open()) {
+        return;
+    }
+
+    // Commands of an iteration that never ran are not part of the log
+    commands.clear();
+    iteration_commands = 0;
+    flush();
+    file.close();
+    if (!file) {
+        std::cerr << "failed to write input log " << path << std::endl;
+    }
+}
+
+void InputRecorder::write_json(JsonWriter &json) const
+{
+    json.field("path", path);
+    json.field("fixed_fps", fixed_fps);
+    json.field("iterations", iterations);
+    json.field("commands", total_commands);
+    json.field("bytes", bytes_written + buffer.size());
+}
+
+InputReplay::InputReplay(std::string p_path)
+    : path(std::move(p_path))
+{
+}
+
+bool InputReplay::read_fixed_fps(const std::string &path, int &r_fixed_fps)
+{
+    std::ifstream file(path, std::ios::binary);
+    uint8_t       header[header_size] = {};
+    file.read(reinterpret_cast<char *>(header), sizeof(header));
+    return file && parse_header(header, sizeof(header), r_fixed_fps);
+}
+
+bool InputReplay::open()
+{
+    std::ifstream        file(path, std::ios::binary);
+    std::vector<uint8_t> data((std::istreambuf_iterator<char>(file)),
+                              std::istreambuf_iterator<char>());
+    int                  fixed_fps = 0;
+    if (!parse_header(data.data(), data.size(), fixed_fps)) {
+        std::cerr << "not an input log: " << path << std::endl;
+        return false;
+    }
+
+    iterations.clear();
+    commands.clear();
+    next = 0;
+
+    const uint8_t *cursor = data.data() + header_size;
+    const uint8_t *end    = data.data() + data.size();
+    while (cursor < end) {
+        Iteration iteration;
+        uint64_t  count = 0;
+        if (!get_varint(cursor, end, iteration.recorded_us) || !get_varint(cursor, end, count)) {
+            break;
+        }
+        iteration.first_command = commands.size();
+        for (uint64_t i = 0; i < count; ++i) {
+            ChannelCommand command;
+            uint64_t       type = 0;
+            uint64_t       size = 0;
+            if (!get_varint(cursor, end, type) || !get_varint(cursor, end, size)
+                || size > sizeof(command.payload) || size > static_cast<uint64_t>(end - cursor)) {
+                std::cerr << "input log " << path << " is truncated after " << iterations.size()
+                          << " iterations" << std::endl;
+                commands.resize(iteration.first_command);
+                return !iterations.empty();
+            }
+            command.type = static_cast<uint32_t>(type);
+            command.size = static_cast<uint32_t>(size);
+            std::memcpy(command.payload, cursor, size);
+            cursor += size;
+            commands.push_back(command);
+        }
+        iteration.command_count = commands.size() - iteration.first_command;
+        iterations.push_back(iteration);
+    }
+    return true;
+}
+
+void InputReplay::apply(const ControlChannel::CommandHandler &handler)
+{
+    if (is_done()) {
+        return;
+    }
+
+    auto &iteration = iterations[next];
+    for (size_t i = 0; i < iteration.command_count; ++i) {
+        handler(commands[iteration.first_command + i]);
+    }
+}
+
+void InputReplay::end_iteration(uint64_t iteration_ns)
+{
+    if (!is_done()) {
+        iterations[next++].replayed_us = iteration_ns / 1000;
+    }
+}
+
+void InputReplay::write_json(JsonWriter &json) const
+{
+    uint64_t recorded_total = 0;
+    uint64_t replayed_total = 0;
+    uint64_t recorded_max   = 0;
+    uint64_t replayed_max   = 0;
+    int64_t  max_regression = 0;
+    size_t   regressed      = 0;
+    for (size_t i = 0; i < next; ++i) {
+        auto &iteration = iterations[i];
+        recorded_total += iteration.recorded_us;
+        replayed_total += iteration.replayed_us;
+        recorded_max = std::max(recorded_max, iteration.recorded_us);
+        replayed_max = std::max(replayed_max, iteration.replayed_us);
+
+        // The iteration that got slowest is where to point the profiler
+        auto regression = static_cast<int64_t>(iteration.replayed_us)
+                        - static_cast<int64_t>(iteration.recorded_us);
+        if (regression > max_regression) {
+            max_regression = regression;
+            regressed      = i;
+        }
+    }
+
+    json.field("path", path);
+    json.field("iterations", iterations.size());
+    json.field("replayed", next);
+    json.field("commands", commands.size());
+    json.field("recorded_mean_us",
+               next > 0 ? static_cast<double>(recorded_total) / static_cast<double>(next) : 0.0);
+    json.field("replayed_mean_us",
+               next > 0 ? static_cast<double>(replayed_total) / static_cast<double>(next) : 0.0);
+    json.field("recorded_max_us", recorded_max);
+    json.field("replayed_max_us", replayed_max);
+    json.field("max_regression_us", max_regression);
+    json.field("max_regression_iteration", regressed);
+}
@@ -0,0 +1,124 @@
+/*
+ * Recording and replay of the inputs the host feeds into engine iterations.
+ */
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <fstream>
+#include <string>
+#include <vector>
+
+#include "control_channel.h"
+
+class JsonWriter;
+
+/*
+ * Writes the commands the host applies before each iteration, and how long the iteration took,
+ * to a compact binary log. The engine runs with a fixed timestep (--fixed-fps) while recording,
+ * so the log together with the project fully determines what the iterations were fed:
+ *
+ *   header     "GTIL", uint32 version, uint32 fixed frame rate, uint32 reserved (host byte order)
+ *   iteration  varint duration in microseconds, varint command count, then per command
+ *              varint type, varint payload size and the payload bytes
+ *
+ * Iterations without commands take two or three bytes. Records are buffered and written in
+ * blocks of 64 KiB, so an iteration costs no system call; a process that crashes loses at most
+ * the last block.
+ */
+class InputRecorder
+{
+  public:
+    InputRecorder(std::string p_path, int p_fixed_fps);
+    ~InputRecorder();
+
+    InputRecorder(const InputRecorder &)            = delete;
+    InputRecorder &operator=(const InputRecorder &) = delete;
+
+    /*
+     * Creates the log and writes its header. Prints the problem and returns false on failure.
+     */
+    bool open();
+
+    /*
+     * Adds a command applied before the current iteration.
+     */
+    void record(const ChannelCommand &command);
+
+    /*
+     * Completes the record of the iteration that just ran.
+     */
+    void end_iteration(uint64_t iteration_ns);
+
+    /*
+     * Writes what is buffered and closes the log.
+     */
+    void close();
+
+    void write_json(JsonWriter &json) const;
+
+  private:
+    void flush();
+
+    std::string          path;
+    int                  fixed_fps;
+    std::ofstream        file;
+    std::vector<uint8_t> buffer;   // Complete iteration records not yet written
+    std::vector<uint8_t> commands; // Encoded commands of the current iteration
+    uint64_t             iteration_commands = 0;
+    uint64_t             iterations         = 0;
+    uint64_t             total_commands     = 0;
+    uint64_t             bytes_written      = 0;
+};
+
+/*
+ * Feeds a log written by InputRecorder back into the host, one iteration's commands before each
+ * iteration, and compares every iteration's duration against the recorded one. The engine must
+ * run with the log's fixed frame rate, see read_fixed_fps().
+ */
+class InputReplay
+{
+  public:
+    explicit InputReplay(std::string p_path);
+
+    /*
+     * Reads the frame rate from the header of the log at path. Returns false if it is no log.
+     */
+    static bool read_fixed_fps(const std::string &path, int &r_fixed_fps);
+
+    /*
+     * Reads the whole log. Prints the problem and returns false on failure.
+     */
+    bool open();
+
+    /*
+     * Hands the commands recorded before the next iteration to handler.
+     */
+    void apply(const ControlChannel::CommandHandler &handler);
+
+    /*
+     * Compares the iteration that just ran against its record and moves on to the next one.
+     */
+    void end_iteration(uint64_t iteration_ns);
+
+    bool is_done() const
+    {
+        return next >= iterations.size();
+    }
+
+    void write_json(JsonWriter &json) const;
+
+  private:
+    struct Iteration {
+        uint64_t recorded_us   = 0;
+        uint64_t replayed_us   = 0;
+        size_t   first_command = 0;
+        size_t   command_count = 0;
+    };
+
+    std::string                 path;
+    std::vector<Iteration>      iterations;
+    std::vector<ChannelCommand> commands;
+    size_t                      next = 0;
+};
@@ -0,0 +1,260 @@
+#include "job_system.h"
+
+#include <algorithm>
+
+#if defined(_WIN32)
+#define NOMINMAX
+#include <windows.h>
+#elif defined(__linux__)
+#include <pthread.h>
+#include <sched.h>
+#endif
+
+#if defined(__x86_64__) || defined(__i386__) || defined(_M_X64) || defined(_M_IX86)
+#include <immintrin.h>
+#endif
+
+#include "json_writer.h"
+#include "sampling_profiler.h"
+
+namespace
+{
+JobSystem *current_jobs = nullptr;
+
+// Index of the queue the current thread submits to, 0 outside the pool
+thread_local size_t queue_index = 0;
+
+// Checks for new work this often before an idle worker goes to sleep
+constexpr int idle_spins = 2048;
+
+void cpu_relax()
+{
+#if defined(__x86_64__) || defined(__i386__) || defined(_M_X64) || defined(_M_IX86)
+    _mm_pause();
+#elif defined(__aarch64__)
+    asm volatile("yield");
+#endif
+}
+
+class SpinGuard
+{
+  public:
+    explicit SpinGuard(std::atomic_flag &p_flag)
+        : flag(p_flag)
+    {
+        while (flag.test_and_set(std::memory_order_acquire)) {
+            while (flag.test(std::memory_order_relaxed)) {
+                cpu_relax();
+            }
+        }
+    }
+
+    ~SpinGuard()
+    {
+        flag.clear(std::memory_order_release);
+    }
+
+  private:
+    std::atomic_flag &flag;
+};
+
+void pin_to_cpu(std::thread &thread, unsigned cpu)
+{
+#if defined(_WIN32)
+    SetThreadAffinityMask(static_cast<HANDLE>(thread.native_handle()), DWORD_PTR(1) << cpu);
+#elif defined(__linux__)
+    cpu_set_t set;
+    CPU_ZERO(&set);
+    CPU_SET(cpu, &set);
+    pthread_setaffinity_np(thread.native_handle(), sizeof(set), &set);
+#else
+    // No thread affinity API (macOS), leave placement to the scheduler
+    (void)thread;
+    (void)cpu;
+#endif
+}
+} // namespace
+
+bool JobSystem::Queue::push(const Job &job)
+{
+    SpinGuard guard(lock);
+    if (tail - head == capacity) {
+        return false;
+    }
+    jobs[tail++ % capacity] = job;
+    return true;
+}
+
+bool JobSystem::Queue::pop(Job &r_job)
+{
+    SpinGuard guard(lock);
+    if (tail == head) {
+        return false;
+    }
+    r_job = jobs[--tail % capacity];
+    return true;
+}
+
+bool JobSystem::Queue::steal(Job &r_job)
+{
+    SpinGuard guard(lock);
+    if (tail == head) {
+        return false;
+    }
+    r_job = jobs[head++ % capacity];
+    return true;
+}
+
+JobSystem *JobSystem::current()
+{
+    return current_jobs;
+}
+
+JobSystem::~JobSystem()
+{
+    stop();
+}
+
+void JobSystem::start(int p_worker_count, bool pin_threads)
+{
+    stop();
+
+    auto count = static_cast<size_t>(std::max(p_worker_count, 0));
+    queues.clear();
+    for (size_t i = 0; i < count + 1; ++i) {
+        queues.push_back(std::make_unique<Queue>());
+    }
+
+    auto cpus = std::max(1u, std::thread::hardware_concurrency());
+    stopping.store(false, std::memory_order_relaxed);
+    for (size_t i = 0; i < count; ++i) {
+        workers.emplace_back([this, i] { worker_main(i); });
+        if (pin_threads) {
+            pin_to_cpu(workers.back(), static_cast<unsigned>((i + 1) % cpus));
+        }
+    }
+    current_jobs = this;
+}
+
+void JobSystem::stop()
+{
+    if (current_jobs == this) {
+        current_jobs = nullptr;
+    }
+    if (workers.empty()) {
+        return;
+    }
+
+    stopping.store(true, std::memory_order_release);
+    work_available.fetch_add(1, std::memory_order_release);
+    work_available.notify_all();
+    for (auto &worker : workers) {
+        worker.join();
+    }
+    workers.clear();
+}
+
+void JobSystem::run_chunks(size_t count, size_t grain, const void *context, ChunkFunc func)
+{
+    if (count == 0) {
+        return;
+    }
+    parallel_fors.fetch_add(1, std::memory_order_relaxed);
+
+    grain       = std::max<size_t>(grain, 1);
+    auto chunks = (count + grain - 1) / grain;
+    if (workers.empty() || chunks == 1) {
+        func(context, 0, count);
+        jobs_run.fetch_add(1, std::memory_order_relaxed);
+        return;
+    }
+
+    std::atomic<size_t> pending{chunks};
+    auto               &queue = *queues[queue_index];
+    for (size_t chunk = 0; chunk < chunks; ++chunk) {
+        Job job{func, context, chunk * grain, std::min(count, (chunk + 1) * grain), &pending};
+        if (!queue.push(job)) {
+            execute(job);
+            jobs_inline.fetch_add(1, std::memory_order_relaxed);
+        }
+    }
+    work_available.fetch_add(1, std::memory_order_release);
+    work_available.notify_all();
+
+    // Work along instead of blocking, this thread's own chunks first
+    while (pending.load(std::memory_order_acquire) > 0) {
+        Job  job;
+        bool stolen = false;
+        if (find_job(queue_index, job, stolen)) {
+            execute(job);
+            if (stolen) {
+                jobs_stolen.fetch_add(1, std::memory_order_relaxed);
+            }
+        } else {
+            cpu_relax();
+        }
+    }
+}
+
+bool JobSystem::find_job(size_t own_queue, Job &r_job, bool &r_stolen)
+{
+    r_stolen = false;
+    if (queues[own_queue]->pop(r_job)) {
+        return true;
+    }
+
+    r_stolen = true;
+    for (size_t i = 1; i < queues.size(); ++i) {
+        if (queues[(own_queue + i) % queues.size()]->steal(r_job)) {
+            return true;
+        }
+    }
+    return false;
+}
+
+void JobSystem::execute(const Job &job)
+{
+    ProfileScope scope("job");
+    job.func(job.context, job.begin, job.end);
+    jobs_run.fetch_add(1, std::memory_order_relaxed);
+    job.pending->fetch_sub(1, std::memory_order_release);
+}
+
+void JobSystem::worker_main(size_t index)
+{
+    queue_index = index + 1;
+
+    while (!stopping.load(std::memory_order_acquire)) {
+        // Read the signal first so work submitted after a failed search still wakes us
+        auto signal = work_available.load(std::memory_order_acquire);
+
+        Job  job;
+        bool stolen = false;
+        if (find_job(queue_index, job, stolen)) {
+            execute(job);
+            if (stolen) {
+                jobs_stolen.fetch_add(1, std::memory_order_relaxed);
+            }
+            continue;
+        }
+
+        // Per-frame work arrives in bursts, spin a little before paying for a wakeup
+        int spins = 0;
+        while (spins < idle_spins && work_available.load(std::memory_order_relaxed) == signal) {
+            cpu_relax();
+            ++spins;
+        }
+        if (spins == idle_spins) {
+            work_available.wait(signal, std::memory_order_acquire);
+        }
+    }
+}
+
+void JobSystem::write_json(JsonWriter &json) const
+{
+    json.field("workers", workers.size());
+    json.field("parallel_fors", parallel_fors.load(std::memory_order_relaxed));
+    json.field("jobs", jobs_run.load(std::memory_order_relaxed));
+    json.field("stolen", jobs_stolen.load(std::memory_order_relaxed));
+    json.field("inline", jobs_inline.load(std::memory_order_relaxed));
+}
@@ -0,0 +1,107 @@
+/*
+ * Host-owned work-stealing job system for per-frame work of the host's native classes.
+ */
+
+#pragma once
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <thread>
+#include <vector>
+
+class JsonWriter;
+
+/*
+ * A fixed set of worker threads, each with its own job queue. A thread that submits work pushes
+ * it onto its own queue and runs it from the back; idle workers steal from the front of the
+ * other queues. parallel_for() returns only once every chunk has run, with the calling thread
+ * working along, so jobs submitted from engine callbacks are joined before the current
+ * libgodot_iteration_godot_instance() returns.
+ */
+class JobSystem
+{
+  public:
+    /*
+     * Returns the running job system, for native classes called by the engine without user
+     * data. Null until start().
+     */
+    static JobSystem *current();
+
+    JobSystem() = default;
+    ~JobSystem();
+
+    JobSystem(const JobSystem &)            = delete;
+    JobSystem &operator=(const JobSystem &) = delete;
+
+    /*
+     * Starts the workers; with zero workers every parallel_for() runs inline. With pin_threads,
+     * worker i is pinned to CPU i + 1, leaving CPU 0 to the engine's main thread.
+     */
+    void start(int p_worker_count, bool pin_threads);
+    void stop();
+
+    /*
+     * Calls fn(begin, end) on chunks of [0, count) of at most grain items, on all workers, and
+     * waits for all of them.
+     */
+    template <typename F>
+    void parallel_for(size_t count, size_t grain, const F &fn)
+    {
+        run_chunks(count, grain, &fn, [](const void *context, size_t begin, size_t end) {
+            (*static_cast<const F *>(context))(begin, end);
+        });
+    }
+
+    int worker_count() const
+    {
+        return static_cast<int>(workers.size());
+    }
+
+    void write_json(JsonWriter &json) const;
+
+  private:
+    using ChunkFunc = void (*)(const void *context, size_t begin, size_t end);
+
+    struct Job {
+        ChunkFunc            func    = nullptr;
+        const void          *context = nullptr;
+        size_t               begin   = 0;
+        size_t               end     = 0;
+        std::atomic<size_t> *pending = nullptr; // Chunks of the parallel_for still running
+    };
+
+    /*
+     * Bounded deque behind a spin lock: the owner pushes and pops at the back, thieves take
+     * from the front. Critical sections are a few instructions long.
+     */
+    struct Queue {
+        static constexpr size_t capacity = 1024;
+
+        std::atomic_flag lock = ATOMIC_FLAG_INIT;
+        std::vector<Job> jobs = std::vector<Job>(capacity);
+        size_t           head = 0; // Oldest job, taken by thieves
+        size_t           tail = 0; // One past the newest job, owned by the submitting thread
+
+        bool push(const Job &job);
+        bool pop(Job &r_job);
+        bool steal(Job &r_job);
+    };
+
+    void run_chunks(size_t count, size_t grain, const void *context, ChunkFunc func);
+    bool find_job(size_t own_queue, Job &r_job, bool &r_stolen);
+    void execute(const Job &job);
+    void worker_main(size_t index);
+
+    // Queue 0 belongs to threads outside the pool (the engine's main thread), worker i owns i + 1
+    std::vector<std::unique_ptr<Queue>> queues;
+    std::vector<std::thread>            workers;
+    std::atomic<uint32_t>               work_available{0}; // Bumped on every submission
+    std::atomic<bool>                   stopping{false};
+
+    std::atomic<uint64_t> parallel_fors{0};
+    std::atomic<uint64_t> jobs_run{0};
+    std::atomic<uint64_t> jobs_stolen{0};
+    std::atomic<uint64_t> jobs_inline{0}; // Run on the submitting thread because a queue was full
+};
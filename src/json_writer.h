@@ -0,0 +1,148 @@
+/*
+ * Minimal streaming JSON writer for the host's reports.
+ */
+
+#pragma once
+
+#include <cmath>
+#include <ostream>
+#include <string>
+#include <type_traits>
+#include <vector>
+
+/*
+ * Writes compact JSON to a stream. Callers are responsible for balancing begin/end calls.
+ */
+class JsonWriter
+{
+  public:
+    explicit JsonWriter(std::ostream &p_out)
+        : out(p_out)
+    {
+    }
+
+    void begin_object(const char *key = nullptr)
+    {
+        open(key, '{');
+    }
+
+    void end_object()
+    {
+        close('}');
+    }
+
+    void begin_array(const char *key = nullptr)
+    {
+        open(key, '[');
+    }
+
+    void end_array()
+    {
+        close(']');
+    }
+
+    void field(const char *key, const std::string &value)
+    {
+        prefix(key);
+        write_string(value);
+    }
+
+    void field(const char *key, const char *value)
+    {
+        field(key, std::string(value));
+    }
+
+    void field(const char *key, bool value)
+    {
+        prefix(key);
+        out << (value ? "true" : "false");
+    }
+
+    template <typename T>
+        requires(std::is_integral_v<T> && !std::is_same_v<T, bool>)
+    void field(const char *key, T value)
+    {
+        prefix(key);
+        out << +value;
+    }
+
+    void field(const char *key, double value)
+    {
+        prefix(key);
+        // JSON has no representation for NaN or infinity
+        if (std::isfinite(value)) {
+            out << value;
+        } else {
+            out << "null";
+        }
+    }
+
+    /*
+     * Writes an array element.
+     */
+    template <typename T>
+    void value(const T &element)
+    {
+        field(nullptr, element);
+    }
+
+  private:
+    void prefix(const char *key)
+    {
+        if (!first.empty()) {
+            if (!first.back()) {
+                out << ',';
+            }
+            first.back() = false;
+        }
+        if (key != nullptr) {
+            write_string(key);
+            out << ':';
+        }
+    }
+
+    void open(const char *key, char bracket)
+    {
+        prefix(key);
+        out << bracket;
+        first.push_back(true);
+    }
+
+    void close(char bracket)
+    {
+        out << bracket;
+        first.pop_back();
+    }
+
+    void write_string(const std::string &text)
+    {
+        out << '"';
+        for (char c : text) {
+            switch (c) {
+                case '"':
+                    out << "\\\"";
+                    break;
+                case '\\':
+                    out << "\\\\";
+                    break;
+                case '\n':
+                    out << "\\n";
+                    break;
+                case '\t':
+                    out << "\\t";
+                    break;
+                default:
+                    if (static_cast<unsigned char>(c) < 0x20) {
+                        static const char hex[] = "0123456789abcdef";
+                        out << "\\u00" << hex[(c >> 4) & 0xf] << hex[c & 0xf];
+                    } else {
+                        out << c;
+                    }
+            }
+        }
+        out << '"';
+    }
+
+    std::ostream     &out;
+    std::vector<bool> first;
+};
@@ -0,0 +1,138 @@
+#include "latency_histogram.h"
+
+#include <algorithm>
+#include <bit>
+
+#include "json_writer.h"
+
+size_t HistogramSnapshot::bucket_index(uint64_t value)
+{
+    if (value < 2 * sub_bucket_count) {
+        return static_cast<size_t>(value);
+    }
+
+    int magnitude = std::bit_width(value) - 1;
+    if (magnitude >= max_value_bits) {
+        return bucket_count - 1;
+    }
+
+    // The top sub_bucket_bits + 1 bits select the bucket within this power of two
+    int shift = magnitude - sub_bucket_bits;
+    return static_cast<size_t>(shift) * sub_bucket_count + static_cast<size_t>(value >> shift);
+}
+
+uint64_t HistogramSnapshot::bucket_lowest(size_t index)
+{
+    if (index < 2 * sub_bucket_count) {
+        return index;
+    }
+
+    int      shift = static_cast<int>(index / sub_bucket_count) - 1;
+    uint64_t sub   = index % sub_bucket_count + sub_bucket_count;
+    return sub << shift;
+}
+
+uint64_t HistogramSnapshot::bucket_highest(size_t index)
+{
+    if (index < 2 * sub_bucket_count) {
+        return index;
+    }
+
+    int shift = static_cast<int>(index / sub_bucket_count) - 1;
+    return bucket_lowest(index) + (uint64_t(1) << shift) - 1;
+}
+
+uint64_t HistogramSnapshot::percentile(double percent) const
+{
+    if (count == 0) {
+        return 0;
+    }
+
+    auto target = static_cast<uint64_t>(percent / 100.0 * static_cast<double>(count) + 0.5);
+    target      = std::clamp<uint64_t>(target, 1, count);
+
+    uint64_t seen = 0;
+    for (size_t i = 0; i < bucket_count; ++i) {
+        seen += counts[i];
+        if (seen >= target) {
+            return std::min(std::max(bucket_highest(i), min), max);
+        }
+    }
+    return max;
+}
+
+HistogramSnapshot HistogramSnapshot::since(const HistogramSnapshot &earlier) const
+{
+    HistogramSnapshot result;
+    for (size_t i = 0; i < bucket_count; ++i) {
+        result.counts[i] = counts[i] - earlier.counts[i];
+        if (result.counts[i] != 0) {
+            result.min = std::min(result.min, bucket_lowest(i));
+            result.max = std::max(result.max, bucket_highest(i));
+        }
+    }
+    result.count = count - earlier.count;
+    result.sum   = sum - earlier.sum;
+
+    // The exact extremes are still known when they fall into the window's outer buckets
+    if (result.count > 0) {
+        result.min = std::max(result.min, min);
+        result.max = std::min(result.max, max);
+    }
+    return result;
+}
+
+void HistogramSnapshot::write_json(JsonWriter &json) const
+{
+    constexpr double us = 1000.0;
+
+    json.field("count", count);
+    json.field("mean_us", mean() / us);
+    json.field("min_us", count > 0 ? static_cast<double>(min) / us : 0.0);
+    json.field("p50_us", static_cast<double>(percentile(50.0)) / us);
+    json.field("p90_us", static_cast<double>(percentile(90.0)) / us);
+    json.field("p99_us", static_cast<double>(percentile(99.0)) / us);
+    json.field("p999_us", static_cast<double>(percentile(99.9)) / us);
+    json.field("max_us", static_cast<double>(max) / us);
+}
+
+void LatencyHistogram::record(uint64_t value_ns)
+{
+    counts[HistogramSnapshot::bucket_index(value_ns)].fetch_add(1, std::memory_order_relaxed);
+    count.fetch_add(1, std::memory_order_relaxed);
+    sum.fetch_add(value_ns, std::memory_order_relaxed);
+
+    uint64_t current = min.load(std::memory_order_relaxed);
+    while (value_ns < current
+           && !min.compare_exchange_weak(current, value_ns, std::memory_order_relaxed)) {}
+
+    current = max.load(std::memory_order_relaxed);
+    while (value_ns > current
+           && !max.compare_exchange_weak(current, value_ns, std::memory_order_relaxed)) {}
+}
+
+HistogramSnapshot LatencyHistogram::snapshot() const
+{
+    // Counters are read one by one; a concurrent record() may be half visible, which only
+    // skews totals by the samples in flight
+    HistogramSnapshot result;
+    for (size_t i = 0; i < HistogramSnapshot::bucket_count; ++i) {
+        result.counts[i] = counts[i].load(std::memory_order_relaxed);
+    }
+    result.count = count.load(std::memory_order_relaxed);
+    result.sum   = sum.load(std::memory_order_relaxed);
+    result.min   = min.load(std::memory_order_relaxed);
+    result.max   = max.load(std::memory_order_relaxed);
+    return result;
+}
+
+void LatencyHistogram::reset()
+{
+    for (auto &bucket : counts) {
+        bucket.store(0, std::memory_order_relaxed);
+    }
+    count.store(0, std::memory_order_relaxed);
+    sum.store(0, std::memory_order_relaxed);
+    min.store(UINT64_MAX, std::memory_order_relaxed);
+    max.store(0, std::memory_order_relaxed);
+}
@@ -0,0 +1,79 @@
+/*
+ * Lock-free log-linear latency histogram in the spirit of HdrHistogram.
+ */
+
+#pragma once
+
+#include <array>
+#include <atomic>
+#include <cstdint>
+
+class JsonWriter;
+
+/*
+ * Plain copy of a histogram's counters, used for reporting and for computing the difference
+ * between two points in time.
+ */
+struct HistogramSnapshot {
+    // Values below 2 * sub_bucket_count are exact, above that each power of two is split into
+    // sub_bucket_count linear buckets, keeping the relative error below 1%
+    static constexpr int      sub_bucket_bits  = 7;
+    static constexpr uint64_t sub_bucket_count = uint64_t(1) << sub_bucket_bits;
+    static constexpr int      max_value_bits   = 40; // ~18 minutes in nanoseconds
+    static constexpr size_t   bucket_count =
+        (max_value_bits - sub_bucket_bits) * sub_bucket_count + sub_bucket_count;
+
+    std::array<uint64_t, bucket_count> counts{};
+
+    uint64_t count = 0;
+    uint64_t sum   = 0;
+    uint64_t min   = UINT64_MAX;
+    uint64_t max   = 0;
+
+    static size_t   bucket_index(uint64_t value);
+    static uint64_t bucket_lowest(size_t index);
+    static uint64_t bucket_highest(size_t index);
+
+    /*
+     * Returns the highest value equivalent to the given percentile (0-100), or 0 if empty.
+     */
+    uint64_t percentile(double percent) const;
+
+    double mean() const
+    {
+        return count > 0 ? static_cast<double>(sum) / static_cast<double>(count) : 0.0;
+    }
+
+    /*
+     * Returns the samples recorded between an earlier snapshot and this one. Min and max are
+     * approximated from bucket bounds since they cannot be subtracted.
+     */
+    HistogramSnapshot since(const HistogramSnapshot &earlier) const;
+
+    /*
+     * Writes count, mean, min, percentiles and max in microseconds.
+     */
+    void write_json(JsonWriter &json) const;
+};
+
+/*
+ * Records nanosecond durations with relaxed atomics so any thread can record or snapshot
+ * without taking a lock. Values beyond the tracked range are clamped into the last bucket.
+ */
+class LatencyHistogram
+{
+  public:
+    void record(uint64_t value_ns);
+
+    HistogramSnapshot snapshot() const;
+
+    void reset();
+
+  private:
+    std::array<std::atomic<uint64_t>, HistogramSnapshot::bucket_count> counts{};
+
+    std::atomic<uint64_t> count{0};
+    std::atomic<uint64_t> sum{0};
+    std::atomic<uint64_t> min{UINT64_MAX};
+    std::atomic<uint64_t> max{0};
+};
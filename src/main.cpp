@@ -1,13 +1,21 @@
 /*
  * A light-weight test app that embeds and runs the Godot engine
  *
- * Usage: godot_test --path <path_to_project>
+ * Usage: godot_test [host options] <project_path_or_pck> [engine arguments]
  */
 
 #include <iostream>
 
 #include <libgodot.h>
 
+#include "godot_api.h"
+#include "host.h"
+#include "host_options.h"
+#include "native_rotator.h"
+#include "replica_launcher.h"
+#include "rotator_batch.h"
+#include "shared_cache.h"
+
 /*
  * Custom Godot GDExtension initialization entry point.
  */
@@ -15,17 +23,37 @@ GDExtensionBool init_extension(GDExtensionInterfaceGetProcAddress p_get_proc_add
                                GDExtensionClassLibraryPtr         p_library,
                                GDExtensionInitialization         *r_initialization)
 {
+    // Resolve the interface functions the host uses to talk to the engine
+    if (!GodotApi::get().load(p_get_proc_address, p_library)) {
+        return false;
+    }
+
     // Only require the scene initialization level for this extension
     r_initialization->minimum_initialization_level = GDEXTENSION_INITIALIZATION_SCENE;
 
     // Called when Godot loads the extension
     r_initialization->initialize = [](void *userdata, GDExtensionInitializationLevel level) {
         std::cout << "initializing Godot extension" << std::endl;
+        if (level == GDEXTENSION_INITIALIZATION_SCENE) {
+            register_native_rotator();
+            register_rotator_batch();
+        }
+        if (auto host = Host::current()) {
+            host->on_extension_initialize(level);
+        }
     };
 
     // Called when Godot unloads the extension
     r_initialization->deinitialize = [](void *userdata, GDExtensionInitializationLevel level) {
         std::cout << "shutting down Godot extension" << std::endl;
+        if (auto host = Host::current()) {
+            host->on_extension_deinitialize(level);
+        }
+        if (level == GDEXTENSION_INITIALIZATION_SCENE) {
+            unregister_rotator_batch();
+            unregister_native_rotator();
+            GodotApi::get().unload();
+        }
     };
 
     return true;
@@ -33,32 +61,20 @@ GDExtensionBool init_extension(GDExtensionInterfaceGetProcAddress p_get_proc_add
 
 int main(int argc, char *argv[])
 {
-    if (argc < 2) {
-        std::cerr << "Usage: godot_test <project_path_or_pck>" << std::endl;
+    HostOptions options;
+    if (!options.parse(argc, argv)) {
         return EXIT_FAILURE;
     }
-    const char *project_path = argv[1];
 
-    // Create an embedded Godot engine instance
-    auto instance = libgodot_create_godot_instance(argc, argv, init_extension);
-    if (instance == nullptr) {
-        std::cerr << "failed to initialize Godot Engine instance" << std::endl;
-        return EXIT_FAILURE;
+    // Engine singletons are process-global, so replicas get a process each
+    if (options.instances > 1) {
+        // Hash a new pack once here instead of in every replica, they find it in the index
+        if (!options.shared_cache.empty() && !options.project_path.empty()) {
+            SharedCache(options.shared_cache).resolve(options.project_path);
+        }
+        return run_replicas(argc, argv, options.instances);
     }
 
-    // Load and start the project after the engine is initialized.
-    if (!libgodot_load_project(instance, project_path)) {
-        std::cerr << "failed to load Godot project: " << project_path << std::endl;
-        libgodot_destroy_godot_instance(instance);
-        return EXIT_FAILURE;
-    }
-
-    // Run Godot's per-frame iteration loop until it returns true (e.g. engine requests shutdown)
-    while (!libgodot_iteration_godot_instance(instance)) {}
-
-    // Cleanly destroy the engine instance
-    libgodot_unload_project(instance);
-    libgodot_destroy_godot_instance(instance);
-
-    return EXIT_SUCCESS;
+    Host host(options);
+    return host.run();
 }
@@ -0,0 +1,147 @@
+#include "memory_report.h"
+
+#include <algorithm>
+#include <iostream>
+
+#include "frame_arena.h"
+#include "godot_api.h"
+#include "json_writer.h"
+#include "process_stats.h"
+
+namespace
+{
+const char *subsystem_names[] = {"rss", "static", "video", "texture", "buffer", "arena"};
+
+const char *count_names[] = {"objects",      "resources",         "nodes",
+                             "orphan_nodes", "physics_2d_active", "physics_3d_active"};
+
+// Performance.Monitor values, stable since Godot 4.0
+constexpr int64_t monitor_memory_static         = 4;
+constexpr int64_t monitor_object_count          = 7;
+constexpr int64_t monitor_object_resource_count = 8;
+constexpr int64_t monitor_object_node_count     = 9;
+constexpr int64_t monitor_object_orphan_count   = 10;
+constexpr int64_t monitor_video_mem_used        = 14;
+constexpr int64_t monitor_texture_mem_used      = 15;
+constexpr int64_t monitor_buffer_mem_used       = 16;
+constexpr int64_t monitor_physics_2d_active     = 17;
+constexpr int64_t monitor_physics_3d_active     = 20;
+
+double mebibytes(uint64_t bytes)
+{
+    return static_cast<double>(bytes) / (1024.0 * 1024.0);
+}
+} // namespace
+
+MemoryReport::MemoryReport(uint64_t p_interval, std::vector<MemoryBudget> p_budgets)
+    : interval(p_interval)
+{
+    for (auto &budget : p_budgets) {
+        for (int i = 0; i < SubsystemCount; ++i) {
+            if (budget.subsystem == subsystem_names[i]) {
+                limits.push_back({static_cast<Subsystem>(i), budget.bytes});
+            }
+        }
+    }
+}
+
+bool MemoryReport::is_subsystem(const std::string &name)
+{
+    for (auto subsystem : subsystem_names) {
+        if (name == subsystem) {
+            return true;
+        }
+    }
+    return false;
+}
+
+void MemoryReport::set_trim_handler(TrimHandler handler)
+{
+    trim = std::move(handler);
+}
+
+void MemoryReport::poll(uint64_t iteration)
+{
+    if (interval > 0 && iteration - last_sample_iteration >= interval) {
+        last_sample_iteration = iteration;
+        sample();
+    }
+}
+
+void MemoryReport::sample()
+{
+    current[Rss]   = ProcessUsage::query().rss_bytes;
+    current[Arena] = FrameArena::reserved_bytes();
+
+    auto performance = godot_singleton("Performance");
+    if (!performance.is_nil()) {
+        auto monitor = [&](int64_t id) {
+            auto value = performance.call("get_monitor", {GodotVariant::from_int(id)}).to_float();
+            return value > 0.0 ? static_cast<uint64_t>(value) : 0;
+        };
+        current[Static]          = monitor(monitor_memory_static);
+        current[Video]           = monitor(monitor_video_mem_used);
+        current[Texture]         = monitor(monitor_texture_mem_used);
+        current[Buffer]          = monitor(monitor_buffer_mem_used);
+        counts[Objects]          = monitor(monitor_object_count);
+        counts[Resources]        = monitor(monitor_object_resource_count);
+        counts[Nodes]            = monitor(monitor_object_node_count);
+        counts[OrphanNodes]      = monitor(monitor_object_orphan_count);
+        counts[PhysicsObjects2D] = monitor(monitor_physics_2d_active);
+        counts[PhysicsObjects3D] = monitor(monitor_physics_3d_active);
+    }
+    for (int i = 0; i < SubsystemCount; ++i) {
+        peak[i] = std::max(peak[i], current[i]);
+    }
+    ++samples;
+
+    // Warn and trim once per crossing, not on every sample above the budget
+    bool trim_now = false;
+    for (auto &limit : limits) {
+        bool exceeded = current[limit.subsystem] > limit.bytes;
+        if (exceeded && !limit.exceeded) {
+            ++limit.breaches;
+            trim_now = true;
+            std::cerr << "memory budget exceeded: " << subsystem_names[limit.subsystem] << " "
+                      << mebibytes(current[limit.subsystem]) << " MiB > "
+                      << mebibytes(limit.bytes) << " MiB" << std::endl;
+        }
+        limit.exceeded = exceeded;
+    }
+    if (trim_now && trim) {
+        ++trims;
+        trim();
+    }
+}
+
+void MemoryReport::write_json(JsonWriter &json) const
+{
+    json.field("samples", samples);
+    json.begin_object("bytes");
+    for (int i = 0; i < SubsystemCount; ++i) {
+        json.field(subsystem_names[i], current[i]);
+    }
+    json.end_object();
+    json.begin_object("peak_bytes");
+    for (int i = 0; i < SubsystemCount; ++i) {
+        json.field(subsystem_names[i], peak[i]);
+    }
+    json.end_object();
+    json.begin_object("counts");
+    for (int i = 0; i < CountCount; ++i) {
+        json.field(count_names[i], counts[i]);
+    }
+    json.end_object();
+
+    json.begin_array("budgets");
+    for (auto &limit : limits) {
+        json.begin_object();
+        json.field("subsystem", subsystem_names[limit.subsystem]);
+        json.field("bytes", limit.bytes);
+        json.field("exceeded", limit.exceeded);
+        json.field("breaches", limit.breaches);
+        json.end_object();
+    }
+    json.end_array();
+    json.field("trims", trims);
+}
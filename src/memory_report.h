@@ -0,0 +1,101 @@
+/*
+ * Memory footprint of the engine and the host, broken down by subsystem, with optional budgets.
+ */
+
+#pragma once
+
+#include <cstdint>
+#include <functional>
+#include <string>
+#include <vector>
+
+class JsonWriter;
+
+/*
+ * A limit on one subsystem of the memory report, see MemoryReport for the names.
+ */
+struct MemoryBudget {
+    std::string subsystem;
+    uint64_t    bytes = 0;
+};
+
+/*
+ * Samples where the process's memory goes, every interval iterations and for every stats report:
+ *
+ *   rss      resident set size of the whole process
+ *   static   engine heap allocations (Performance MEMORY_STATIC), only counted in debug builds
+ *   video    video memory used by the renderer (RENDER_VIDEO_MEM_USED)
+ *   texture  of which textures (RENDER_TEXTURE_MEM_USED)
+ *   buffer   of which buffers (RENDER_BUFFER_MEM_USED)
+ *   arena    blocks reserved by the host's frame arenas
+ *
+ * plus object, resource, node and orphan node counts and physics active objects as a proxy for
+ * what the servers and the resource cache hold, since the engine does not account memory per
+ * server. Each sample is compared against the budgets; crossing one prints a warning and, when
+ * a trim handler is installed, calls it to give memory back.
+ */
+class MemoryReport
+{
+  public:
+    using TrimHandler = std::function<void()>;
+
+    MemoryReport(uint64_t p_interval, std::vector<MemoryBudget> p_budgets);
+
+    /*
+     * Returns false for a subsystem the report does not know.
+     */
+    static bool is_subsystem(const std::string &name);
+
+    void set_trim_handler(TrimHandler handler);
+
+    /*
+     * Samples when interval iterations passed since the last sample. Call after each iteration.
+     */
+    void poll(uint64_t iteration);
+
+    /*
+     * Samples now and checks the budgets. Needs the engine for everything but rss and arena.
+     */
+    void sample();
+
+    void write_json(JsonWriter &json) const;
+
+  private:
+    enum Subsystem {
+        Rss,
+        Static,
+        Video,
+        Texture,
+        Buffer,
+        Arena,
+        SubsystemCount,
+    };
+
+    enum Count {
+        Objects,
+        Resources,
+        Nodes,
+        OrphanNodes,
+        PhysicsObjects2D,
+        PhysicsObjects3D,
+        CountCount,
+    };
+
+    struct Limit {
+        Subsystem subsystem;
+        uint64_t  bytes;
+        bool      exceeded = false;
+        uint64_t  breaches = 0;
+    };
+
+    uint64_t           interval;
+    std::vector<Limit> limits;
+    TrimHandler        trim;
+
+    uint64_t last_sample_iteration   = 0;
+    uint64_t samples                 = 0;
+    uint64_t trims                   = 0;
+    uint64_t current[SubsystemCount] = {};
+    uint64_t peak[SubsystemCount]    = {};
+    uint64_t counts[CountCount]      = {};
+};
@@ -0,0 +1,98 @@
+#include "native_rotator.h"
+
+#include <iostream>
+#include <memory>
+
+#include "godot_api.h"
+
+namespace
+{
+// Hash of Node3D.rotate_x(float) in extension_api.json
+constexpr GDExtensionInt rotate_x_hash = 373806689;
+
+struct RotatorClass {
+    GodotStringName          name{"NativeRotator"};
+    GodotStringName          parent{"MeshInstance3D"};
+    GodotStringName          node3d{"Node3D"};
+    GodotStringName          process{"_process"};
+    GodotStringName          rotate_x{"rotate_x"};
+    GDExtensionMethodBindPtr rotate_x_bind = nullptr; // Null if the hash does not match
+};
+
+std::unique_ptr<RotatorClass> rotator_class;
+
+// The engine object a NativeRotator instance belongs to
+struct Rotator {
+    GDExtensionObjectPtr owner = nullptr;
+};
+
+GDExtensionObjectPtr create_instance(void *p_class_userdata, GDExtensionBool p_notify)
+{
+    auto &api    = GodotApi::get();
+    auto  object = api.classdb_construct_object2(rotator_class->parent.ptr());
+    auto  self   = new Rotator{object};
+    api.object_set_instance(object, rotator_class->name.ptr(), self);
+    return object;
+}
+
+void free_instance(void *p_class_userdata, GDExtensionClassInstancePtr p_instance)
+{
+    delete static_cast<Rotator *>(p_instance);
+}
+
+void process(GDExtensionClassInstancePtr p_instance, const GDExtensionConstTypePtr *p_args,
+             GDExtensionTypePtr r_ret)
+{
+    auto self = static_cast<Rotator *>(p_instance);
+
+    // Floats are passed as double to pointer calls, whatever the engine's precision
+    auto delta = *static_cast<const double *>(p_args[0]);
+    if (rotator_class->rotate_x_bind != nullptr) {
+        GDExtensionConstTypePtr args[] = {&delta};
+        GodotApi::get().object_method_bind_ptrcall(rotator_class->rotate_x_bind, self->owner, args,
+                                                   nullptr);
+    } else {
+        GodotVariant::from_object(self->owner).call(rotator_class->rotate_x,
+                                                    {GodotVariant::from_float(delta)});
+    }
+}
+
+GDExtensionClassCallVirtual get_virtual(void                         *p_class_userdata,
+                                        GDExtensionConstStringNamePtr p_name, uint32_t p_hash)
+{
+    return rotator_class->process == p_name ? process : nullptr;
+}
+} // namespace
+
+void register_native_rotator()
+{
+    auto &api     = GodotApi::get();
+    rotator_class = std::make_unique<RotatorClass>();
+
+    // A direct pointer call skips the by-name lookup and Variant boxing of every frame
+    rotator_class->rotate_x_bind = api.classdb_get_method_bind(
+        rotator_class->node3d.ptr(), rotator_class->rotate_x.ptr(), rotate_x_hash);
+    if (rotator_class->rotate_x_bind == nullptr) {
+        std::cerr << "Node3D.rotate_x has an unexpected hash, NativeRotator calls it by name"
+                  << std::endl;
+    }
+
+    GDExtensionClassCreationInfo4 info = {};
+    info.is_exposed                    = true;
+    info.create_instance_func          = create_instance;
+    info.free_instance_func            = free_instance;
+    info.get_virtual_func              = get_virtual;
+    api.classdb_register_extension_class4(api.library, rotator_class->name.ptr(),
+                                          rotator_class->parent.ptr(), &info);
+}
+
+void unregister_native_rotator()
+{
+    if (!rotator_class) {
+        return;
+    }
+
+    auto &api = GodotApi::get();
+    api.classdb_unregister_extension_class(api.library, rotator_class->name.ptr());
+    rotator_class.reset();
+}
@@ -0,0 +1,16 @@
+/*
+ * NativeRotator: a compiled replacement for sample/cube.gd, registered by the host's extension.
+ */
+
+#pragma once
+
+/*
+ * Registers NativeRotator, a MeshInstance3D whose _process rotates it around X by delta, like
+ * cube.gd does from GDScript. Call at the SCENE initialization level.
+ */
+void register_native_rotator();
+
+/*
+ * Unregisters the class again, before the interface is unloaded.
+ */
+void unregister_native_rotator();
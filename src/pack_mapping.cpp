@@ -0,0 +1,164 @@
+#include "pack_mapping.h"
+
+#include <iostream>
+
+#if defined(_WIN32)
+#define NOMINMAX
+#include <windows.h>
+#else
+#include <cerrno>
+#include <cstring>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#include <vector>
+#endif
+
+#include "json_writer.h"
+
+namespace
+{
+#if !defined(_WIN32)
+// Counts the pages of a mapping that are already in memory
+bool count_resident(void *data, size_t length, size_t &r_bytes)
+{
+    auto page_size = static_cast<size_t>(sysconf(_SC_PAGESIZE));
+    auto pages     = (length + page_size - 1) / page_size;
+#if defined(__APPLE__)
+    std::vector<char> residency(pages);
+#else
+    std::vector<unsigned char> residency(pages);
+#endif
+    if (mincore(data, length, residency.data()) != 0) {
+        return false;
+    }
+
+    r_bytes = 0;
+    for (auto page : residency) {
+        r_bytes += (page & 1) ? page_size : 0;
+    }
+    r_bytes = r_bytes < length ? r_bytes : length;
+    return true;
+}
+#endif
+} // namespace
+
+PackMapping::~PackMapping()
+{
+    unmap();
+}
+
+bool PackMapping::map(const std::string &p_path)
+{
+    unmap();
+    path           = p_path;
+    mapped_bytes   = 0;
+    resident_bytes = 0;
+    resident_known = false;
+
+#if defined(_WIN32)
+    file = CreateFileA(path.c_str(), GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING,
+                       FILE_FLAG_SEQUENTIAL_SCAN, nullptr);
+    if (file == INVALID_HANDLE_VALUE) {
+        file = nullptr;
+        std::cerr << "failed to open pack for mapping: " << path << std::endl;
+        return false;
+    }
+
+    LARGE_INTEGER file_size;
+    if (!GetFileSizeEx(file, &file_size) || file_size.QuadPart == 0) {
+        unmap();
+        return false;
+    }
+
+    mapping = CreateFileMappingA(file, nullptr, PAGE_READONLY, 0, 0, nullptr);
+    data    = mapping != nullptr ? MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0) : nullptr;
+    if (data == nullptr) {
+        std::cerr << "failed to map pack: " << path << std::endl;
+        unmap();
+        return false;
+    }
+    length = static_cast<size_t>(file_size.QuadPart);
+
+    // Prefetch asynchronously, then touch every page so the mapping is complete on return
+    WIN32_MEMORY_RANGE_ENTRY range = {data, length};
+    PrefetchVirtualMemory(GetCurrentProcess(), 1, &range, 0);
+    volatile uint8_t sink = 0;
+    for (size_t offset = 0; offset < length; offset += 4096) {
+        sink = sink + bytes()[offset];
+    }
+#else
+    int fd = open(path.c_str(), O_RDONLY | O_CLOEXEC);
+    if (fd < 0) {
+        std::cerr << "failed to open pack for mapping: " << path << ": " << std::strerror(errno)
+                  << std::endl;
+        return false;
+    }
+
+    struct stat info;
+    if (fstat(fd, &info) != 0 || !S_ISREG(info.st_mode) || info.st_size == 0) {
+        close(fd);
+        return false;
+    }
+    length = static_cast<size_t>(info.st_size);
+
+    // Look at the page cache first, then populate the mapping in one go
+    void *probe = mmap(nullptr, length, PROT_READ, MAP_SHARED, fd, 0);
+    if (probe != MAP_FAILED) {
+        resident_known = count_resident(probe, length, resident_bytes);
+        munmap(probe, length);
+    }
+
+#if defined(MAP_POPULATE)
+    data = mmap(nullptr, length, PROT_READ, MAP_SHARED | MAP_POPULATE, fd, 0);
+#else
+    data = mmap(nullptr, length, PROT_READ, MAP_SHARED, fd, 0);
+#endif
+    close(fd);
+    if (data == MAP_FAILED) {
+        data = nullptr;
+        std::cerr << "failed to map pack: " << path << ": " << std::strerror(errno) << std::endl;
+        length = 0;
+        return false;
+    }
+    madvise(data, length, MADV_WILLNEED);
+#endif
+    mapped_bytes = length;
+    ++maps;
+    return true;
+}
+
+void PackMapping::unmap()
+{
+#if defined(_WIN32)
+    if (data != nullptr) {
+        UnmapViewOfFile(data);
+    }
+    if (mapping != nullptr) {
+        CloseHandle(mapping);
+    }
+    if (file != nullptr) {
+        CloseHandle(file);
+    }
+    mapping = nullptr;
+    file    = nullptr;
+#else
+    if (data != nullptr) {
+        munmap(data, length);
+    }
+#endif
+    data   = nullptr;
+    length = 0;
+}
+
+void PackMapping::write_json(JsonWriter &json) const
+{
+    json.field("path", path);
+    json.field("mapped", is_mapped());
+    json.field("maps", maps);
+    json.field("bytes", mapped_bytes);
+    if (resident_known) {
+        json.field("resident_before_bytes", resident_bytes);
+    }
+}
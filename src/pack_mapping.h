@@ -0,0 +1,68 @@
+/*
+ * Read-only memory mapping of a project pack, prefetched before the engine mounts it.
+ */
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+
+class JsonWriter;
+
+/*
+ * Maps a .pck file shared and read-only and faults the whole file into the page cache. The
+ * engine still opens the pack by path and reads it through its own file access, which the
+ * public API offers no way around, but those reads are then served from memory instead of
+ * disk. Because the mapping is shared, replicas that preload the same pack map the same
+ * physical pages, and keeping the mapping for the project's lifetime keeps resources the
+ * engine loads later resident.
+ */
+class PackMapping
+{
+  public:
+    PackMapping() = default;
+    ~PackMapping();
+
+    PackMapping(const PackMapping &)            = delete;
+    PackMapping &operator=(const PackMapping &) = delete;
+
+    /*
+     * Maps and prefetches the file. Returns false, with the reason on stderr, if it cannot be
+     * mapped; the engine then simply reads it from disk.
+     */
+    bool map(const std::string &path);
+    void unmap();
+
+    bool is_mapped() const
+    {
+        return data != nullptr;
+    }
+
+    const uint8_t *bytes() const
+    {
+        return static_cast<const uint8_t *>(data);
+    }
+
+    size_t size() const
+    {
+        return length;
+    }
+
+    void write_json(JsonWriter &json) const;
+
+  private:
+    std::string path;
+    void       *data   = nullptr;
+    size_t      length = 0;
+
+    // Statistics of the last mapping, kept after unmap() for the final report
+    size_t   mapped_bytes   = 0;
+    size_t   resident_bytes = 0; // Already in the page cache before prefetching, 0 if unknown
+    bool     resident_known = false;
+    uint64_t maps           = 0;
+#if defined(_WIN32)
+    void *file    = nullptr;
+    void *mapping = nullptr;
+#endif
+};
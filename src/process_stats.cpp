@@ -0,0 +1,85 @@
+#include "process_stats.h"
+
+#if defined(_WIN32)
+#include <windows.h>
+// windows.h must come first
+#include <psapi.h>
+#elif defined(__APPLE__)
+#include <mach/mach.h>
+#include <sys/resource.h>
+#else
+#include <cstdio>
+#include <sys/resource.h>
+#include <unistd.h>
+#endif
+
+namespace
+{
+#if defined(_WIN32)
+double filetime_seconds(const FILETIME &time)
+{
+    ULARGE_INTEGER value;
+    value.LowPart  = time.dwLowDateTime;
+    value.HighPart = time.dwHighDateTime;
+    return static_cast<double>(value.QuadPart) * 1e-7;
+}
+#else
+double timeval_seconds(const timeval &time)
+{
+    return static_cast<double>(time.tv_sec) + static_cast<double>(time.tv_usec) * 1e-6;
+}
+#endif
+} // namespace
+
+ProcessUsage ProcessUsage::query()
+{
+    ProcessUsage usage;
+
+#if defined(_WIN32)
+    FILETIME created, exited, kernel, user;
+    if (GetProcessTimes(GetCurrentProcess(), &created, &exited, &kernel, &user)) {
+        usage.cpu_user_s   = filetime_seconds(user);
+        usage.cpu_system_s = filetime_seconds(kernel);
+    }
+
+    PROCESS_MEMORY_COUNTERS counters;
+    if (GetProcessMemoryInfo(GetCurrentProcess(), &counters, sizeof(counters))) {
+        usage.rss_bytes      = counters.WorkingSetSize;
+        usage.peak_rss_bytes = counters.PeakWorkingSetSize;
+    }
+#else
+    rusage resources;
+    if (getrusage(RUSAGE_SELF, &resources) == 0) {
+        usage.cpu_user_s   = timeval_seconds(resources.ru_utime);
+        usage.cpu_system_s = timeval_seconds(resources.ru_stime);
+#if defined(__APPLE__)
+        // macOS reports bytes, Linux kilobytes
+        usage.peak_rss_bytes = static_cast<uint64_t>(resources.ru_maxrss);
+#else
+        usage.peak_rss_bytes = static_cast<uint64_t>(resources.ru_maxrss) * 1024;
+#endif
+    }
+
+#if defined(__APPLE__)
+    mach_task_basic_info_data_t info;
+    mach_msg_type_number_t      count = MACH_TASK_BASIC_INFO_COUNT;
+    if (task_info(mach_task_self(), MACH_TASK_BASIC_INFO, reinterpret_cast<task_info_t>(&info),
+                  &count)
+        == KERN_SUCCESS) {
+        usage.rss_bytes = info.resident_size;
+    }
+#else
+    // The second field of statm is the resident page count
+    if (FILE *statm = std::fopen("/proc/self/statm", "r")) {
+        unsigned long size = 0, resident = 0;
+        if (std::fscanf(statm, "%lu %lu", &size, &resident) == 2) {
+            usage.rss_bytes = static_cast<uint64_t>(resident)
+                              * static_cast<uint64_t>(sysconf(_SC_PAGESIZE));
+        }
+        std::fclose(statm);
+    }
+#endif
+#endif
+
+    return usage;
+}
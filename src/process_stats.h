@@ -0,0 +1,24 @@
+/*
+ * Process-wide resource usage queried from the OS.
+ */
+
+#pragma once
+
+#include <cstdint>
+
+struct ProcessUsage {
+    double   cpu_user_s     = 0.0; // CPU time spent in user mode by all threads
+    double   cpu_system_s   = 0.0; // CPU time spent in the kernel by all threads
+    uint64_t rss_bytes      = 0;   // Current resident set size
+    uint64_t peak_rss_bytes = 0;   // Peak resident set size since process start
+
+    double cpu_total_s() const
+    {
+        return cpu_user_s + cpu_system_s;
+    }
+
+    /*
+     * Samples the current process. Fields the platform cannot report are left at zero.
+     */
+    static ProcessUsage query();
+};
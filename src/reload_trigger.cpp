@@ -0,0 +1,115 @@
+#include "reload_trigger.h"
+
+#include <algorithm>
+#include <atomic>
+#include <filesystem>
+
+#if !defined(_WIN32)
+#include <csignal>
+#endif
+
+#include "json_writer.h"
+
+namespace fs = std::filesystem;
+
+namespace
+{
+// The watch checks this often and waits this long for the modification time to settle
+constexpr auto check_interval = std::chrono::milliseconds(250);
+constexpr auto settle_time    = std::chrono::milliseconds(500);
+
+std::atomic<bool> reload_signal{false};
+
+#if !defined(_WIN32)
+void request_reload(int)
+{
+    reload_signal.store(true, std::memory_order_relaxed);
+}
+#endif
+} // namespace
+
+ReloadTrigger::ReloadTrigger(bool p_on_signal, bool p_watch)
+    : on_signal(p_on_signal)
+    , watch(p_watch)
+{
+#if !defined(_WIN32)
+    if (on_signal) {
+        struct sigaction action{};
+        action.sa_handler = request_reload;
+        sigemptyset(&action.sa_mask);
+        action.sa_flags = SA_RESTART;
+        sigaction(SIGHUP, &action, nullptr);
+    }
+#endif
+}
+
+ReloadTrigger::~ReloadTrigger()
+{
+#if !defined(_WIN32)
+    if (on_signal) {
+        signal(SIGHUP, SIG_DFL);
+    }
+#endif
+}
+
+void ReloadTrigger::arm(const std::string &path)
+{
+    std::error_code error;
+    watched = fs::is_directory(path, error) ? (fs::path(path) / "project.godot").string() : path;
+    watched_time = modification_time();
+    changed_time = watched_time;
+    next_check   = Clock::now() + check_interval;
+    reload_signal.store(false, std::memory_order_relaxed);
+}
+
+bool ReloadTrigger::poll()
+{
+    if (on_signal && reload_signal.exchange(false, std::memory_order_relaxed)) {
+        ++signal_reloads;
+        return true;
+    }
+
+    auto now = Clock::now();
+    if (!watch || now < next_check) {
+        return false;
+    }
+    next_check = now + check_interval;
+
+    // A missing file (mid-replace) counts as a change that has not settled yet
+    auto time = modification_time();
+    if (time != changed_time) {
+        changed_time = time;
+        changed_at   = now;
+        return false;
+    }
+    if (time == watched_time || time == 0 || now - changed_at < settle_time) {
+        return false;
+    }
+
+    watched_time = time;
+    ++watch_reloads;
+    return true;
+}
+
+void ReloadTrigger::reloaded(std::chrono::duration<double> duration)
+{
+    last_reload_ms = duration.count() * 1000.0;
+    max_reload_ms  = std::max(max_reload_ms, last_reload_ms);
+}
+
+int64_t ReloadTrigger::modification_time() const
+{
+    std::error_code error;
+    auto            time = fs::last_write_time(watched, error);
+    return error ? 0 : static_cast<int64_t>(time.time_since_epoch().count());
+}
+
+void ReloadTrigger::write_json(JsonWriter &json) const
+{
+    json.field("on_signal", on_signal);
+    json.field("watch", watch);
+    json.field("signal_reloads", signal_reloads);
+    json.field("watch_reloads", watch_reloads);
+    json.field("last_reload_ms", last_reload_ms);
+    json.field("max_reload_ms", max_reload_ms);
+}
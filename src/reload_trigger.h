@@ -0,0 +1,63 @@
+/*
+ * Triggers for reloading the running project in place.
+ */
+
+#pragma once
+
+#include <chrono>
+#include <cstdint>
+#include <string>
+
+class JsonWriter;
+
+/*
+ * Decides when the host should unload the running project and load it again on the same engine
+ * instance. Two triggers are supported: SIGHUP (POSIX only), so supervisors can request a reload
+ * with kill -HUP, and watching the project for changes. The watch polls the modification time
+ * of the pck, or of project.godot for a project directory, and only fires once the time has
+ * stopped changing for a moment, so a pack that is still being copied is not loaded half-written.
+ */
+class ReloadTrigger
+{
+  public:
+    using Clock = std::chrono::steady_clock;
+
+    ReloadTrigger(bool p_on_signal, bool p_watch);
+    ~ReloadTrigger();
+
+    ReloadTrigger(const ReloadTrigger &)            = delete;
+    ReloadTrigger &operator=(const ReloadTrigger &) = delete;
+
+    /*
+     * Starts watching path for the project that was just loaded and clears pending triggers.
+     */
+    void arm(const std::string &path);
+
+    /*
+     * Returns true once a reload was requested. Called by the host after each iteration.
+     */
+    bool poll();
+
+    /*
+     * Accounts a finished reload; duration covers both unloading and loading the project.
+     */
+    void reloaded(std::chrono::duration<double> duration);
+
+    void write_json(JsonWriter &json) const;
+
+  private:
+    int64_t modification_time() const;
+
+    bool              on_signal;
+    bool              watch;
+    std::string       watched;
+    int64_t           watched_time = 0;
+    int64_t           changed_time = 0; // New time seen by the watch, not yet settled
+    Clock::time_point next_check;
+    Clock::time_point changed_at;
+
+    uint64_t signal_reloads = 0;
+    uint64_t watch_reloads  = 0;
+    double   last_reload_ms = 0.0;
+    double   max_reload_ms  = 0.0;
+};
@@ -0,0 +1,212 @@
+#include "replica_launcher.h"
+
+#include <cstdlib>
+#include <cstring>
+#include <iostream>
+#include <string>
+#include <vector>
+
+#if defined(_WIN32)
+#include <windows.h>
+#else
+#include <cerrno>
+#include <csignal>
+#include <spawn.h>
+#include <sys/wait.h>
+#include <unistd.h>
+
+extern char **environ;
+#endif
+
+namespace
+{
+/*
+ * Returns the arguments for one replica: argv without --instances, with --replica <index>.
+ */
+std::vector<std::string> replica_arguments(int argc, char *argv[], int index)
+{
+    std::vector<std::string> args;
+    args.emplace_back(argv[0]);
+    args.emplace_back("--replica");
+    args.emplace_back(std::to_string(index));
+
+    bool host_args_done = false;
+    for (int i = 1; i < argc; ++i) {
+        std::string arg = argv[i];
+        if (arg == "--" || arg == "++") {
+            host_args_done = true;
+        }
+        if (!host_args_done && arg == "--instances") {
+            ++i;
+            continue;
+        }
+        args.push_back(arg);
+    }
+    return args;
+}
+
+#if defined(_WIN32)
+std::string quote_argument(const std::string &arg)
+{
+    if (!arg.empty() && arg.find_first_of(" \t\"") == std::string::npos) {
+        return arg;
+    }
+
+    // Backslashes are only special in front of a quote, see CommandLineToArgvW
+    std::string quoted      = "\"";
+    size_t      backslashes = 0;
+    for (char c : arg) {
+        if (c == '\\') {
+            ++backslashes;
+            continue;
+        }
+        quoted.append(c == '"' ? backslashes * 2 + 1 : backslashes, '\\');
+        backslashes = 0;
+        quoted.push_back(c);
+    }
+    quoted.append(backslashes * 2, '\\');
+    quoted.push_back('"');
+    return quoted;
+}
+
+int run_replicas_impl(int argc, char *argv[], int count)
+{
+    char executable[MAX_PATH];
+    if (GetModuleFileNameA(nullptr, executable, MAX_PATH) == 0) {
+        std::cerr << "failed to resolve the host executable" << std::endl;
+        return EXIT_FAILURE;
+    }
+
+    std::vector<PROCESS_INFORMATION> replicas;
+    for (int index = 0; index < count; ++index) {
+        std::string command_line;
+        for (const auto &arg : replica_arguments(argc, argv, index)) {
+            command_line += (command_line.empty() ? "" : " ") + quote_argument(arg);
+        }
+
+        STARTUPINFOA        startup{};
+        PROCESS_INFORMATION process{};
+        startup.cb = sizeof(startup);
+        if (!CreateProcessA(executable, command_line.data(), nullptr, nullptr, TRUE, 0, nullptr,
+                            nullptr, &startup, &process)) {
+            std::cerr << "failed to start replica " << index << std::endl;
+            break;
+        }
+        CloseHandle(process.hThread);
+        replicas.push_back(process);
+    }
+
+    int result = replicas.size() == static_cast<size_t>(count) ? EXIT_SUCCESS : EXIT_FAILURE;
+    for (size_t index = 0; index < replicas.size(); ++index) {
+        DWORD exit_code = EXIT_FAILURE;
+        WaitForSingleObject(replicas[index].hProcess, INFINITE);
+        GetExitCodeProcess(replicas[index].hProcess, &exit_code);
+        CloseHandle(replicas[index].hProcess);
+        if (exit_code != EXIT_SUCCESS) {
+            std::cerr << "replica " << index << " exited with code " << exit_code << std::endl;
+            result = EXIT_FAILURE;
+        }
+    }
+    return result;
+}
+#else
+volatile sig_atomic_t stop_signal = 0;
+
+void forward_stop(int signal)
+{
+    stop_signal = signal;
+}
+
+int run_replicas_impl(int argc, char *argv[], int count)
+{
+    // Prefer the resolved binary so replicas match the parent even with a relative argv[0]
+    std::string executable = argv[0];
+#if defined(__linux__)
+    char    resolved[4096];
+    ssize_t length = readlink("/proc/self/exe", resolved, sizeof(resolved) - 1);
+    if (length > 0) {
+        executable.assign(resolved, static_cast<size_t>(length));
+    }
+#endif
+
+    struct sigaction action{};
+    action.sa_handler = forward_stop;
+    sigemptyset(&action.sa_mask);
+    sigaction(SIGTERM, &action, nullptr);
+    sigaction(SIGINT, &action, nullptr);
+
+    std::vector<pid_t> replicas;
+    for (int index = 0; index < count; ++index) {
+        auto                args = replica_arguments(argc, argv, index);
+        std::vector<char *> child_argv;
+        for (auto &arg : args) {
+            child_argv.push_back(arg.data());
+        }
+        child_argv.push_back(nullptr);
+
+        pid_t pid    = 0;
+        int   status = executable.find('/') == std::string::npos
+                           ? posix_spawnp(&pid, executable.c_str(), nullptr, nullptr,
+                                          child_argv.data(), environ)
+                           : posix_spawn(&pid, executable.c_str(), nullptr, nullptr,
+                                         child_argv.data(), environ);
+        if (status != 0) {
+            std::cerr << "failed to start replica " << index << ": " << std::strerror(status)
+                      << std::endl;
+            break;
+        }
+        replicas.push_back(pid);
+    }
+
+    int    result    = replicas.size() == static_cast<size_t>(count) ? EXIT_SUCCESS : EXIT_FAILURE;
+    size_t remaining = replicas.size();
+    bool   forwarded = false;
+    while (remaining > 0) {
+        int   status = 0;
+        pid_t pid    = waitpid(-1, &status, 0);
+        if (pid < 0) {
+            // Interrupted by a stop request; pass it on once and keep reaping
+            if (errno == EINTR && stop_signal != 0 && !forwarded) {
+                for (pid_t replica : replicas) {
+                    kill(replica, SIGTERM);
+                }
+                forwarded = true;
+                continue;
+            }
+            if (errno == EINTR) {
+                continue;
+            }
+            break;
+        }
+
+        for (size_t index = 0; index < replicas.size(); ++index) {
+            if (replicas[index] != pid) {
+                continue;
+            }
+            --remaining;
+            if (!WIFEXITED(status) || WEXITSTATUS(status) != EXIT_SUCCESS) {
+                std::cerr << "replica " << index << " failed with status " << status << std::endl;
+                result = EXIT_FAILURE;
+            }
+        }
+    }
+    return result;
+}
+#endif
+} // namespace
+
+int run_replicas(int argc, char *argv[], int count)
+{
+    print_replica_limitations();
+    std::cout << "starting " << count << " replica processes" << std::endl;
+    return run_replicas_impl(argc, argv, count);
+}
+
+void print_replica_limitations()
+{
+    std::cout << "libgodot supports one engine instance per process: Engine, OS, "
+                 "ProjectSettings, ResourceLoader/ResourceCache, WorkerThreadPool and the "
+                 "Display, Rendering, Physics, Audio, Navigation and Text servers are "
+                 "process-global singletons"
+              << std::endl;
+}
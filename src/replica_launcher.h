@@ -0,0 +1,23 @@
+/*
+ * Runs several engine replicas side by side as child processes.
+ *
+ * libgodot cannot host more than one engine instance per process: Engine, OS, ProjectSettings,
+ * the ResourceLoader/ResourceCache, every server (DisplayServer, RenderingServer, PhysicsServer,
+ * AudioServer, NavigationServer, TextServerManager) and the WorkerThreadPool are process-global
+ * singletons that a second libgodot_create_godot_instance() would overwrite. Replicas are
+ * therefore one process each, started and supervised by a single host invocation.
+ */
+
+#pragma once
+
+/*
+ * Starts count copies of this executable with argv minus the --instances option, each with
+ * --replica <index> added to its host options, and waits for all of them. Returns
+ * EXIT_SUCCESS only if every replica exited successfully.
+ */
+int run_replicas(int argc, char *argv[], int count);
+
+/*
+ * Prints which engine singletons prevent running multiple instances in one process.
+ */
+void print_replica_limitations();
@@ -0,0 +1,147 @@
+#include "resource_prefetch.h"
+
+#include <iostream>
+
+#include "json_writer.h"
+
+namespace
+{
+const char *status_name(int status)
+{
+    static const char *names[] = {"invalid", "in_progress", "failed", "loaded"};
+    return status >= 0 && status <= 3 ? names[status] : "unknown";
+}
+} // namespace
+
+ResourcePrefetch::ResourcePrefetch(std::vector<std::string> paths)
+{
+    requests.resize(paths.size());
+    for (size_t i = 0; i < paths.size(); ++i) {
+        requests[i].path = std::move(paths[i]);
+    }
+}
+
+void ResourcePrefetch::start()
+{
+    loader         = godot_singleton("ResourceLoader");
+    progress_array = GodotVariant::new_array();
+    started        = Clock::now();
+    pending        = 0;
+    if (loader.is_nil()) {
+        return;
+    }
+
+    for (auto &request : requests) {
+        // Sub-threads spread the dependencies of a single resource over the worker pool
+        auto path      = GodotVariant::from_string(request.path.c_str());
+        auto type_hint = GodotVariant::from_string("");
+        auto error     = loader.call("load_threaded_request",
+                                     {path, type_hint, GodotVariant::from_bool(true)});
+        request.resource = {};
+        request.progress = 0.0;
+        request.status   = error.to_int() == 0 ? InProgress : Failed;
+        if (request.status == Failed) {
+            std::cerr << "failed to request prefetch of " << request.path << std::endl;
+            continue;
+        }
+        ++pending;
+    }
+}
+
+bool ResourcePrefetch::poll()
+{
+    if (pending == 0) {
+        return true;
+    }
+
+    for (auto &request : requests) {
+        if (request.status != InProgress) {
+            continue;
+        }
+
+        auto path   = GodotVariant::from_string(request.path.c_str());
+        auto status = loader.call("load_threaded_get_status", {path, progress_array});
+        request.status = static_cast<Status>(status.to_int());
+        if (request.status == InProgress) {
+            request.progress = progress_array.call("front").to_float();
+            continue;
+        }
+
+        // Collecting the result ends the threaded request; holding it keeps it in the cache
+        if (request.status == Loaded) {
+            request.resource = loader.call("load_threaded_get", {path});
+            request.progress = 1.0;
+        } else {
+            std::cerr << "failed to prefetch " << request.path << std::endl;
+        }
+        request.load_ms =
+            std::chrono::duration<double, std::milli>(Clock::now() - started).count();
+        --pending;
+        if (callback) {
+            callback(request.path, progress());
+        }
+    }
+    return pending == 0;
+}
+
+double ResourcePrefetch::progress() const
+{
+    if (requests.empty()) {
+        return 1.0;
+    }
+
+    double total = 0.0;
+    for (auto &request : requests) {
+        total += request.status == InProgress ? request.progress : 1.0;
+    }
+    return total / static_cast<double>(requests.size());
+}
+
+void ResourcePrefetch::release()
+{
+    // Join loads still running, the project they belong to is about to go away
+    for (auto &request : requests) {
+        if (request.status == InProgress) {
+            loader.call("load_threaded_get", {GodotVariant::from_string(request.path.c_str())});
+            request.status = Invalid;
+            --pending;
+        }
+        request.resource = {};
+    }
+    progress_array = {};
+    loader         = {};
+}
+
+size_t ResourcePrefetch::release_loaded()
+{
+    size_t released = 0;
+    for (auto &request : requests) {
+        if (request.status == Loaded && !request.resource.is_nil()) {
+            request.resource = {};
+            ++released;
+        }
+    }
+    return released;
+}
+
+void ResourcePrefetch::write_json(JsonWriter &json) const
+{
+    size_t loaded = 0;
+    for (auto &request : requests) {
+        loaded += request.status == Loaded ? 1 : 0;
+    }
+    json.field("requested", requests.size());
+    json.field("loaded", loaded);
+    json.field("pending", pending);
+    json.field("progress", progress());
+
+    json.begin_array("resources");
+    for (auto &request : requests) {
+        json.begin_object();
+        json.field("path", request.path);
+        json.field("status", status_name(request.status));
+        json.field("load_ms", request.load_ms);
+        json.end_object();
+    }
+    json.end_array();
+}
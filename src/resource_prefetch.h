@@ -0,0 +1,100 @@
+/*
+ * Threaded loading of resources a project needs soon after it starts.
+ */
+
+#pragma once
+
+#include <chrono>
+#include <functional>
+#include <string>
+#include <vector>
+
+#include "godot_api.h"
+
+class JsonWriter;
+
+/*
+ * Requests resources through ResourceLoader.load_threaded_request() right after the project is
+ * loaded, so their dependency graphs load on the engine's worker threads while the host keeps
+ * iterating. Loaded resources are held until the project is unloaded; the engine's resource
+ * cache then hands them out when the project load()s them itself.
+ *
+ * libgodot_load_project() still loads the main scene synchronously: the engine offers no way to
+ * defer it. Prefetch is for what the project loads afterwards (levels, large scenes, pools).
+ */
+class ResourcePrefetch
+{
+  public:
+    using Clock = std::chrono::steady_clock;
+
+    /*
+     * Receives the path of a request that finished and the overall progress in [0, 1].
+     */
+    using ProgressCallback = std::function<void(const std::string &path, double progress)>;
+
+    explicit ResourcePrefetch(std::vector<std::string> paths);
+
+    void set_callback(ProgressCallback p_callback)
+    {
+        callback = std::move(p_callback);
+    }
+
+    /*
+     * Issues all requests. Call once the project is loaded.
+     */
+    void start();
+
+    /*
+     * Collects finished requests. Called by the host after each iteration; returns true once
+     * every request has finished.
+     */
+    bool poll();
+
+    /*
+     * Returns the progress over all requests in [0, 1], from the engine's per-request progress.
+     */
+    double progress() const;
+
+    bool is_done() const
+    {
+        return pending == 0;
+    }
+
+    /*
+     * Waits for requests still running and drops the held resources. Call before the project
+     * is unloaded.
+     */
+    void release();
+
+    /*
+     * Drops the held resources that finished loading, so the resource cache can free those the
+     * project does not use itself. Returns how many were dropped.
+     */
+    size_t release_loaded();
+
+    void write_json(JsonWriter &json) const;
+
+  private:
+    // Mirrors ResourceLoader.ThreadLoadStatus
+    enum Status {
+        Invalid    = 0,
+        InProgress = 1,
+        Failed     = 2,
+        Loaded     = 3,
+    };
+
+    struct Request {
+        std::string  path;
+        GodotVariant resource;
+        Status       status   = Invalid;
+        double       progress = 0.0;
+        double       load_ms  = 0.0;
+    };
+
+    std::vector<Request> requests;
+    ProgressCallback     callback;
+    GodotVariant         loader;
+    GodotVariant         progress_array; // Filled by load_threaded_get_status()
+    Clock::time_point    started;
+    size_t               pending = 0;
+};
@@ -0,0 +1,227 @@
+#include "rotator_batch.h"
+
+#include <array>
+#include <cmath>
+#include <memory>
+#include <vector>
+
+#include "frame_arena.h"
+#include "godot_api.h"
+#include "job_system.h"
+
+namespace
+{
+// MultiMesh::TransformFormat::TRANSFORM_3D
+constexpr int64_t transform_3d = 1;
+
+constexpr double two_pi = 6.283185307179586;
+
+// Instances per job, large enough that a chunk outweighs handing it to a worker
+constexpr size_t instances_per_job = 16384;
+
+struct BatchClass {
+    GodotStringName name{"RotatorBatch"};
+    GodotStringName parent{"MultiMeshInstance3D"};
+    GodotStringName process{"_process"};
+};
+
+std::unique_ptr<BatchClass> batch_class;
+
+/*
+ * Rows 1 and 2 of each instance basis, one array per component. Rotating around X leaves row 0
+ * and the origin alone.
+ */
+struct BasisRows {
+    std::array<std::vector<float>, 3> y;
+    std::array<std::vector<float>, 3> z;
+
+    void resize(size_t count)
+    {
+        for (int k = 0; k < 3; ++k) {
+            y[k].resize(count);
+            z[k].resize(count);
+        }
+    }
+};
+
+/*
+ * Computes Rx(angle) * basis for one component of rows 1 and 2. Plain unit-stride loops over
+ * non-aliasing arrays, which the compiler vectorizes.
+ */
+void rotate_x_kernel(const float *__restrict p_y, const float *__restrict p_z,
+                     float *__restrict r_y, float *__restrict r_z, size_t count, float c,
+                     float s)
+{
+    for (size_t i = 0; i < count; ++i) {
+        r_y[i] = c * p_y[i] - s * p_z[i];
+        r_z[i] = s * p_y[i] + c * p_z[i];
+    }
+}
+
+struct Batch {
+    GDExtensionObjectPtr owner = nullptr;
+
+    GodotVariant            rendering_server;
+    GodotVariant            multimesh_rid;
+    GodotPackedFloat32Array buffers[2]; // Instance data as the renderer takes it, see update()
+    int                     current = 0;
+    size_t                  stride  = 12;
+    size_t                  count   = 0;
+
+    BasisRows initial; // Bases when the batch started, angle 0
+    double    angle = 0.0; // Accumulated without drift, the bases are recomputed from 'initial'
+
+    bool setup();
+    void update(double delta);
+};
+
+bool Batch::setup()
+{
+    auto multimesh = GodotVariant::from_object(owner).call("get_multimesh");
+    if (multimesh.is_nil() || multimesh.call("get_transform_format").to_int() != transform_3d) {
+        return false;
+    }
+
+    // count stays 0 until every check passed, update() only writes through a complete setup
+    rendering_server = godot_singleton("RenderingServer");
+    multimesh_rid    = multimesh.call("get_rid");
+    auto instances   = static_cast<size_t>(multimesh.call("get_instance_count").to_int());
+    stride           = 12;
+    stride += multimesh.call("is_using_colors").to_bool() ? 4 : 0;
+    stride += multimesh.call("is_using_custom_data").to_bool() ? 4 : 0;
+    if (instances == 0) {
+        return false;
+    }
+
+    // The headless dummy renderer keeps no instance data, start those batches from identity
+    auto data_variant = rendering_server.call("multimesh_get_buffer", {multimesh_rid});
+    auto data_size    = static_cast<int64_t>(instances * stride);
+    bool identity     = data_variant.call("size").to_int() < data_size;
+    if (identity) {
+        data_variant.call("resize", {GodotVariant::from_int(data_size)});
+        data_variant.call("fill", {GodotVariant::from_float(0.0)});
+    }
+    buffers[0] = GodotPackedFloat32Array(data_variant);
+    buffers[1] = GodotPackedFloat32Array(data_variant);
+    if (buffers[0].size() < instances * stride || buffers[1].size() < instances * stride) {
+        return false;
+    }
+    count = instances;
+
+    // Rows are stored as basis row, origin component: x x x o, y y y o, z z z o
+    initial.resize(count);
+    for (auto &buffer : buffers) {
+        float *data = buffer.data();
+        for (size_t i = 0; identity && i < count; ++i) {
+            float *instance = data + i * stride;
+            instance[0] = instance[5] = instance[10] = 1.0f;
+        }
+    }
+
+    const float *data = buffers[0].data();
+    for (size_t i = 0; i < count; ++i) {
+        const float *instance = data + i * stride;
+        for (int k = 0; k < 3; ++k) {
+            initial.y[k][i] = instance[4 + k];
+            initial.z[k][i] = instance[8 + k];
+        }
+    }
+    angle = 0.0;
+    return true;
+}
+
+void Batch::update(double delta)
+{
+    if (count == 0 && !setup()) {
+        return;
+    }
+
+    angle  = std::fmod(angle + delta, two_pi);
+    auto c = static_cast<float>(std::cos(angle));
+    auto s = static_cast<float>(std::sin(angle));
+
+    // The renderer may keep the last buffer as its data cache. Alternating between two leaves
+    // the one written here unshared, so writing it never triggers a copy on write.
+    auto &buffer = buffers[current];
+    current      = 1 - current;
+    float *data  = buffer.data();
+
+    // Rotate, then interleave into the renderer's layout, chunk by chunk across the workers
+    auto update_range = [&](size_t begin, size_t end) {
+        // Scratch rows for this chunk, from the frame arena of the thread running it
+        auto   n       = end - begin;
+        float *rotated = FrameArena::local().allocate_array<float>(6 * n);
+        for (size_t k = 0; k < 3; ++k) {
+            rotate_x_kernel(initial.y[k].data() + begin, initial.z[k].data() + begin,
+                            rotated + k * n, rotated + (3 + k) * n, n, c, s);
+        }
+        for (size_t i = 0; i < n; ++i) {
+            float *instance = data + (begin + i) * stride;
+            for (size_t k = 0; k < 3; ++k) {
+                instance[4 + k] = rotated[k * n + i];
+                instance[8 + k] = rotated[(3 + k) * n + i];
+            }
+        }
+    };
+    if (auto jobs = JobSystem::current()) {
+        jobs->parallel_for(count, instances_per_job, update_range);
+    } else {
+        update_range(0, count);
+    }
+
+    // Hand over the whole buffer at once
+    rendering_server.call("multimesh_set_buffer", {multimesh_rid, buffer.variant()});
+}
+
+GDExtensionObjectPtr create_instance(void *p_class_userdata, GDExtensionBool p_notify)
+{
+    auto &api    = GodotApi::get();
+    auto  object = api.classdb_construct_object2(batch_class->parent.ptr());
+    auto  self   = new Batch();
+    self->owner  = object;
+    api.object_set_instance(object, batch_class->name.ptr(), self);
+    return object;
+}
+
+void free_instance(void *p_class_userdata, GDExtensionClassInstancePtr p_instance)
+{
+    delete static_cast<Batch *>(p_instance);
+}
+
+void process(GDExtensionClassInstancePtr p_instance, const GDExtensionConstTypePtr *p_args,
+             GDExtensionTypePtr r_ret)
+{
+    static_cast<Batch *>(p_instance)->update(*static_cast<const double *>(p_args[0]));
+}
+
+GDExtensionClassCallVirtual get_virtual(void                         *p_class_userdata,
+                                        GDExtensionConstStringNamePtr p_name, uint32_t p_hash)
+{
+    return batch_class->process == p_name ? process : nullptr;
+}
+} // namespace
+
+void register_rotator_batch()
+{
+    auto &api   = GodotApi::get();
+    batch_class = std::make_unique<BatchClass>();
+
+    GDExtensionClassCreationInfo4 info = {};
+    info.is_exposed                    = true;
+    info.create_instance_func          = create_instance;
+    info.free_instance_func            = free_instance;
+    info.get_virtual_func              = get_virtual;
+    api.classdb_register_extension_class4(api.library, batch_class->name.ptr(),
+                                          batch_class->parent.ptr(), &info);
+}
+
+void unregister_rotator_batch()
+{
+    if (!batch_class) {
+        return;
+    }
+
+    auto &api = GodotApi::get();
+    api.classdb_unregister_extension_class(api.library, batch_class->name.ptr());
+    batch_class.reset();
+}
@@ -0,0 +1,20 @@
+/*
+ * RotatorBatch: data-oriented rotation of many MultiMesh instances, registered by the host's
+ * extension.
+ */
+
+#pragma once
+
+/*
+ * Registers RotatorBatch, a MultiMeshInstance3D that rotates every instance of its MultiMesh
+ * around X by delta each frame, like sample/cube.gd does per node. On the first frame it copies
+ * the instance bases into contiguous arrays; afterwards one loop over those arrays computes all
+ * bases and the whole transform buffer goes to the RenderingServer in one call. Instance
+ * origins are not touched. Call at the SCENE initialization level.
+ */
+void register_rotator_batch();
+
+/*
+ * Unregisters the class again, before the interface is unloaded.
+ */
+void unregister_rotator_batch();
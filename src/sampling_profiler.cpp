@@ -0,0 +1,573 @@
+#include "sampling_profiler.h"
+
+#include <algorithm>
+#include <atomic>
+#include <cerrno>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <fstream>
+#include <iostream>
+#include <memory>
+#include <mutex>
+#include <unordered_map>
+#include <vector>
+
+#if defined(_WIN32)
+#define NOMINMAX
+#include <windows.h>
+#else
+#include <csignal>
+#include <cxxabi.h>
+#include <dlfcn.h>
+#include <execinfo.h>
+#include <pthread.h>
+#include <sys/time.h>
+#include <unistd.h>
+#if defined(__linux__)
+#include <sys/syscall.h>
+#endif
+#endif
+
+#include <libgodot.h>
+
+#include "json_writer.h"
+
+namespace
+{
+constexpr int    max_depth      = 64;
+constexpr int    skipped_frames = 2; // The signal handler and the kernel's signal trampoline
+constexpr size_t ring_size      = 8192;
+
+// Innermost ProfileScope of each thread, read by the signal handler
+thread_local const char *current_scope = nullptr;
+
+SamplingProfiler *current_profiler = nullptr;
+
+// steady_clock reads the vDSO clock on Linux, which is safe inside the signal handler
+uint64_t now_ns()
+{
+    return static_cast<uint64_t>(std::chrono::duration_cast<std::chrono::nanoseconds>(
+                                     std::chrono::steady_clock::now().time_since_epoch())
+                                     .count());
+}
+
+uint64_t thread_id()
+{
+#if defined(_WIN32)
+    return GetCurrentThreadId();
+#elif defined(__linux__)
+    return static_cast<uint64_t>(syscall(SYS_gettid));
+#elif defined(__APPLE__)
+    uint64_t id = 0;
+    pthread_threadid_np(nullptr, &id);
+    return id;
+#else
+    return 0;
+#endif
+}
+
+/*
+ * A sample as written by the signal handler. ready hands the slot over to drain().
+ */
+struct RawSample {
+    std::atomic<bool> ready{false};
+    int               depth   = 0;
+    uint64_t          time_ns = 0;
+    uint64_t          thread  = 0;
+    const char       *scope   = nullptr;
+    void             *frames[max_depth];
+};
+
+const char *category_names[] = {"host", "engine", "script", "system"};
+
+enum Category {
+    Host,
+    Engine,
+    Script,
+    System,
+    CategoryCount,
+};
+} // namespace
+
+struct ProfilerState {
+    std::unique_ptr<RawSample[]> ring = std::make_unique<RawSample[]>(ring_size);
+    std::atomic<uint64_t>        write{0};
+    std::atomic<uint64_t>        read{0};
+    std::atomic<uint64_t>        dropped{0};
+
+    // Distinct stacks, outermost frame first, and how often each was sampled
+    struct Stack {
+        std::vector<void *> frames;
+        const char         *scope  = nullptr;
+        uint64_t            thread = 0;
+        uint64_t            count  = 0;
+    };
+
+    struct TimedSample {
+        uint64_t time_ns;
+        uint64_t thread;
+        uint32_t stack;
+    };
+
+    struct Scope {
+        const char *name;
+        uint64_t    thread;
+        uint64_t    begin_ns;
+        uint64_t    end_ns;
+    };
+
+    std::mutex                                mutex; // Guards everything below
+    std::vector<Stack>                        stacks;
+    std::unordered_map<std::string, uint32_t> stack_index; // Raw stack bytes to index in stacks
+    std::vector<TimedSample>                  timeline;    // Chrome format only
+    std::vector<Scope>                        scopes;      // Chrome format only
+    uint64_t                                  samples     = 0;
+    uint64_t                                  main_thread = 0;
+    uint64_t                                  started_ns  = 0;
+
+    uint64_t categories[CategoryCount] = {}; // Samples per category, once the profile is written
+};
+
+namespace
+{
+std::atomic<ProfilerState *> signal_state{nullptr};
+} // namespace
+
+#if !defined(_WIN32)
+namespace
+{
+void on_sample(int, siginfo_t *, void *)
+{
+    int   saved_errno = errno;
+    auto *state       = signal_state.load(std::memory_order_acquire);
+    if (state == nullptr) {
+        errno = saved_errno;
+        return;
+    }
+
+    // Claim a slot without blocking; a full ring drops the sample
+    uint64_t index = state->write.load(std::memory_order_relaxed);
+    do {
+        if (index - state->read.load(std::memory_order_acquire) >= ring_size) {
+            state->dropped.fetch_add(1, std::memory_order_relaxed);
+            errno = saved_errno;
+            return;
+        }
+    } while (!state->write.compare_exchange_weak(index, index + 1, std::memory_order_acq_rel));
+
+    auto &sample   = state->ring[index % ring_size];
+    sample.depth   = backtrace(sample.frames, max_depth);
+    sample.time_ns = now_ns();
+    sample.thread  = thread_id();
+    sample.scope   = current_scope;
+    sample.ready.store(true, std::memory_order_release);
+    errno = saved_errno;
+}
+
+/*
+ * Outermost names of the host's own code. A static build links the engine into the executable,
+ * where the module no longer tells host and engine frames apart, so they are told apart by name:
+ * these, the standard library the host instantiates, and main are host code, everything else in
+ * the executable is the engine's.
+ */
+const char *host_scopes[] = {
+    "BatchStepper", "BenchRun", "ControlChannel", "ControlSocket", "EventLoop", "FrameArena",
+    "FrameBudget", "FrameCapture", "FrameEncoder", "FrameScheduler", "FrameStats", "GodotApi",
+    "GodotPackedByteArray", "GodotPackedFloat32Array", "GodotStringName", "GodotVariant", "Host",
+    "HostOptions", "InputRecorder", "InputReplay", "JobSystem", "JsonWriter", "LatencyHistogram",
+    "MemoryBudget", "MemoryReport", "PackMapping", "ProcessUsage", "ProfileScope", "ProfilerState",
+    "ReloadTrigger", "ResourcePrefetch", "SamplingProfiler", "ShaderWarmup", "SharedCache",
+    "ShmClient", "ShmTransport", "StartupProfile", "StatsReporter", "ThreadPlacement",
+    "bytes_per_pixel", "export_shader_cache", "godot_singleton", "import_shader_cache",
+    "init_extension", "main", "pixel_format_name", "print_replica_limitations",
+    "register_native_rotator", "register_rotator_batch", "run_replicas",
+    "unregister_native_rotator", "unregister_rotator_batch", "std", "__gnu_cxx",
+};
+
+bool is_host_symbol(const std::string &name)
+{
+    auto scope = name.substr(0, name.find_first_of(":(<"));
+    for (auto *host_scope : host_scopes) {
+        if (scope == host_scope) {
+            return true;
+        }
+    }
+    return false;
+}
+
+std::string demangle(const char *symbol)
+{
+    int   status    = 0;
+    char *demangled = abi::__cxa_demangle(symbol, nullptr, nullptr, &status);
+    auto  name      = std::string(status == 0 && demangled != nullptr ? demangled : symbol);
+    std::free(demangled);
+    return name;
+}
+
+/*
+ * Resolves code addresses to names and categories, caching each address.
+ */
+class Symbolizer
+{
+  public:
+    Symbolizer()
+    {
+        Dl_info info;
+        if (dladdr(reinterpret_cast<void *>(&now_ns), &info) != 0 && info.dli_fname != nullptr) {
+            executable = info.dli_fname;
+        }
+        if (dladdr(reinterpret_cast<void *>(&libgodot_iteration_godot_instance), &info) != 0
+            && info.dli_fname != nullptr) {
+            static_engine = executable == info.dli_fname;
+        }
+    }
+
+    struct Symbol {
+        std::string name;
+        Category    category;
+    };
+
+    // Return addresses point past the call, look up the call itself
+    const Symbol &resolve(void *address, bool is_leaf)
+    {
+        auto lookup = is_leaf ? address : static_cast<void *>(static_cast<char *>(address) - 1);
+        auto found  = cache.find(lookup);
+        if (found != cache.end()) {
+            return found->second;
+        }
+
+        Symbol  symbol{"", System};
+        Dl_info info;
+        if (dladdr(lookup, &info) != 0) {
+            std::string module = info.dli_fname != nullptr ? info.dli_fname : "";
+            if (info.dli_sname != nullptr) {
+                symbol.name = demangle(info.dli_sname);
+            } else {
+                auto offset = static_cast<char *>(lookup) - static_cast<char *>(info.dli_fbase);
+                char buffer[32];
+                std::snprintf(buffer, sizeof(buffer), "+0x%llx", static_cast<long long>(offset));
+                symbol.name = module.substr(module.find_last_of('/') + 1) + buffer;
+            }
+
+            if (module == executable) {
+                // Unnamed code of a static build is the engine's, the host's is exported
+                symbol.category = !static_engine || (info.dli_sname != nullptr
+                                                     && is_host_symbol(symbol.name))
+                                      ? Host
+                                      : Engine;
+            } else if (module.find("godot") != std::string::npos) {
+                symbol.category = Engine;
+            }
+        } else {
+            char buffer[32];
+            std::snprintf(buffer, sizeof(buffer), "0x%llx",
+                          static_cast<long long>(reinterpret_cast<uintptr_t>(lookup)));
+            symbol.name = buffer;
+        }
+        return cache.emplace(lookup, std::move(symbol)).first->second;
+    }
+
+  private:
+    std::string                        executable;
+    bool                               static_engine = false; // libgodot is in the executable
+    std::unordered_map<void *, Symbol> cache;
+};
+} // namespace
+#endif
+
+SamplingProfiler *SamplingProfiler::current()
+{
+    return current_profiler;
+}
+
+SamplingProfiler::SamplingProfiler(std::string p_path, ProfileFormat p_format, int p_rate_hz)
+    : path(std::move(p_path))
+    , format(p_format)
+    , rate_hz(p_rate_hz)
+    , state(new ProfilerState())
+{
+}
+
+SamplingProfiler::~SamplingProfiler()
+{
+    if (running) {
+        stop();
+    }
+    delete state;
+}
+
+bool SamplingProfiler::start()
+{
+#if defined(_WIN32)
+    std::cerr << "the sampling profiler needs SIGPROF and is not available on Windows" << std::endl;
+    return false;
+#else
+    // The first backtrace() loads the unwinder, which must not happen inside the handler
+    void *warmup[4];
+    backtrace(warmup, 4);
+
+    state->main_thread = thread_id();
+    state->started_ns  = now_ns();
+    signal_state.store(state, std::memory_order_release);
+
+    struct sigaction action{};
+    action.sa_sigaction = on_sample;
+    action.sa_flags     = SA_SIGINFO | SA_RESTART;
+    sigemptyset(&action.sa_mask);
+    if (sigaction(SIGPROF, &action, nullptr) != 0) {
+        std::cerr << "failed to install the profiler's signal handler" << std::endl;
+        return false;
+    }
+
+    // ITIMER_PROF counts CPU time of the whole process, so busy threads are sampled more often
+    // setitimer() rejects a tv_usec of a second or more, as 1 Hz would need
+    auto      interval_us     = std::max(1, 1000000 / rate_hz);
+    itimerval timer{};
+    timer.it_interval.tv_sec  = static_cast<time_t>(interval_us / 1000000);
+    timer.it_interval.tv_usec = static_cast<suseconds_t>(interval_us % 1000000);
+    timer.it_value            = timer.it_interval;
+    if (setitimer(ITIMER_PROF, &timer, nullptr) != 0) {
+        std::cerr << "failed to start the profiler's timer" << std::endl;
+        return false;
+    }
+
+    current_profiler = this;
+    running          = true;
+    return true;
+#endif
+}
+
+bool SamplingProfiler::stop()
+{
+#if defined(_WIN32)
+    return false;
+#else
+    if (!running) {
+        return false;
+    }
+    running          = false;
+    current_profiler = nullptr;
+
+    // Ignore rather than restore the default, which would terminate on a late SIGPROF
+    itimerval timer{};
+    setitimer(ITIMER_PROF, &timer, nullptr);
+    signal(SIGPROF, SIG_IGN);
+    drain();
+    signal_state.store(nullptr, std::memory_order_release);
+
+    std::lock_guard<std::mutex> lock(state->mutex);
+    std::ofstream               out(path);
+    if (!out) {
+        std::cerr << "failed to write the profile to " << path << std::endl;
+        return false;
+    }
+
+    Symbolizer symbols;
+    auto       thread_name = [this](uint64_t thread) {
+        return thread == state->main_thread ? std::string("main")
+                                            : "thread-" + std::to_string(thread);
+    };
+
+    // Attribute each sample once: to script if the VM is on the stack, else to its leaf
+    for (auto &stack : state->stacks) {
+        auto category = stack.frames.empty() ? System
+                                             : symbols.resolve(stack.frames.back(), true).category;
+        for (size_t i = 0; i < stack.frames.size(); ++i) {
+            auto &symbol = symbols.resolve(stack.frames[i], i + 1 == stack.frames.size());
+            if (symbol.name.find("GDScript") != std::string::npos) {
+                category = Script;
+                break;
+            }
+        }
+        state->categories[category] += stack.count;
+    }
+
+    // Stacks differing only in addresses within the same functions fold into one line
+    if (format == ProfileFormat::Folded) {
+        std::unordered_map<std::string, uint64_t> folded;
+        std::vector<std::string>                  order;
+        for (auto &stack : state->stacks) {
+            auto line = thread_name(stack.thread);
+            if (stack.scope != nullptr) {
+                line += std::string(";") + stack.scope;
+            }
+            for (size_t i = 0; i < stack.frames.size(); ++i) {
+                line += ";" + symbols.resolve(stack.frames[i], i + 1 == stack.frames.size()).name;
+            }
+            auto [entry, added] = folded.emplace(line, 0);
+            if (added) {
+                order.push_back(line);
+            }
+            entry->second += stack.count;
+        }
+        for (auto &line : order) {
+            out << line << ' ' << folded[line] << '\n';
+        }
+        return static_cast<bool>(out);
+    }
+
+    // Chrome trace: a tree of stack frames shared by all samples, plus the scopes as spans
+    struct Frame {
+        std::string name;
+        uint32_t    parent; // 0 for root frames
+        Category    category;
+    };
+
+    std::vector<Frame>                        frames;
+    std::unordered_map<std::string, uint32_t> frame_ids;
+    auto frame_id = [&](uint32_t parent, const std::string &name, Category category) {
+        auto key  = std::to_string(parent) + ";" + name;
+        auto node = frame_ids.find(key);
+        if (node != frame_ids.end()) {
+            return node->second;
+        }
+        auto id = static_cast<uint32_t>(frames.size() + 1);
+        frames.push_back({name, parent, category});
+        frame_ids.emplace(key, id);
+        return id;
+    };
+
+    std::vector<uint32_t> leaf_frames;
+    for (auto &stack : state->stacks) {
+        uint32_t node = stack.scope != nullptr ? frame_id(0, stack.scope, Host) : 0;
+        for (size_t i = 0; i < stack.frames.size(); ++i) {
+            auto &symbol = symbols.resolve(stack.frames[i], i + 1 == stack.frames.size());
+            node         = frame_id(node, symbol.name, symbol.category);
+        }
+        leaf_frames.push_back(node);
+    }
+
+    JsonWriter json(out);
+    auto       micros = [this](uint64_t ns) {
+        return static_cast<double>(ns - state->started_ns) / 1000.0;
+    };
+    json.begin_object();
+    json.begin_array("traceEvents");
+    for (auto &scope : state->scopes) {
+        json.begin_object();
+        json.field("name", scope.name);
+        json.field("ph", "X");
+        json.field("ts", micros(scope.begin_ns));
+        json.field("dur", static_cast<double>(scope.end_ns - scope.begin_ns) / 1000.0);
+        json.field("pid", 1);
+        json.field("tid", scope.thread);
+        json.end_object();
+    }
+    json.end_array();
+
+    json.begin_object("stackFrames");
+    for (size_t i = 0; i < frames.size(); ++i) {
+        json.begin_object(std::to_string(i + 1).c_str());
+        json.field("name", frames[i].name);
+        json.field("category", category_names[frames[i].category]);
+        if (frames[i].parent != 0) {
+            json.field("parent", std::to_string(frames[i].parent));
+        }
+        json.end_object();
+    }
+    json.end_object();
+
+    json.begin_array("samples");
+    for (auto &sample : state->timeline) {
+        json.begin_object();
+        json.field("cpu", 0);
+        json.field("tid", sample.thread);
+        json.field("ts", micros(sample.time_ns));
+        json.field("name", "cpu-clock");
+        json.field("sf", std::to_string(leaf_frames[sample.stack]));
+        json.field("weight", 1);
+        json.end_object();
+    }
+    json.end_array();
+    json.end_object();
+    out << '\n';
+    return static_cast<bool>(out);
+#endif
+}
+
+void SamplingProfiler::drain()
+{
+    std::lock_guard<std::mutex> lock(state->mutex);
+
+    uint64_t read  = state->read.load(std::memory_order_relaxed);
+    uint64_t write = state->write.load(std::memory_order_acquire);
+    for (; read < write; ++read) {
+        auto &sample = state->ring[read % ring_size];
+        if (!sample.ready.load(std::memory_order_acquire)) {
+            break; // Still being written by a handler on another thread
+        }
+
+        // Stacks are keyed by their raw bytes; frames are stored outermost first
+        int         depth = sample.depth > skipped_frames ? sample.depth - skipped_frames : 0;
+        std::string key(reinterpret_cast<const char *>(&sample.thread), sizeof(sample.thread));
+        key.append(reinterpret_cast<const char *>(&sample.scope), sizeof(sample.scope));
+        key.append(reinterpret_cast<const char *>(sample.frames + skipped_frames),
+                   static_cast<size_t>(depth) * sizeof(void *));
+
+        auto [entry, added] = state->stack_index.emplace(key, state->stacks.size());
+        if (added) {
+            ProfilerState::Stack stack;
+            stack.frames.assign(std::make_reverse_iterator(sample.frames + skipped_frames + depth),
+                                std::make_reverse_iterator(sample.frames + skipped_frames));
+            stack.scope  = sample.scope;
+            stack.thread = sample.thread;
+            state->stacks.push_back(std::move(stack));
+        }
+        ++state->stacks[entry->second].count;
+        ++state->samples;
+        if (format == ProfileFormat::Chrome) {
+            state->timeline.push_back({sample.time_ns, sample.thread, entry->second});
+        }
+
+        sample.ready.store(false, std::memory_order_relaxed);
+        state->read.store(read + 1, std::memory_order_release);
+    }
+}
+
+void SamplingProfiler::record_scope(const char *name, uint64_t begin_ns, uint64_t end_ns)
+{
+    if (format != ProfileFormat::Chrome) {
+        return;
+    }
+    std::lock_guard<std::mutex> lock(state->mutex);
+    state->scopes.push_back({name, thread_id(), begin_ns, end_ns});
+}
+
+void SamplingProfiler::write_json(JsonWriter &json) const
+{
+    std::lock_guard<std::mutex> lock(state->mutex);
+    json.field("path", path);
+    json.field("format", format == ProfileFormat::Folded ? "folded" : "chrome");
+    json.field("rate_hz", rate_hz);
+    json.field("samples", state->samples);
+    json.field("dropped", state->dropped.load(std::memory_order_relaxed));
+    json.field("stacks", state->stacks.size());
+
+    // Filled in when the profile is written
+    if (!running) {
+        json.begin_object("categories");
+        for (int category = 0; category < CategoryCount; ++category) {
+            json.field(category_names[category], state->categories[category]);
+        }
+        json.end_object();
+    }
+}
+
+ProfileScope::ProfileScope(const char *p_name)
+    : name(p_name)
+    , outer(current_scope)
+{
+    current_scope = name;
+    if (current_profiler != nullptr) {
+        begin_ns = now_ns();
+    }
+}
+
+ProfileScope::~ProfileScope()
+{
+    current_scope = outer;
+    if (begin_ns != 0 && current_profiler != nullptr) {
+        current_profiler->record_scope(name, begin_ns, now_ns());
+    }
+}
@@ -0,0 +1,90 @@
+/*
+ * In-process sampling profiler covering host, engine and script code alike.
+ */
+
+#pragma once
+
+#include <cstdint>
+#include <string>
+
+class JsonWriter;
+struct ProfilerState;
+
+enum class ProfileFormat {
+    Folded, // One "root;...;leaf count" line per distinct stack, for flamegraph.pl
+    Chrome, // Trace Event JSON with stack samples and scope spans, for Perfetto
+};
+
+/*
+ * Samples the call stacks of every thread that uses CPU time: a SIGPROF timer interrupts the
+ * process at a fixed rate of CPU time and the handler unwinds the interrupted stack with the
+ * unwind tables, which also walks through libgodot and the GDScript VM. The handler only writes
+ * raw addresses into a preallocated ring; the host drains it after each iteration and resolves
+ * symbols once, when the profile is written.
+ *
+ * Samples are tagged with the innermost ProfileScope active on the sampled thread. GDScript runs
+ * inside the engine's GDScriptFunction::call(), so script time shows up below those frames rather
+ * than under script function names.
+ *
+ * POSIX only; start() fails on Windows.
+ */
+class SamplingProfiler
+{
+  public:
+    /*
+     * Returns the running profiler, null when profiling is off.
+     */
+    static SamplingProfiler *current();
+
+    SamplingProfiler(std::string p_path, ProfileFormat p_format, int p_rate_hz);
+    ~SamplingProfiler();
+
+    SamplingProfiler(const SamplingProfiler &)            = delete;
+    SamplingProfiler &operator=(const SamplingProfiler &) = delete;
+
+    bool start();
+
+    /*
+     * Stops sampling and writes the profile. Returns false if it could not be written.
+     */
+    bool stop();
+
+    /*
+     * Moves samples out of the signal handler's ring. Called by the host after each iteration.
+     */
+    void drain();
+
+    /*
+     * Records a completed scope on the calling thread for the Chrome trace.
+     */
+    void record_scope(const char *name, uint64_t begin_ns, uint64_t end_ns);
+
+    void write_json(JsonWriter &json) const;
+
+  private:
+    std::string    path;
+    ProfileFormat  format;
+    int            rate_hz;
+    ProfilerState *state   = nullptr;
+    bool           running = false;
+};
+
+/*
+ * Marks a span of work on the current thread. Samples taken inside get the scope's name as their
+ * root frame, and the Chrome trace shows the span itself. Costs a thread-local store when
+ * profiling is off. Names must be string literals.
+ */
+class ProfileScope
+{
+  public:
+    explicit ProfileScope(const char *name);
+    ~ProfileScope();
+
+    ProfileScope(const ProfileScope &)            = delete;
+    ProfileScope &operator=(const ProfileScope &) = delete;
+
+  private:
+    const char *name;
+    const char *outer;
+    uint64_t    begin_ns = 0;
+};
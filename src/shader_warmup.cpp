@@ -0,0 +1,202 @@
+#include "shader_warmup.h"
+
+#include <cstdlib>
+#include <filesystem>
+#include <fstream>
+#include <iostream>
+#include <vector>
+
+#include "json_writer.h"
+
+namespace fs = std::filesystem;
+
+namespace
+{
+// Cache directories the engine keeps under user://, per rendering driver
+const char *const cache_directories[] = {"shader_cache", "vulkan", "d3d12", "metal"};
+
+constexpr const char *manifest_name = "manifest.txt";
+
+// SubViewport.UPDATE_ALWAYS
+constexpr int64_t update_always = 4;
+
+std::string object_key(const GodotVariant &object)
+{
+    return object.is_nil() ? "0" : std::to_string(object.call("get_instance_id").to_int());
+}
+
+// The manifest stores paths below the home directory relative to it, so caches move between hosts
+std::string home_directory()
+{
+#if defined(_WIN32)
+    const char *home = std::getenv("USERPROFILE");
+#else
+    const char *home = std::getenv("HOME");
+#endif
+    return home != nullptr ? home : "";
+}
+} // namespace
+
+ShaderWarmup::ShaderWarmup(int p_frames)
+    : frames(p_frames)
+{
+}
+
+bool ShaderWarmup::start()
+{
+    // A reloaded project gets a full warm-up of its own, even if the last one was cut short
+    frames_drawn   = 0;
+    geometry_nodes = 0;
+    copies         = 0;
+    duration_ms    = 0.0;
+    stage          = {};
+    seen.clear();
+
+    started   = Clock::now();
+    auto tree = godot_singleton("Engine").call("get_main_loop");
+    auto root = tree.call("get_root");
+    class_db  = godot_singleton("ClassDB");
+    if (root.is_nil() || class_db.is_nil()) {
+        std::cerr << "shader warm-up needs a scene tree" << std::endl;
+        return false;
+    }
+    user_dir = godot_singleton("OS").call("get_user_data_dir").to_string();
+
+    stage = class_db.call("instantiate", {GodotVariant::from_string("SubViewport")});
+    stage.call("set_update_mode", {GodotVariant::from_int(update_always)});
+    auto camera = class_db.call("instantiate", {GodotVariant::from_string("Camera3D")});
+    stage.call("add_child", {camera});
+
+    auto nodes = root.call("find_children",
+                           {GodotVariant::from_string("*"),
+                            GodotVariant::from_string("GeometryInstance3D"),
+                            GodotVariant::from_bool(true), GodotVariant::from_bool(false)});
+    auto mesh_instance = GodotVariant::from_string("MeshInstance3D");
+    while (nodes.call("size").to_int() > 0) {
+        auto node = nodes.call("pop_back");
+        ++geometry_nodes;
+        if (node.call("is_class", {mesh_instance}).to_bool()) {
+            add_copy(node, camera);
+        }
+    }
+
+    root.call("add_child", {stage});
+    return true;
+}
+
+void ShaderWarmup::add_copy(const GodotVariant &source, const GodotVariant &parent)
+{
+    auto mesh = source.call("get_mesh");
+    if (mesh.is_nil()) {
+        return;
+    }
+
+    // get_active_material() already resolves overrides down to the mesh's own materials
+    auto                      surfaces = mesh.call("get_surface_count").to_int();
+    std::vector<GodotVariant> materials;
+    std::string               key = object_key(mesh);
+    for (int64_t surface = 0; surface < surfaces; ++surface) {
+        materials.push_back(source.call("get_active_material", {GodotVariant::from_int(surface)}));
+        key += ":" + object_key(materials.back());
+    }
+    if (!seen.insert(key).second) {
+        return;
+    }
+
+    auto copy = class_db.call("instantiate", {GodotVariant::from_string("MeshInstance3D")});
+    copy.call("set_mesh", {mesh});
+    for (int64_t surface = 0; surface < surfaces; ++surface) {
+        copy.call("set_surface_override_material",
+                  {GodotVariant::from_int(surface), materials[static_cast<size_t>(surface)]});
+    }
+    parent.call("add_child", {copy});
+    ++copies;
+}
+
+bool ShaderWarmup::step()
+{
+    if (stage.is_nil()) {
+        return true;
+    }
+    if (++frames_drawn < frames) {
+        return false;
+    }
+
+    stage.call("queue_free");
+    stage       = {};
+    duration_ms = std::chrono::duration<double, std::milli>(Clock::now() - started).count();
+    return true;
+}
+
+void ShaderWarmup::write_json(JsonWriter &json) const
+{
+    json.field("user_data_dir", user_dir);
+    json.field("geometry_nodes", geometry_nodes);
+    json.field("copies", copies);
+    json.field("frames", frames_drawn);
+    json.field("duration_ms", duration_ms);
+}
+
+bool export_shader_cache(const std::string &user_dir, const std::string &cache_dir)
+{
+    std::error_code error;
+    fs::create_directories(cache_dir, error);
+
+    int copied = 0;
+    for (auto name : cache_directories) {
+        auto source = fs::path(user_dir) / name;
+        if (!fs::is_directory(source, error)) {
+            continue;
+        }
+        fs::copy(source, fs::path(cache_dir) / name,
+                 fs::copy_options::recursive | fs::copy_options::overwrite_existing, error);
+        if (error) {
+            std::cerr << "failed to export " << source.string() << ": " << error.message()
+                      << std::endl;
+            continue;
+        }
+        ++copied;
+    }
+    if (copied == 0) {
+        std::cerr << "no shader or pipeline cache found in " << user_dir << std::endl;
+        return false;
+    }
+
+    auto home     = home_directory();
+    auto relative = !home.empty() && user_dir.rfind(home, 0) == 0
+                        ? "~" + user_dir.substr(home.size())
+                        : user_dir;
+    std::ofstream manifest(fs::path(cache_dir) / manifest_name);
+    manifest << relative << "\n";
+    return static_cast<bool>(manifest);
+}
+
+bool import_shader_cache(const std::string &cache_dir)
+{
+    std::ifstream manifest(fs::path(cache_dir) / manifest_name);
+    std::string   user_dir;
+    if (!std::getline(manifest, user_dir) || user_dir.empty()) {
+        std::cerr << "no shader cache manifest in " << cache_dir << std::endl;
+        return false;
+    }
+    if (user_dir[0] == '~') {
+        user_dir = home_directory() + user_dir.substr(1);
+    }
+
+    std::error_code error;
+    fs::create_directories(user_dir, error);
+    for (auto name : cache_directories) {
+        auto source = fs::path(cache_dir) / name;
+        if (!fs::is_directory(source, error)) {
+            continue;
+        }
+        fs::copy(source, fs::path(user_dir) / name,
+                 fs::copy_options::recursive | fs::copy_options::overwrite_existing, error);
+        if (error) {
+            std::cerr << "failed to import " << source.string() << ": " << error.message()
+                      << std::endl;
+            return false;
+        }
+    }
+    return true;
+}
@@ -0,0 +1,81 @@
+/*
+ * Off-screen rendering of a project's materials to fill the engine's shader and pipeline caches.
+ */
+
+#pragma once
+
+#include <chrono>
+#include <string>
+#include <unordered_set>
+
+#include "godot_api.h"
+
+class JsonWriter;
+
+/*
+ * Finds every distinct combination of mesh and materials in the loaded scene tree and draws a
+ * copy of each in a SubViewport for a number of frames. Drawing is what makes the engine compile
+ * the shader variants and pipelines a material needs, which it stores in its shader cache and,
+ * at shutdown, its pipeline cache under the project's user data directory. Production instances
+ * of the same project then find them there instead of compiling during their first frames.
+ *
+ * The SubViewport shares the world of the root viewport, so the scene's lights and environment
+ * select the same variants the scene itself will use. Only draw submission matters, so the
+ * copies all sit on the warm-up camera instead of being laid out.
+ */
+class ShaderWarmup
+{
+  public:
+    using Clock = std::chrono::steady_clock;
+
+    explicit ShaderWarmup(int p_frames);
+
+    /*
+     * Builds the off-screen stage from the current scene tree, starting the frame count over.
+     * Returns false, reporting why on stderr, without a scene tree.
+     */
+    bool start();
+
+    /*
+     * Called by the host after each iteration. Returns true once enough frames were drawn; the
+     * stage is then freed.
+     */
+    bool step();
+
+    /*
+     * The project's user data directory, where the engine keeps its caches. Recorded by start().
+     */
+    const std::string &user_data_dir() const
+    {
+        return user_dir;
+    }
+
+    void write_json(JsonWriter &json) const;
+
+  private:
+    void add_copy(const GodotVariant &source, const GodotVariant &parent);
+
+    int                             frames;
+    int                             frames_drawn = 0;
+    GodotVariant                    class_db;
+    GodotVariant                    stage; // SubViewport holding the warm-up camera and copies
+    std::string                     user_dir;
+    std::unordered_set<std::string> seen; // Mesh and material combinations already added
+    Clock::time_point               started;
+
+    uint64_t geometry_nodes = 0;
+    uint64_t copies         = 0;
+    double   duration_ms    = 0.0;
+};
+
+/*
+ * Copies the engine's shader and pipeline caches from user_dir into cache_dir, with a manifest
+ * naming user_dir. Returns false, reporting why on stderr, if nothing could be copied.
+ */
+bool export_shader_cache(const std::string &user_dir, const std::string &cache_dir);
+
+/*
+ * Copies caches exported by export_shader_cache() back into the user data directory named in
+ * the manifest, before the engine starts and reads them.
+ */
+bool import_shader_cache(const std::string &cache_dir);
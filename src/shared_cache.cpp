@@ -0,0 +1,398 @@
+#include "shared_cache.h"
+
+#include <algorithm>
+#include <array>
+#include <cerrno>
+#include <chrono>
+#include <ctime>
+#include <cstdio>
+#include <cstring>
+#include <filesystem>
+#include <iostream>
+#include <optional>
+#include <random>
+#include <vector>
+
+#if !defined(_WIN32)
+#include <fcntl.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+#include "json_writer.h"
+#include "pack_mapping.h"
+
+namespace fs = std::filesystem;
+
+namespace
+{
+constexpr const char *index_prefix   = "index-";
+constexpr const char *content_prefix = "content-";
+constexpr const char *temp_marker    = ".tmp";
+
+// Links unused for longer are evicted, and temporaries of hosts that died while linking
+constexpr auto entry_lifetime     = std::chrono::hours(24);
+constexpr auto temporary_lifetime = std::chrono::hours(1);
+
+/*
+ * SHA-256 (FIPS 180-4). Stored packs are named after it, so two packs only share an entry when
+ * their content is the same.
+ */
+class Sha256
+{
+  public:
+    void update(const uint8_t *data, size_t size)
+    {
+        length += size;
+        if (buffered > 0) {
+            auto take = std::min(size, block.size() - buffered);
+            std::memcpy(block.data() + buffered, data, take);
+            buffered += take;
+            data += take;
+            size -= take;
+            if (buffered < block.size()) {
+                return;
+            }
+            compress(block.data());
+            buffered = 0;
+        }
+        for (; size >= block.size(); data += block.size(), size -= block.size()) {
+            compress(data);
+        }
+        std::memcpy(block.data(), data, size);
+        buffered = size;
+    }
+
+    std::string finish()
+    {
+        uint64_t bits = length * 8;
+        uint8_t  pad  = 0x80;
+        update(&pad, 1);
+        pad = 0;
+        while (buffered != block.size() - sizeof(bits)) {
+            update(&pad, 1);
+        }
+        uint8_t size[sizeof(bits)];
+        for (size_t i = 0; i < sizeof(bits); ++i) {
+            size[i] = static_cast<uint8_t>(bits >> (56 - 8 * i));
+        }
+        update(size, sizeof(size));
+
+        std::string digest;
+        char        hex[9];
+        for (auto word : state) {
+            std::snprintf(hex, sizeof(hex), "%08x", word);
+            digest += hex;
+        }
+        return digest;
+    }
+
+  private:
+    static uint32_t rotate(uint32_t value, int bits)
+    {
+        return (value >> bits) | (value << (32 - bits));
+    }
+
+    void compress(const uint8_t *data)
+    {
+        static constexpr uint32_t k[64] = {
+            0x428a2f98, 0x71374491, 0xb5c0fbcf, 0xe9b5dba5, 0x3956c25b, 0x59f111f1, 0x923f82a4,
+            0xab1c5ed5, 0xd807aa98, 0x12835b01, 0x243185be, 0x550c7dc3, 0x72be5d74, 0x80deb1fe,
+            0x9bdc06a7, 0xc19bf174, 0xe49b69c1, 0xefbe4786, 0x0fc19dc6, 0x240ca1cc, 0x2de92c6f,
+            0x4a7484aa, 0x5cb0a9dc, 0x76f988da, 0x983e5152, 0xa831c66d, 0xb00327c8, 0xbf597fc7,
+            0xc6e00bf3, 0xd5a79147, 0x06ca6351, 0x14292967, 0x27b70a85, 0x2e1b2138, 0x4d2c6dfc,
+            0x53380d13, 0x650a7354, 0x766a0abb, 0x81c2c92e, 0x92722c85, 0xa2bfe8a1, 0xa81a664b,
+            0xc24b8b70, 0xc76c51a3, 0xd192e819, 0xd6990624, 0xf40e3585, 0x106aa070, 0x19a4c116,
+            0x1e376c08, 0x2748774c, 0x34b0bcb5, 0x391c0cb3, 0x4ed8aa4a, 0x5b9cca4f, 0x682e6ff3,
+            0x748f82ee, 0x78a5636f, 0x84c87814, 0x8cc70208, 0x90befffa, 0xa4506ceb, 0xbef9a3f7,
+            0xc67178f2,
+        };
+
+        uint32_t w[64];
+        for (int i = 0; i < 16; ++i) {
+            w[i] = static_cast<uint32_t>(data[4 * i]) << 24
+                   | static_cast<uint32_t>(data[4 * i + 1]) << 16
+                   | static_cast<uint32_t>(data[4 * i + 2]) << 8 | data[4 * i + 3];
+        }
+        for (int i = 16; i < 64; ++i) {
+            auto s0 = rotate(w[i - 15], 7) ^ rotate(w[i - 15], 18) ^ (w[i - 15] >> 3);
+            auto s1 = rotate(w[i - 2], 17) ^ rotate(w[i - 2], 19) ^ (w[i - 2] >> 10);
+            w[i]    = w[i - 16] + s0 + w[i - 7] + s1;
+        }
+
+        auto v = state;
+        for (int i = 0; i < 64; ++i) {
+            auto s1  = rotate(v[4], 6) ^ rotate(v[4], 11) ^ rotate(v[4], 25);
+            auto ch  = (v[4] & v[5]) ^ (~v[4] & v[6]);
+            auto t1  = v[7] + s1 + ch + k[i] + w[i];
+            auto s0  = rotate(v[0], 2) ^ rotate(v[0], 13) ^ rotate(v[0], 22);
+            auto maj = (v[0] & v[1]) ^ (v[0] & v[2]) ^ (v[1] & v[2]);
+            v        = {t1 + s0 + maj, v[0], v[1], v[2], v[3] + t1, v[4], v[5], v[6]};
+        }
+        for (size_t i = 0; i < state.size(); ++i) {
+            state[i] += v[i];
+        }
+    }
+
+    std::array<uint32_t, 8> state = {0x6a09e667, 0xbb67ae85, 0x3c6ef372, 0xa54ff53a,
+                                     0x510e527f, 0x9b05688c, 0x1f83d9ab, 0x5be0cd19};
+    std::array<uint8_t, 64> block;
+    size_t                  buffered = 0;
+    uint64_t                length   = 0;
+};
+
+std::string sha256(const uint8_t *data, size_t size)
+{
+    Sha256 hash;
+    hash.update(data, size);
+    return hash.finish();
+}
+
+std::string sha256(const std::string &text)
+{
+    return sha256(reinterpret_cast<const uint8_t *>(text.data()), text.size());
+}
+
+std::string hex(uint64_t value)
+{
+    char buffer[17];
+    std::snprintf(buffer, sizeof(buffer), "%016llx", static_cast<unsigned long long>(value));
+    return buffer;
+}
+
+// Per-user name, the store is never shared between users
+std::string store_name()
+{
+#if defined(_WIN32)
+    return PROJECT_NAME "-store"; // Below the user's own temp directory
+#else
+    return PROJECT_NAME "-" + std::to_string(geteuid());
+#endif
+}
+
+const char *lookup_name(int lookup)
+{
+    static const char *names[] = {"none", "index", "content", "registered"};
+    return names[lookup];
+}
+
+// Points link at target, replacing whatever it pointed at before in one step
+bool replace_link(const fs::path &target, const fs::path &link)
+{
+    auto temporary = link;
+    temporary += temp_marker + hex(std::random_device()());
+    std::error_code error;
+    fs::create_symlink(target, temporary, error);
+    if (!error) {
+        fs::rename(temporary, link, error);
+    }
+    if (error) {
+        std::error_code ignored;
+        fs::remove(temporary, ignored);
+        return false;
+    }
+    return true;
+}
+
+// Marks a link as used, without following it to the pack
+void touch_link(const fs::path &link)
+{
+#if !defined(_WIN32)
+    utimensat(AT_FDCWD, link.c_str(), nullptr, AT_SYMLINK_NOFOLLOW);
+#endif
+}
+
+// Time since a link itself was last used, nothing on systems that cannot tell
+std::optional<std::chrono::seconds> link_age(const fs::path &link)
+{
+#if defined(_WIN32)
+    (void)link;
+    return std::nullopt;
+#else
+    struct stat info;
+    if (lstat(link.c_str(), &info) != 0) {
+        return std::nullopt;
+    }
+    return std::chrono::seconds(std::time(nullptr) - info.st_mtime);
+#endif
+}
+} // namespace
+
+std::string SharedCache::default_directory()
+{
+    std::error_code error;
+    if (fs::is_directory("/dev/shm", error)) {
+        return "/dev/shm";
+    }
+    return fs::temp_directory_path(error).string();
+}
+
+SharedCache::SharedCache(const std::string &p_directory)
+    : directory((fs::path(p_directory) / store_name()).string())
+{
+}
+
+bool SharedCache::open_directory()
+{
+#if defined(_WIN32)
+    std::error_code error;
+    fs::create_directories(directory, error);
+    return fs::is_directory(directory, error);
+#else
+    if (mkdir(directory.c_str(), 0700) != 0 && errno != EEXIST) {
+        std::cerr << "failed to create the shared cache " << directory << ": "
+                  << std::strerror(errno) << std::endl;
+        return false;
+    }
+
+    // Someone else may have created it first, as a symlink or with other permissions
+    struct stat info;
+    if (lstat(directory.c_str(), &info) != 0 || !S_ISDIR(info.st_mode)
+        || info.st_uid != geteuid() || (info.st_mode & 077) != 0) {
+        std::cerr << "refusing the shared cache " << directory
+                  << ": not a directory of this user with mode 0700" << std::endl;
+        return false;
+    }
+    return true;
+#endif
+}
+
+std::optional<fs::path> SharedCache::index_link(const fs::path &path) const
+{
+    // Named after the pack's identity, so a changed pack is looked up under a new name
+    std::error_code error;
+    auto            size  = fs::file_size(path, error);
+    auto            mtime = fs::last_write_time(path, error).time_since_epoch().count();
+    if (error) {
+        return std::nullopt;
+    }
+    auto key = sha256(path.string() + "\n" + std::to_string(size) + "\n" + std::to_string(mtime));
+    return fs::path(directory) / (index_prefix + key);
+}
+
+std::optional<fs::path> SharedCache::registered(const fs::path &content) const
+{
+    // The pack still has the content only if its current identity is indexed to this link
+    std::error_code error;
+    auto            pack = fs::read_symlink(content, error);
+    if (error || !fs::is_regular_file(pack, error)) {
+        return std::nullopt;
+    }
+    auto index = index_link(pack);
+    if (!index || fs::read_symlink(*index, error) != content || error) {
+        return std::nullopt;
+    }
+    return pack;
+}
+
+std::string SharedCache::resolve(const std::string &path)
+{
+    source   = path;
+    resolved = path;
+    lookup   = Lookup::None;
+
+    std::error_code error;
+    if (!fs::is_regular_file(path, error) || !open_directory()) {
+        return path;
+    }
+
+    auto absolute = fs::absolute(path, error);
+    bytes         = fs::file_size(path, error);
+    auto index    = index_link(absolute);
+    if (error || !index) {
+        return path;
+    }
+
+    auto content = fs::read_symlink(*index, error);
+    if (!error) {
+        if (auto pack = registered(content)) {
+            resolved = pack->string();
+            lookup   = Lookup::Index;
+            touch_link(*index);
+            touch_link(content);
+            evict();
+            return resolved;
+        }
+    }
+
+    PackMapping mapping;
+    if (!mapping.map(path)) {
+        return path;
+    }
+    content_hash = sha256(mapping.bytes(), mapping.size());
+    mapping.unmap();
+
+    content = fs::path(directory) / (content_prefix + content_hash + "-" + std::to_string(bytes));
+    if (auto pack = registered(content)) {
+        resolved = pack->string();
+        lookup   = Lookup::Content;
+        touch_link(content);
+    } else if (replace_link(absolute, content)) {
+        // A racing host with the same content may replace it again, both packs are valid
+        resolved = absolute.string();
+        lookup   = Lookup::Registered;
+    } else {
+        std::cerr << "failed to register " << path << " in the shared cache in " << directory
+                  << std::endl;
+        return path;
+    }
+
+    // Without it the next host hashes the pack again, and cannot use a pack this host registered
+    replace_link(content, *index);
+
+    evict();
+    return resolved;
+}
+
+void SharedCache::evict()
+{
+    // A host marks links as used by touching them whenever it resolves through them
+    std::vector<fs::path> indexes;
+    std::vector<fs::path> contents;
+    std::error_code       error;
+    for (const auto &item : fs::directory_iterator(directory, error)) {
+        auto            name = item.path().filename().string();
+        auto            age  = link_age(item.path());
+        std::error_code link_error;
+        if (!age || !item.is_symlink(link_error)) {
+            continue;
+        }
+
+        if (name.find(temp_marker) != std::string::npos) {
+            if (*age > temporary_lifetime) {
+                fs::remove(item.path(), link_error);
+            }
+        } else if (*age > entry_lifetime) {
+            if (fs::remove(item.path(), link_error)) {
+                ++evicted;
+            }
+        } else if (name.rfind(index_prefix, 0) == 0) {
+            indexes.push_back(item.path());
+        } else if (name.rfind(content_prefix, 0) == 0) {
+            contents.push_back(item.path());
+        }
+    }
+
+    // Content links to removed packs, then index links to removed content links, point nowhere
+    for (const auto &links : {contents, indexes}) {
+        for (const auto &link : links) {
+            std::error_code link_error;
+            if (!fs::exists(link, link_error) && !link_error && fs::remove(link, link_error)) {
+                ++evicted;
+            }
+        }
+    }
+}
+
+void SharedCache::write_json(JsonWriter &json) const
+{
+    json.field("directory", directory);
+    json.field("source", source);
+    json.field("path", resolved);
+    json.field("lookup", lookup_name(static_cast<int>(lookup)));
+    json.field("bytes", bytes);
+    if (lookup == Lookup::Content || lookup == Lookup::Registered) {
+        json.field("content_hash", content_hash);
+    }
+    json.field("evicted", evicted);
+}
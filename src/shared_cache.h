@@ -0,0 +1,75 @@
+/*
+ * Content-addressed index of project packs, so every host on the machine loads one copy of a pack.
+ */
+
+#pragma once
+
+#include <cstdint>
+#include <filesystem>
+#include <optional>
+#include <string>
+
+class JsonWriter;
+
+/*
+ * Keeps a per-user index, by default on the tmpfs at /dev/shm, from the SHA-256 and size of a
+ * pck to the first pack registered with that content. Every host resolving a copy of that pack
+ * at another path loads the registered file instead, so the kernel keeps one copy of it in the
+ * page cache instead of one per copy. Hosts loading the same path, such as replicas of one
+ * launch, already share its pages and gain nothing. Packs are never copied: the store holds symlinks only and adds no memory of its
+ * own. A second index keyed by path, size and modification time lets hosts skip hashing a pack
+ * the store already knows, and tells whether a registered pack still has its content.
+ *
+ * The store is a directory private to the user (mode 0700) that is refused if anyone else owns
+ * it, so other users can neither read its links nor plant one under a known name. Links not
+ * used for a day are evicted. Eviction never removes a pack, so hosts running from one are
+ * unaffected.
+ *
+ * The engine still decodes resources into each process's own heap; only the pack's pages are
+ * shared.
+ */
+class SharedCache
+{
+  public:
+    /*
+     * Returns the default store directory: /dev/shm where it exists, the temp directory
+     * otherwise.
+     */
+    static std::string default_directory();
+
+    /*
+     * Uses the store in a per-user subdirectory of p_directory, created on first use.
+     */
+    explicit SharedCache(const std::string &p_directory);
+
+    /*
+     * Returns the path to load instead of path: the pack registered with the same content, path
+     * itself if it is the first. Returns path unchanged for project directories or when the
+     * store cannot be used.
+     */
+    std::string resolve(const std::string &path);
+
+    void write_json(JsonWriter &json) const;
+
+  private:
+    enum class Lookup {
+        None,       // Not a pack or the store failed
+        Index,      // Found through the path index
+        Content,    // Another pack with the same content was already registered
+        Registered, // Registered by this host
+    };
+
+    bool open_directory();
+    void evict();
+
+    std::optional<std::filesystem::path> index_link(const std::filesystem::path &path) const;
+    std::optional<std::filesystem::path> registered(const std::filesystem::path &content) const;
+
+    std::string directory;
+    std::string source;
+    std::string resolved;
+    Lookup      lookup = Lookup::None;
+    std::string content_hash;
+    uint64_t    bytes   = 0;
+    uint64_t    evicted = 0;
+};
@@ -0,0 +1,403 @@
+#include "shm_transport.h"
+
+#include <algorithm>
+#include <cerrno>
+#include <cstring>
+#include <iostream>
+#include <new>
+#include <thread>
+
+#if !defined(_WIN32)
+#include <fcntl.h>
+#include <signal.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+#if defined(__linux__)
+#include <climits>
+#include <linux/futex.h>
+#include <sys/syscall.h>
+#endif
+
+#include "json_writer.h"
+
+namespace
+{
+using Clock = std::chrono::steady_clock;
+
+std::string segment_name(const std::string &name)
+{
+    return name.rfind('/', 0) == 0 ? name : "/" + name;
+}
+
+size_t segment_size(size_t slots)
+{
+    auto offset = (sizeof(ShmSegment) + 63) & ~size_t(63);
+    return offset + slots * sizeof(ChannelCommand);
+}
+
+/*
+ * Sleeps while word still holds expected, up to timeout. Shared (not process-private) futexes,
+ * since the word lives in memory mapped by two processes.
+ */
+void wait_on(std::atomic<uint32_t> &word, uint32_t expected, std::chrono::microseconds timeout)
+{
+#if defined(__linux__)
+    timespec ts;
+    ts.tv_sec  = static_cast<time_t>(timeout.count() / 1000000);
+    ts.tv_nsec = static_cast<long>(timeout.count() % 1000000) * 1000;
+    syscall(SYS_futex, reinterpret_cast<uint32_t *>(&word), FUTEX_WAIT, expected, &ts, nullptr, 0);
+#else
+    // No portable cross-process wait, poll instead
+    auto until = Clock::now() + timeout;
+    while (word.load(std::memory_order_acquire) == expected && Clock::now() < until) {
+        std::this_thread::sleep_for(std::chrono::microseconds(20));
+    }
+#endif
+}
+
+void ring(std::atomic<uint32_t> &word, std::atomic<uint32_t> &waiters)
+{
+    // Sequentially consistent, pairs with the waiter announcing itself before its last check
+    word.fetch_add(1, std::memory_order_seq_cst);
+#if defined(__linux__)
+    if (waiters.load(std::memory_order_seq_cst) != 0) {
+        syscall(SYS_futex, reinterpret_cast<uint32_t *>(&word), FUTEX_WAKE, INT_MAX, nullptr,
+                nullptr, 0);
+    }
+#else
+    (void)waiters;
+#endif
+}
+
+void *map_segment(const std::string &name, size_t size, bool create)
+{
+#if defined(_WIN32)
+    (void)name;
+    (void)size;
+    (void)create;
+    return nullptr;
+#else
+    int fd = shm_open(name.c_str(), create ? O_RDWR | O_CREAT : O_RDWR, 0600);
+    if (fd < 0) {
+        return nullptr;
+    }
+    if (create && ftruncate(fd, static_cast<off_t>(size)) != 0) {
+        ::close(fd);
+        return nullptr;
+    }
+
+    // A host may not have sized its segment yet; touching pages past the end raises SIGBUS
+    struct stat info;
+    if (fstat(fd, &info) != 0 || info.st_size < static_cast<off_t>(size)) {
+        ::close(fd);
+        return nullptr;
+    }
+    void *memory = mmap(nullptr, size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    ::close(fd);
+    return memory == MAP_FAILED ? nullptr : memory;
+#endif
+}
+
+// A segment whose host crashed still has a valid header, but nobody will ever publish to it
+bool process_alive(int64_t pid)
+{
+#if defined(_WIN32)
+    (void)pid;
+    return true;
+#else
+    return pid > 0 && (kill(static_cast<pid_t>(pid), 0) == 0 || errno == EPERM);
+#endif
+}
+
+void unmap_segment(void *memory, size_t size)
+{
+#if !defined(_WIN32)
+    munmap(memory, size);
+#endif
+}
+} // namespace
+
+ShmTransport::ShmTransport(std::string p_name, bool p_lockstep, size_t command_slots)
+    : name(segment_name(p_name))
+    , lockstep(p_lockstep)
+    , slots(1)
+{
+    while (slots < std::max<size_t>(command_slots, 2)) {
+        slots <<= 1;
+    }
+}
+
+ShmTransport::~ShmTransport()
+{
+    close();
+}
+
+bool ShmTransport::open()
+{
+#if defined(_WIN32)
+    std::cerr << "--shm needs POSIX shared memory, which Windows does not have" << std::endl;
+    return false;
+#else
+    // A segment left behind by a crashed host may have another size or a supervisor attached
+    shm_unlink(name.c_str());
+
+    mapped_size  = segment_size(slots);
+    void *memory = map_segment(name, mapped_size, true);
+    if (memory == nullptr) {
+        std::cerr << "failed to create shared memory segment " << name << ": "
+                  << std::strerror(errno) << std::endl;
+        return false;
+    }
+
+    segment                  = new (memory) ShmSegment();
+    segment->version         = ShmSegment::version_value;
+    segment->command_slots   = static_cast<uint32_t>(slots);
+    segment->commands_offset = static_cast<uint32_t>(segment_size(0));
+    segment->host_pid        = static_cast<int64_t>(getpid());
+    segment->magic.store(ShmSegment::magic_value, std::memory_order_release);
+    return true;
+#endif
+}
+
+void ShmTransport::close()
+{
+    if (segment == nullptr) {
+        return;
+    }
+
+    segment->closed.store(1, std::memory_order_release);
+    ring(segment->state_doorbell, segment->state_waiters);
+    unmap_segment(segment, mapped_size);
+    segment = nullptr;
+#if !defined(_WIN32)
+    shm_unlink(name.c_str());
+#endif
+}
+
+bool ShmTransport::take_commands(ControlChannel &channel)
+{
+    auto  tail     = segment->command_tail.load(std::memory_order_relaxed);
+    auto  head     = segment->command_head.load(std::memory_order_acquire);
+    auto *commands = segment->commands();
+    bool  any      = tail != head;
+    for (; tail != head; ++tail) {
+        const auto &command = commands[tail & (slots - 1)];
+        ++received;
+        switch (command.type) {
+            case ShmStep: {
+                uint32_t count = 1;
+                if (command.size >= sizeof(count)) {
+                    std::memcpy(&count, command.payload, sizeof(count));
+                }
+                steps_granted += count;
+                break;
+            }
+            case ShmQuit:
+                quit = true;
+                break;
+            default:
+                ++forwarded;
+                if (!channel.send(command)) {
+                    ++rejected;
+                }
+                break;
+        }
+    }
+    segment->command_tail.store(tail, std::memory_order_release);
+    return any;
+}
+
+bool ShmTransport::receive(ControlChannel &channel)
+{
+    if (segment == nullptr) {
+        return true;
+    }
+
+    take_commands(channel);
+    while (lockstep && steps_granted == 0 && !quit) {
+        // Announce the wait, then recheck, so a command sent in between is not slept through
+        auto doorbell = segment->command_doorbell.load(std::memory_order_acquire);
+        segment->command_waiters.fetch_add(1, std::memory_order_seq_cst);
+        if (!take_commands(channel)) {
+            auto started = Clock::now();
+            wait_on(segment->command_doorbell, doorbell, std::chrono::milliseconds(100));
+            wait_ns += static_cast<uint64_t>(
+                std::chrono::duration_cast<std::chrono::nanoseconds>(Clock::now() - started)
+                    .count());
+            ++waits;
+        }
+        segment->command_waiters.fetch_sub(1, std::memory_order_relaxed);
+
+        // Nobody is left to grant the next step; a host not attached to yet keeps waiting
+        auto supervisor = segment->supervisor_pid.load(std::memory_order_acquire);
+        if (supervisor != 0 && !process_alive(supervisor) && steps_granted == 0 && !quit) {
+            std::cerr << "shm supervisor " << supervisor << " exited, ending the project"
+                      << std::endl;
+            orphaned = true;
+            return false;
+        }
+    }
+
+    if (quit) {
+        quit = false; // A reloaded or warm-started project starts fresh
+        return false;
+    }
+    if (lockstep) {
+        --steps_granted;
+    }
+    return true;
+}
+
+void ShmTransport::publish(const ChannelState &state, uint64_t iteration_ns)
+{
+    if (segment == nullptr) {
+        return;
+    }
+
+    auto sequence = segment->state_sequence.load(std::memory_order_relaxed);
+    segment->state_sequence.store(sequence + 1, std::memory_order_relaxed);
+    std::atomic_thread_fence(std::memory_order_release);
+
+    // Only the used part of the state is copied
+    auto &shared   = segment->state;
+    shared.frame   = state.frame;
+    shared.time_ns = state.time_ns;
+    shared.size    = std::min<uint32_t>(state.size, ChannelState::data_capacity);
+    std::memcpy(shared.data, state.data, shared.size);
+    segment->iteration_ns = iteration_ns;
+
+    segment->state_sequence.store(sequence + 2, std::memory_order_release);
+    ring(segment->state_doorbell, segment->state_waiters);
+    ++published;
+}
+
+void ShmTransport::write_json(JsonWriter &json) const
+{
+    json.field("name", name);
+    json.field("lockstep", lockstep);
+    json.field("received", received);
+    json.field("forwarded", forwarded);
+    json.field("rejected", rejected);
+    json.field("published", published);
+    json.field("waits", waits);
+    json.field("wait_ms", static_cast<double>(wait_ns) / 1e6);
+    json.field("orphaned", orphaned);
+}
+
+ShmClient::~ShmClient()
+{
+    if (segment != nullptr) {
+        unmap_segment(segment, mapped_size);
+    }
+}
+
+bool ShmClient::open(const std::string &name, std::chrono::milliseconds timeout)
+{
+    auto until = Clock::now() + timeout;
+    auto path  = segment_name(name);
+    while (true) {
+        // Map the header first to learn the ring size, then the whole segment
+        auto header = static_cast<ShmSegment *>(map_segment(path, sizeof(ShmSegment), false));
+        if (header != nullptr) {
+            bool ready = header->magic.load(std::memory_order_acquire) == ShmSegment::magic_value
+                         && header->version == ShmSegment::version_value
+                         && header->closed.load(std::memory_order_acquire) == 0
+                         && process_alive(header->host_pid);
+            auto slots = header->command_slots;
+            unmap_segment(header, sizeof(ShmSegment));
+            if (ready) {
+                mapped_size = segment_size(slots);
+                segment     = static_cast<ShmSegment *>(map_segment(path, mapped_size, false));
+                if (segment == nullptr) {
+                    return false;
+                }
+#if !defined(_WIN32)
+                segment->supervisor_pid.store(static_cast<int64_t>(getpid()),
+                                              std::memory_order_release);
+#endif
+                return true;
+            }
+        }
+        if (Clock::now() >= until) {
+            return false;
+        }
+        std::this_thread::sleep_for(std::chrono::milliseconds(1));
+    }
+}
+
+bool ShmClient::send(const ChannelCommand &command)
+{
+    auto head = segment->command_head.load(std::memory_order_relaxed);
+    auto tail = segment->command_tail.load(std::memory_order_acquire);
+    if (head - tail >= segment->command_slots || command.size > ChannelCommand::payload_capacity) {
+        return false;
+    }
+
+    segment->commands()[head & (segment->command_slots - 1)] = command;
+    segment->command_head.store(head + 1, std::memory_order_release);
+    ring(segment->command_doorbell, segment->command_waiters);
+    return true;
+}
+
+bool ShmClient::step(uint32_t count)
+{
+    ChannelCommand command;
+    command.type = ShmStep;
+    command.size = sizeof(count);
+    std::memcpy(command.payload, &count, sizeof(count));
+    return send(command);
+}
+
+bool ShmClient::wait_state(uint64_t after_frame, ChannelState &r_state,
+                           std::chrono::microseconds timeout)
+{
+    return wait_copy(after_frame, r_state.data, ChannelState::data_capacity, r_state.frame,
+                     r_state.time_ns, r_state.size, timeout);
+}
+
+bool ShmClient::wait_data(uint64_t after_frame, void *r_data, size_t capacity, uint64_t &r_frame,
+                          uint32_t &r_size, std::chrono::microseconds timeout)
+{
+    uint64_t time_ns = 0;
+    return wait_copy(after_frame, r_data, capacity, r_frame, time_ns, r_size, timeout);
+}
+
+bool ShmClient::wait_copy(uint64_t after_frame, void *r_data, size_t capacity, uint64_t &r_frame,
+                          uint64_t &r_time_ns, uint32_t &r_size, std::chrono::microseconds timeout)
+{
+    auto until = Clock::now() + timeout;
+    while (true) {
+        auto doorbell = segment->state_doorbell.load(std::memory_order_acquire);
+
+        // Retry while the host is writing, the copy is only valid if the sequence did not move
+        auto sequence = segment->state_sequence.load(std::memory_order_acquire);
+        if ((sequence & 1) == 0 && segment->state.frame > after_frame) {
+            r_frame   = segment->state.frame;
+            r_time_ns = segment->state.time_ns;
+            r_size    = std::min<uint32_t>(segment->state.size, ChannelState::data_capacity);
+            std::memcpy(r_data, segment->state.data, std::min<size_t>(r_size, capacity));
+            std::atomic_thread_fence(std::memory_order_acquire);
+            if (segment->state_sequence.load(std::memory_order_relaxed) == sequence) {
+                return true;
+            }
+            continue;
+        }
+
+        auto now = Clock::now();
+        if (segment->closed.load(std::memory_order_acquire) != 0 || now >= until
+            || !process_alive(segment->host_pid)) {
+            return false;
+        }
+        segment->state_waiters.fetch_add(1, std::memory_order_seq_cst);
+        if (segment->state_doorbell.load(std::memory_order_seq_cst) == doorbell) {
+            // Bounded, so a host that died without closing the segment is noticed
+            wait_on(segment->state_doorbell, doorbell,
+                    std::min<std::chrono::microseconds>(
+                        std::chrono::duration_cast<std::chrono::microseconds>(until - now),
+                        std::chrono::milliseconds(100)));
+        }
+        segment->state_waiters.fetch_sub(1, std::memory_order_relaxed);
+    }
+}
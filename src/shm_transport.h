@@ -0,0 +1,176 @@
+/*
+ * Shared memory transport for the control channel, for supervisors driving many host processes.
+ */
+
+#pragma once
+
+#include <atomic>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <string>
+
+#include "control_channel.h"
+
+class JsonWriter;
+
+/*
+ * Command types the host handles itself. The transport takes step and quit; every other type,
+ * input included, is forwarded through the control channel, so the host applies and records all
+ * commands in the order they were sent.
+ */
+enum ShmCommandType : uint32_t {
+    ShmStep    = 0xffff0001, // uint32 count (default 1): iterations a lockstep host may run
+    ShmQuit    = 0xffff0002, // Ends the project as if the engine had quit
+    ShmPress   = 0xffff0003, // float strength, then the action name: Input.action_press()
+    ShmRelease = 0xffff0004, // The action name: Input.action_release()
+};
+
+/*
+ * Layout of the segment, shared by the host and the supervisor. The command ring follows the
+ * header at commands_offset. Doorbells are 32-bit futex words; each side only issues a wake
+ * system call when the other side announced that it waits.
+ */
+struct ShmSegment {
+    static constexpr uint32_t magic_value   = 0x54534447; // "GDST"
+    static constexpr uint32_t version_value = 2;
+
+    std::atomic<uint32_t> magic{0}; // Stored last, once the host initialized the segment
+    uint32_t              version         = 0;
+    uint32_t              command_slots   = 0; // Power of two
+    uint32_t              commands_offset = 0;
+    int64_t               host_pid        = 0;
+    std::atomic<int64_t>  supervisor_pid{0}; // Last supervisor to attach, 0 before the first
+
+    // Supervisor to host, single producer and single consumer
+    alignas(64) std::atomic<uint64_t> command_head{0}; // Written by the supervisor
+    std::atomic<uint32_t> command_doorbell{0};         // Bumped by the supervisor after sending
+    std::atomic<uint32_t> command_waiters{0};          // Host waiting on the doorbell
+    alignas(64) std::atomic<uint64_t> command_tail{0}; // Written by the host
+
+    // Host to supervisor, a sequence lock around the latest state
+    alignas(64) std::atomic<uint64_t> state_sequence{0}; // Odd while the host writes the state
+    std::atomic<uint32_t> state_doorbell{0};             // Bumped by the host after publishing
+    std::atomic<uint32_t> state_waiters{0};              // Supervisors waiting on the doorbell
+    std::atomic<uint32_t> closed{0};                     // Set when the host detaches
+    uint64_t              iteration_ns = 0;              // Duration of the iteration
+    ChannelState          state;
+
+    ChannelCommand *commands()
+    {
+        return reinterpret_cast<ChannelCommand *>(reinterpret_cast<uint8_t *>(this)
+                                                  + commands_offset);
+    }
+};
+
+/*
+ * Host side: creates the segment, moves commands from it into the control channel before each
+ * iteration and publishes the state after it. With lockstep the host also waits for ShmStep
+ * commands instead of pacing itself, so a supervisor can advance a whole fleet frame by frame.
+ * A lockstep host stops waiting, and ends the project, once the last supervisor that attached
+ * has exited.
+ *
+ * POSIX shared memory; waiting uses futexes on Linux and short sleeps on other systems. Not
+ * available on Windows.
+ */
+class ShmTransport
+{
+  public:
+    ShmTransport(std::string p_name, bool p_lockstep, size_t command_slots = 1024);
+    ~ShmTransport();
+
+    ShmTransport(const ShmTransport &)            = delete;
+    ShmTransport &operator=(const ShmTransport &) = delete;
+
+    /*
+     * Creates the segment, replacing a stale one of the same name. Prints the problem and returns
+     * false on failure.
+     */
+    bool open();
+
+    /*
+     * Marks the segment closed, wakes waiting supervisors and removes it.
+     */
+    void close();
+
+    /*
+     * Takes every queued command. Steps and quit are applied, the rest forwarded to channel. With
+     * lockstep, waits until a step is granted. Returns false when the project should end: on
+     * quit, or when the supervisor died while the host waited for a step.
+     */
+    bool receive(ControlChannel &channel);
+
+    void publish(const ChannelState &state, uint64_t iteration_ns);
+
+    bool is_lockstep() const
+    {
+        return lockstep;
+    }
+
+    void write_json(JsonWriter &json) const;
+
+  private:
+    bool take_commands(ControlChannel &channel);
+
+    std::string name;
+    bool        lockstep;
+    size_t      slots;
+    ShmSegment *segment     = nullptr;
+    size_t      mapped_size = 0;
+
+    uint64_t steps_granted = 0; // Iterations the supervisor allowed but the host has not run
+    bool     quit          = false;
+
+    uint64_t received  = 0;
+    uint64_t forwarded = 0;
+    uint64_t rejected  = 0; // Forwarded but the control channel was full
+    uint64_t published = 0;
+    uint64_t waits     = 0;
+    uint64_t wait_ns   = 0;
+    bool     orphaned  = false; // The supervisor exited while the host waited for a step
+};
+
+/*
+ * Supervisor side of the segment.
+ */
+class ShmClient
+{
+  public:
+    ShmClient() = default;
+    ~ShmClient();
+
+    ShmClient(const ShmClient &)            = delete;
+    ShmClient &operator=(const ShmClient &) = delete;
+
+    /*
+     * Attaches to the segment of a host started with --shm name, waiting up to timeout for the
+     * host to create it. Registers this process as the host's supervisor.
+     */
+    bool open(const std::string &name, std::chrono::milliseconds timeout);
+
+    /*
+     * Queues a command for the host. Returns false if the ring is full.
+     */
+    bool send(const ChannelCommand &command);
+    bool step(uint32_t count = 1);
+
+    /*
+     * Copies the latest state once it is newer than after_frame. Returns false on timeout or when
+     * the host has detached.
+     */
+    bool wait_state(uint64_t after_frame, ChannelState &r_state, std::chrono::microseconds timeout);
+
+    /*
+     * Like wait_state(), but copies only the data, at most capacity bytes, straight to r_data.
+     * r_size is the size of the published data, which may exceed capacity.
+     */
+    bool wait_data(uint64_t after_frame, void *r_data, size_t capacity, uint64_t &r_frame,
+                   uint32_t &r_size, std::chrono::microseconds timeout);
+
+  private:
+    bool wait_copy(uint64_t after_frame, void *r_data, size_t capacity, uint64_t &r_frame,
+                   uint64_t &r_time_ns, uint32_t &r_size, std::chrono::microseconds timeout);
+
+    ShmSegment *segment     = nullptr;
+    size_t      mapped_size = 0;
+};
@@ -0,0 +1,81 @@
+#include "startup_profile.h"
+
+#include <iomanip>
+
+#include "json_writer.h"
+#include "process_stats.h"
+
+void StartupProfile::begin(std::string phase)
+{
+    auto now = Clock::now();
+    entries.push_back({std::move(phase), now, now, static_cast<int>(open.size()),
+                       ProcessUsage::query().rss_bytes});
+    open.push_back(entries.size() - 1);
+}
+
+void StartupProfile::end()
+{
+    if (open.empty()) {
+        return;
+    }
+    auto &entry     = entries[open.back()];
+    entry.finish    = Clock::now();
+    entry.rss_bytes = ProcessUsage::query().rss_bytes;
+    open.pop_back();
+}
+
+void StartupProfile::mark(std::string event)
+{
+    auto now = Clock::now();
+    entries.push_back({std::move(event), now, now, static_cast<int>(open.size()),
+                       ProcessUsage::query().rss_bytes});
+}
+
+std::chrono::duration<double> StartupProfile::duration_of(const std::string &phase) const
+{
+    for (auto entry = entries.rbegin(); entry != entries.rend(); ++entry) {
+        if (entry->name == phase) {
+            return entry->finish - entry->start;
+        }
+    }
+    return std::chrono::duration<double>::zero();
+}
+
+void StartupProfile::print(std::ostream &out) const
+{
+    auto flags     = out.flags();
+    auto precision = out.precision();
+    out << std::fixed << std::setprecision(3);
+
+    out << "startup timeline (ms since process start, resident MiB):\n";
+    for (const auto &entry : entries) {
+        out << std::setw(12) << milliseconds(entry.start) << "  "
+            << std::string(static_cast<size_t>(entry.depth) * 2, ' ') << entry.name;
+        if (entry.finish != entry.start) {
+            out << "  " << milliseconds(entry.finish) - milliseconds(entry.start) << " ms";
+        }
+        if (entry.rss_bytes > 0) {
+            out << "  [" << static_cast<double>(entry.rss_bytes) / (1024.0 * 1024.0) << " MiB]";
+        }
+        out << '\n';
+    }
+    out << std::flush;
+
+    out.flags(flags);
+    out.precision(precision);
+}
+
+void StartupProfile::write_json(JsonWriter &json) const
+{
+    json.begin_array("timeline");
+    for (const auto &entry : entries) {
+        json.begin_object();
+        json.field("name", entry.name);
+        json.field("start_ms", milliseconds(entry.start));
+        json.field("duration_ms", milliseconds(entry.finish) - milliseconds(entry.start));
+        json.field("depth", entry.depth);
+        json.field("rss_bytes", entry.rss_bytes);
+        json.end_object();
+    }
+    json.end_array();
+}
@@ -0,0 +1,65 @@
+/*
+ * Timeline of the phases between process start and the first rendered frame.
+ */
+
+#pragma once
+
+#include <chrono>
+#include <cstdint>
+#include <ostream>
+#include <string>
+#include <vector>
+
+class JsonWriter;
+
+/*
+ * Records named phases and instantaneous marks relative to process start. Phases may nest
+ * (marks from extension initialization land inside the instance creation phase). Each entry
+ * also records the resident set size when it ends, so the memory a phase adds is visible too.
+ */
+class StartupProfile
+{
+  public:
+    using Clock = std::chrono::steady_clock;
+
+    /*
+     * Starts a phase; it ends with the matching end() call.
+     */
+    void begin(std::string phase);
+    void end();
+
+    /*
+     * Records an instantaneous event, e.g. a GDExtension initialization level.
+     */
+    void mark(std::string event);
+
+    /*
+     * Returns the duration of the most recent phase with the given name, or zero.
+     */
+    std::chrono::duration<double> duration_of(const std::string &phase) const;
+
+    /*
+     * Prints the timeline, one entry per line, in milliseconds since process start.
+     */
+    void print(std::ostream &out) const;
+
+    void write_json(JsonWriter &json) const;
+
+  private:
+    struct Entry {
+        std::string       name;
+        Clock::time_point start;
+        Clock::time_point finish;
+        int               depth     = 0;
+        uint64_t          rss_bytes = 0; // Resident set size when the entry ended
+    };
+
+    double milliseconds(Clock::time_point time) const
+    {
+        return std::chrono::duration<double, std::milli>(time - origin).count();
+    }
+
+    Clock::time_point   origin = Clock::now();
+    std::vector<Entry>  entries;
+    std::vector<size_t> open;
+};
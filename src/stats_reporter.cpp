@@ -0,0 +1,54 @@
+#include "stats_reporter.h"
+
+#include <iostream>
+
+#include "json_writer.h"
+
+bool StatsReporter::open(const std::string &path)
+{
+    if (path == "-") {
+        out = &std::cout;
+    } else {
+        file.open(path, std::ios::out | std::ios::trunc);
+        if (!file) {
+            std::cerr << "failed to open stats file: " << path << std::endl;
+            return false;
+        }
+        out = &file;
+    }
+
+    enabled     = true;
+    started     = Clock::now();
+    next_report = started + interval;
+    return true;
+}
+
+void StatsReporter::add_section(std::string name, Section writer)
+{
+    sections.push_back({std::move(name), std::move(writer)});
+}
+
+void StatsReporter::write(bool final)
+{
+    if (!enabled) {
+        return;
+    }
+
+    auto now    = Clock::now();
+    next_report = now + interval;
+
+    JsonWriter json(*out);
+    json.begin_object();
+    json.field("sequence", sequence++);
+    json.field("final", final);
+    json.field("uptime_s", std::chrono::duration<double>(now - started).count());
+    for (auto &section : sections) {
+        json.begin_object(section.name.c_str());
+        section.writer(json);
+        json.end_object();
+    }
+    json.end_object();
+
+    // One report per line, flushed so tailing readers see complete records
+    *out << std::endl;
+}
@@ -0,0 +1,78 @@
+/*
+ * Periodic and shutdown JSON reports of host instrumentation.
+ */
+
+#pragma once
+
+#include <chrono>
+#include <cstdint>
+#include <fstream>
+#include <functional>
+#include <string>
+#include <vector>
+
+class JsonWriter;
+
+/*
+ * Collects named report sections and writes them as one JSON object per line (JSON Lines),
+ * every interval and once more at shutdown with "final": true.
+ */
+class StatsReporter
+{
+  public:
+    using Clock   = std::chrono::steady_clock;
+    using Section = std::function<void(JsonWriter &)>;
+
+    /*
+     * Opens the report destination; "-" writes to stdout. Returns false if it cannot be opened.
+     */
+    bool open(const std::string &path);
+
+    /*
+     * Sets the time between periodic reports, zero disables them.
+     */
+    void set_interval(std::chrono::milliseconds p_interval)
+    {
+        interval = p_interval;
+    }
+
+    /*
+     * Registers a section written as an object under the given key in every report.
+     */
+    void add_section(std::string name, Section writer);
+
+    bool is_enabled() const
+    {
+        return enabled;
+    }
+
+    /*
+     * Writes a periodic report if one is due. Cheap enough to call every iteration.
+     */
+    void poll()
+    {
+        if (enabled && interval.count() > 0 && Clock::now() >= next_report) {
+            write(false);
+        }
+    }
+
+    /*
+     * Writes a report immediately.
+     */
+    void write(bool final);
+
+  private:
+    struct NamedSection {
+        std::string name;
+        Section     writer;
+    };
+
+    std::vector<NamedSection> sections;
+    std::ofstream             file;
+    std::ostream             *out      = nullptr;
+    bool                      enabled  = false;
+    std::chrono::milliseconds interval = std::chrono::milliseconds::zero();
+    Clock::time_point         started  = Clock::now();
+    Clock::time_point         next_report;
+    uint64_t                  sequence = 0;
+};
@@ -0,0 +1,220 @@
+#include "thread_placement.h"
+
+#include <cerrno>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+#include <sstream>
+
+#if defined(_WIN32)
+#define NOMINMAX
+#include <windows.h>
+#elif defined(__linux__)
+#include <linux/mempolicy.h>
+#include <pthread.h>
+#include <sched.h>
+#include <sys/resource.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#else
+#include <pthread.h>
+#include <sched.h>
+#endif
+
+#include "json_writer.h"
+
+namespace
+{
+// Above the default of every other thread, well below the kernel's own real-time threads
+constexpr int realtime_priority  = 10;
+constexpr int high_priority_nice = -10;
+
+const char *priority_name(ThreadPriority priority)
+{
+    switch (priority) {
+        case ThreadPriority::Normal:
+            return "normal";
+        case ThreadPriority::High:
+            return "high";
+        case ThreadPriority::Realtime:
+            return "realtime";
+    }
+    return "unknown";
+}
+
+bool set_affinity(const std::vector<unsigned> &cpus)
+{
+    if (cpus.empty()) {
+        return true;
+    }
+#if defined(_WIN32)
+    DWORD_PTR mask = 0;
+    for (auto cpu : cpus) {
+        if (cpu < 64) {
+            mask |= DWORD_PTR(1) << cpu;
+        }
+    }
+    return mask != 0 && SetThreadAffinityMask(GetCurrentThread(), mask) != 0;
+#elif defined(__linux__)
+    cpu_set_t set;
+    CPU_ZERO(&set);
+    for (auto cpu : cpus) {
+        if (cpu < CPU_SETSIZE) {
+            CPU_SET(cpu, &set);
+        }
+    }
+    return pthread_setaffinity_np(pthread_self(), sizeof(set), &set) == 0;
+#else
+    // No thread affinity API (macOS), leave placement to the scheduler
+    std::cerr << "CPU affinity is not supported on this platform, ignored" << std::endl;
+    return true;
+#endif
+}
+
+bool set_priority(ThreadPriority priority)
+{
+#if defined(_WIN32)
+    switch (priority) {
+        case ThreadPriority::Normal:
+            return true;
+        case ThreadPriority::High:
+            return SetThreadPriority(GetCurrentThread(), THREAD_PRIORITY_HIGHEST) != 0;
+        case ThreadPriority::Realtime:
+            return SetThreadPriority(GetCurrentThread(), THREAD_PRIORITY_TIME_CRITICAL) != 0;
+    }
+    return false;
+#else
+    switch (priority) {
+        case ThreadPriority::Normal:
+            return true;
+        case ThreadPriority::High:
+#if defined(__linux__)
+            // Linux applies nice values per thread
+            return setpriority(PRIO_PROCESS, static_cast<id_t>(syscall(SYS_gettid)),
+                               high_priority_nice)
+                == 0;
+#else
+            return setpriority(PRIO_PROCESS, 0, high_priority_nice) == 0;
+#endif
+        case ThreadPriority::Realtime: {
+            sched_param param{};
+            param.sched_priority = realtime_priority;
+            errno = pthread_setschedparam(pthread_self(), SCHED_FIFO, &param);
+            return errno == 0;
+        }
+    }
+    return false;
+#endif
+}
+} // namespace
+
+ThreadPlacement::ThreadPlacement(std::vector<unsigned> p_main_cpus,
+                                 std::vector<unsigned> p_engine_cpus, int p_numa_node,
+                                 ThreadPriority p_priority)
+    : main_cpus(std::move(p_main_cpus))
+    , engine_cpus(std::move(p_engine_cpus))
+    , numa_node(p_numa_node)
+    , priority(p_priority)
+{
+}
+
+bool ThreadPlacement::parse_cpu_list(const std::string &text, std::vector<unsigned> &r_cpus)
+{
+    r_cpus.clear();
+    std::istringstream ranges(text);
+    std::string        range;
+    while (std::getline(ranges, range, ',')) {
+        char *end   = nullptr;
+        auto  first = std::strtoul(range.c_str(), &end, 10);
+        auto  last  = first;
+        if (end == range.c_str()) {
+            return false;
+        }
+        if (*end == '-') {
+            auto *start = end + 1;
+            last        = std::strtoul(start, &end, 10);
+            if (end == start) {
+                return false;
+            }
+        }
+        if (*end != '\0' && *end != '\n') {
+            return false;
+        }
+        if (last < first || last >= 4096) {
+            return false;
+        }
+        for (auto cpu = first; cpu <= last; ++cpu) {
+            r_cpus.push_back(static_cast<unsigned>(cpu));
+        }
+    }
+    return !r_cpus.empty();
+}
+
+bool ThreadPlacement::numa_node_cpus(int node, std::vector<unsigned> &r_cpus)
+{
+    std::ifstream file("/sys/devices/system/node/node" + std::to_string(node) + "/cpulist");
+    std::string   list;
+    return std::getline(file, list) && parse_cpu_list(list, r_cpus);
+}
+
+bool ThreadPlacement::begin()
+{
+    if (numa_node >= 0) {
+#if defined(__linux__)
+        // Called before any thread starts, so every thread of the process inherits the policy
+        unsigned long nodes[4] = {};
+        if (numa_node >= static_cast<int>(sizeof(nodes) * 8)) {
+            std::cerr << "NUMA node " << numa_node << " is out of range" << std::endl;
+            return false;
+        }
+        nodes[numa_node / 64] |= 1ul << (numa_node % 64);
+        if (syscall(SYS_set_mempolicy, MPOL_BIND, nodes, sizeof(nodes) * 8 + 1) != 0) {
+            std::cerr << "failed to bind memory to NUMA node " << numa_node << ": "
+                      << std::strerror(errno) << std::endl;
+            return false;
+        }
+        memory_bound = true;
+#else
+        std::cerr << "NUMA memory binding is not supported on this platform, ignored"
+                  << std::endl;
+#endif
+    }
+
+    if (!set_affinity(engine_cpus)) {
+        std::cerr << "failed to move engine threads to their CPUs" << std::endl;
+        return false;
+    }
+    return true;
+}
+
+bool ThreadPlacement::finish()
+{
+    if (!set_affinity(main_cpus.empty() ? engine_cpus : main_cpus)) {
+        std::cerr << "failed to move the main thread to its CPUs" << std::endl;
+        return false;
+    }
+    if (!set_priority(priority)) {
+        std::cerr << "failed to set " << priority_name(priority)
+                  << " priority for the main thread: " << std::strerror(errno) << std::endl;
+        return false;
+    }
+    return true;
+}
+
+void ThreadPlacement::write_json(JsonWriter &json) const
+{
+    json.begin_array("main_cpus");
+    for (auto cpu : main_cpus) {
+        json.value(cpu);
+    }
+    json.end_array();
+    json.begin_array("engine_cpus");
+    for (auto cpu : engine_cpus) {
+        json.value(cpu);
+    }
+    json.end_array();
+    json.field("numa_node", numa_node);
+    json.field("memory_bound", memory_bound);
+    json.field("main_priority", priority_name(priority));
+}
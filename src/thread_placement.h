@@ -0,0 +1,67 @@
+/*
+ * CPU, priority and NUMA placement of the engine's threads.
+ */
+
+#pragma once
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+class JsonWriter;
+
+enum class ThreadPriority {
+    Normal,
+    High,     // Nice -10, or THREAD_PRIORITY_HIGHEST on Windows
+    Realtime, // SCHED_FIFO, or THREAD_PRIORITY_TIME_CRITICAL on Windows
+};
+
+/*
+ * Places the host's main thread, which runs every engine iteration, and the threads the engine
+ * starts (worker pool, rendering, audio) plus the job system workers. The engine creates its
+ * threads itself, but a new thread inherits the CPU affinity and memory policy of the thread
+ * that starts it: begin() gives the main thread the engine placement before anything is started,
+ * finish() moves it to its own CPUs and priority once the instance exists. Threads the engine
+ * starts later from the main thread share the main CPUs.
+ *
+ * With a NUMA node, memory allocations of every thread are bound to that node (set_mempolicy),
+ * so iterations never touch remote memory. Affinity and memory binding are Linux only; Windows
+ * supports affinity to the first 64 CPUs and priorities, other systems only priorities.
+ */
+class ThreadPlacement
+{
+  public:
+    ThreadPlacement(std::vector<unsigned> p_main_cpus, std::vector<unsigned> p_engine_cpus,
+                    int p_numa_node, ThreadPriority p_priority);
+
+    /*
+     * Parses a CPU list like "0-3,8,10-11" as in /sys and taskset. Returns false on bad input.
+     */
+    static bool parse_cpu_list(const std::string &text, std::vector<unsigned> &r_cpus);
+
+    /*
+     * Returns the CPUs of a NUMA node from /sys/devices/system/node. False if there is none.
+     */
+    static bool numa_node_cpus(int node, std::vector<unsigned> &r_cpus);
+
+    /*
+     * Binds memory to the NUMA node and moves the calling thread to the engine CPUs. Call on
+     * the main thread before any other thread is started. Prints the problem and returns false.
+     */
+    bool begin();
+
+    /*
+     * Moves the calling thread to the main CPUs and sets its priority. Prints the problem and
+     * returns false, e.g. without the privilege for a real-time or raised priority.
+     */
+    bool finish();
+
+    void write_json(JsonWriter &json) const;
+
+  private:
+    std::vector<unsigned> main_cpus;
+    std::vector<unsigned> engine_cpus;
+    int                   numa_node;
+    ThreadPriority        priority;
+    bool                  memory_bound = false;
+};